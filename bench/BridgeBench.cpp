@@ -0,0 +1,219 @@
+// BridgeBench
+// measures the cost of crossing between the engine and each scripting language:
+// hook calls (runUpdate / runRender), script-to-native calls, argument marshalling and error paths
+//
+// usage: BridgeBench [lua] [python] [ruby]
+// runs every language when none are given. run it from the directory holding the bench scripts
+// (bin/bench after make bench). results go to stdout as JSON, progress to stderr
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "AllocationTracker.hpp"
+#include "Statistics.hpp"
+#include "Configuration.hpp"
+#include "EntityStore.hpp"
+#include "HeadlessBackend.hpp"
+#include "SharedContext.hpp"
+
+#include "LuaScriptingEngine.hpp"
+#include "RubyScriptingEngine.hpp"
+#include "PythonScriptingEngine.hpp"
+
+struct BenchCase {
+  enum Kind {
+    // one op per runUpdate call
+    UPDATE_HOOK,
+    // one op per runRender call
+    RENDER_HOOK,
+    // the script function loops over its call - the loop count is passed as the update argument
+    SCRIPT_LOOP
+  };
+
+  const char* name;
+  const char* function;
+  Kind kind;
+};
+
+static const BenchCase benchCases[] = {
+  { "hook.update", "benchUpdate", BenchCase::UPDATE_HOOK },
+  { "hook.render", "benchRender", BenchCase::RENDER_HOOK },
+  { "script.loop", "benchLoop", BenchCase::SCRIPT_LOOP },
+  { "native.getScreenWidth", "benchGetScreenWidth", BenchCase::SCRIPT_LOOP },
+  { "native.drawCircle", "benchDrawCircle", BenchCase::SCRIPT_LOOP },
+  { "marshal.int", "benchIsEntityAlive", BenchCase::SCRIPT_LOOP },
+  { "marshal.float", "benchSetPosition", BenchCase::SCRIPT_LOOP },
+  { "marshal.floatReturn", "benchGetPositionX", BenchCase::SCRIPT_LOOP },
+  { "marshal.string", "benchUnregisterSystem", BenchCase::SCRIPT_LOOP },
+  { "error.argument", "benchArgumentError", BenchCase::SCRIPT_LOOP }
+};
+
+static const int SAMPLES = 7;
+static const unsigned HOOK_CALLS = 100000;
+static const unsigned LOOP_CALLS = 100;
+static const unsigned LOOP_ITERATIONS = 1000;
+
+struct BenchResult {
+  std::string language;
+  std::string name;
+  unsigned long long ops;
+  double nanosecondsPerOp;
+  double allocationsPerOp;
+};
+
+struct Sample {
+  double nanosecondsPerOp;
+  double allocationsPerOp;
+};
+
+static Sample runSample(ScriptingEngine& scripting, BenchCase const& benchCase, unsigned long long* ops) {
+  unsigned calls = benchCase.kind == BenchCase::SCRIPT_LOOP ? LOOP_CALLS : HOOK_CALLS;
+  *ops = benchCase.kind == BenchCase::SCRIPT_LOOP ? static_cast<unsigned long long>(calls) * LOOP_ITERATIONS : calls;
+
+  unsigned long long allocationsBefore = allocationTracker::count();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  for (unsigned i = 0; i < calls; i++) {
+    if (benchCase.kind == BenchCase::RENDER_HOOK) {
+      scripting.runRender();
+    } else {
+      scripting.runUpdate(static_cast<float>(LOOP_ITERATIONS));
+    }
+  }
+
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  unsigned long long allocationsAfter = allocationTracker::count();
+
+  Sample sample;
+  sample.nanosecondsPerOp = elapsed.count() / *ops;
+  sample.allocationsPerOp = static_cast<double>(allocationsAfter - allocationsBefore) / *ops;
+  return sample;
+}
+
+static void runLanguage(std::string const& language, std::string const& programName, std::vector<BenchResult>& results) {
+  Configuration config;
+  SharedContext context;
+  HeadlessBackend backend;
+  EntityStore world;
+
+  SharedContext::instance = &context;
+  context.config = &config;
+  context.backend = &backend;
+  context.world = &world;
+  context.scripting = nullptr;
+
+  std::string filename;
+  if (language == "lua") {
+    context.scripting = new LuaScriptingEngine();
+    filename = "bridge.lua";
+  } else if (language == "python") {
+    context.scripting = new PythonScriptingEngine(programName);
+    filename = "bridge.py";
+  } else if (language == "ruby") {
+    context.scripting = new RubyScriptingEngine();
+    filename = "./bridge.rb";
+  } else {
+    throw std::runtime_error("Unknown language " + language);
+  }
+
+  ScriptingEngine& scripting = *context.scripting;
+  scripting.load(filename);
+  backend.createWindow(config.screenWidth, config.screenHeight, config.useFullscreen, config.windowTitle);
+  scripting.runCreate();
+
+  for (size_t i = 0; i < sizeof(benchCases) / sizeof(benchCases[0]); i++) {
+    BenchCase const& benchCase = benchCases[i];
+    std::cerr << language << " " << benchCase.name << std::endl;
+
+    // point the hook being measured at the case's function
+    Configuration hooks;
+    hooks.copy(config);
+    if (benchCase.kind == BenchCase::RENDER_HOOK) {
+      hooks.userRenderFunctionName = benchCase.function;
+    } else {
+      hooks.userUpdateFunctionName = benchCase.function;
+    }
+    scripting.init(hooks);
+
+    unsigned long long ops = 0;
+    runSample(scripting, benchCase, &ops);
+
+    std::vector<double> times;
+    std::vector<double> allocationCounts;
+    for (int sample = 0; sample < SAMPLES; sample++) {
+      Sample measured = runSample(scripting, benchCase, &ops);
+      times.push_back(measured.nanosecondsPerOp);
+      allocationCounts.push_back(measured.allocationsPerOp);
+    }
+
+    BenchResult result;
+    result.language = language;
+    result.name = benchCase.name;
+    result.ops = ops;
+    result.nanosecondsPerOp = statistics::median(times);
+    result.allocationsPerOp = statistics::median(allocationCounts);
+    results.push_back(result);
+  }
+
+  scripting.runDestroy();
+  delete context.scripting;
+  context.scripting = nullptr;
+  SharedContext::instance = nullptr;
+}
+
+static void printResults(std::vector<BenchResult> const& results) {
+  std::cout << std::fixed << "{" << std::endl
+    << "  \"samples\": " << SAMPLES << "," << std::endl
+    << "  \"benchmarks\": [" << std::endl;
+
+  for (size_t i = 0; i < results.size(); i++) {
+    BenchResult const& result = results[i];
+    std::cout << "    { \"language\": \"" << result.language << "\""
+      << ", \"name\": \"" << result.name << "\""
+      << ", \"ops\": " << result.ops
+      << ", \"ns_per_op\": " << std::setprecision(2) << result.nanosecondsPerOp
+      << ", \"allocs_per_op\": ";
+
+    if (allocationTracker::isCounting()) {
+      std::cout << std::setprecision(3) << result.allocationsPerOp;
+    } else {
+      std::cout << "null";
+    }
+
+    std::cout << " }" << (i + 1 < results.size() ? "," : "") << std::endl;
+  }
+
+  std::cout << "  ]" << std::endl << "}" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  std::vector<std::string> languages;
+  for (int i = 1; i < argc; i++) {
+    languages.push_back(argv[i]);
+  }
+
+  if (languages.empty()) {
+    languages.push_back("lua");
+    languages.push_back("python");
+    languages.push_back("ruby");
+  }
+
+  std::vector<BenchResult> results;
+
+  try {
+    for (size_t i = 0; i < languages.size(); i++) {
+      runLanguage(languages[i], argv[0], results);
+    }
+  } catch (const std::exception& ex) {
+    std::cerr << "Runtime Error: " << ex.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  printResults(results);
+  return EXIT_SUCCESS;
+}
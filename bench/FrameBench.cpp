@@ -0,0 +1,325 @@
+// FrameBench
+// runs a game script headless for a fixed number of frames with a fixed delta time, records the update
+// and render time, the allocations, the script hooks that overran HOOK_BUDGET_MS and the script vm's
+// allocations and memory in use of every frame, and compares them with a stored baseline
+//
+// usage: FrameBench <script> [options]
+//   --frames N         frames to record (600)
+//   --warmup N         frames to run before recording (60)
+//   --delta SECONDS    fixed delta time passed to update (1/60)
+//   --save FILE        store the recorded frames as a baseline
+//   --baseline FILE    compare the recorded frames with a stored baseline
+//   --alpha P          significance level of the comparison (0.01)
+//   --tolerance F      smallest slowdown of the median that counts, as a fraction (0.05)
+//   --min-delta MS     smallest slowdown of the median time that counts, in milliseconds (0.05)
+//   --trace FILE       write a Chrome trace of the run (builds with -DENABLE_TRACING only)
+//   --profile FILE     profile the script during the recorded frames - see ScriptProfiler.hpp
+//   --profile-mode M   sampling (default) or tracing
+//   --lua-alloc A      allocator of the lua states: pool (default) or system - see LuaAllocator.hpp
+//   --alloc-free P     frame phases that must not allocate during the recorded frames, like update,render
+//                      (builds with -DTRACK_ALLOCATIONS only) - see AllocationTracker.hpp
+//
+// a metric regresses when a one-sided Mann-Whitney U test says the new frames are slower than the
+// baseline frames (p < alpha) and the median moved by more than the tolerance. timings also have to
+// move by more than min-delta, so scripts with microsecond frames don't fail on timer noise. an
+// allocation in a phase given to --alloc-free counts as a regression too.
+// prints JSON to stdout and exits with 1 on a regression, 2 on errors
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "AllocationTracker.hpp"
+#include "Statistics.hpp"
+#include "FrameStats.hpp"
+#include "Game.hpp"
+#include "HeadlessBackend.hpp"
+#include "LuaAllocator.hpp"
+#include "PythonScriptingEngine.hpp"
+#include "ScriptingEngine.hpp"
+#include "Trace.hpp"
+
+static const int EXIT_REGRESSION = 1;
+static const int EXIT_ERROR = 2;
+
+struct Options {
+  std::string script;
+  int frames;
+  int warmup;
+  float deltaTime;
+  std::string saveFile;
+  std::string baselineFile;
+  std::string traceFile;
+  std::string profileFile;
+  ScriptProfiler::Mode profileMode;
+  bool allocationFree[allocationTracker::PHASE_COUNT];
+  bool checkAllocations;
+  double alpha;
+  double tolerance;
+  double minDelta;
+
+  Options()
+    : frames(600),
+      warmup(60),
+      deltaTime(1.0f / 60.0f),
+      profileMode(ScriptProfiler::SAMPLING),
+      allocationFree(),
+      checkAllocations(false),
+      alpha(0.01),
+      tolerance(0.05),
+      minDelta(0.05) {
+  }
+};
+
+struct Metric {
+  std::string name;
+  std::vector<double> values;
+  std::vector<double> baseline;
+  // smallest change of the median that counts
+  double minDelta;
+  double pValue;
+  bool regression;
+};
+
+static Options parseOptions(int argc, char* argv[]) {
+  Options options;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+
+    if (arg.compare(0, 2, "--") != 0) {
+      options.script = arg;
+      continue;
+    }
+
+    if (i + 1 >= argc) {
+      throw std::runtime_error("Missing value for " + arg);
+    }
+    std::string value = argv[++i];
+
+    if (arg == "--frames") {
+      options.frames = std::atoi(value.c_str());
+    } else if (arg == "--warmup") {
+      options.warmup = std::atoi(value.c_str());
+    } else if (arg == "--delta") {
+      options.deltaTime = static_cast<float>(std::atof(value.c_str()));
+    } else if (arg == "--save") {
+      options.saveFile = value;
+    } else if (arg == "--baseline") {
+      options.baselineFile = value;
+    } else if (arg == "--trace") {
+      options.traceFile = value;
+    } else if (arg == "--profile") {
+      options.profileFile = value;
+    } else if (arg == "--profile-mode") {
+      if (!ScriptProfiler::parseMode(value, &options.profileMode)) {
+        throw std::runtime_error("Unknown profile mode " + value);
+      }
+    } else if (arg == "--lua-alloc") {
+      LuaAllocator::Mode allocatorMode = LuaAllocator::POOLED;
+      if (!LuaAllocator::parseMode(value, &allocatorMode)) {
+        throw std::runtime_error("Unknown lua allocator " + value);
+      }
+      LuaAllocator::setMode(allocatorMode);
+    } else if (arg == "--alloc-free") {
+      if (!allocationTracker::parsePhaseList(value, options.allocationFree)) {
+        throw std::runtime_error("Unknown frame phase in " + value);
+      }
+      options.checkAllocations = true;
+    } else if (arg == "--alpha") {
+      options.alpha = std::atof(value.c_str());
+    } else if (arg == "--tolerance") {
+      options.tolerance = std::atof(value.c_str());
+    } else if (arg == "--min-delta") {
+      options.minDelta = std::atof(value.c_str());
+    } else {
+      throw std::runtime_error("Unknown option " + arg);
+    }
+  }
+
+  if (options.script.empty()) {
+    throw std::runtime_error("usage: FrameBench <script> [--frames N] [--warmup N] [--delta SECONDS] [--save FILE] [--baseline FILE] [--alpha P] [--tolerance F] [--min-delta MS] [--trace FILE] [--profile FILE] [--profile-mode M] [--lua-alloc A] [--alloc-free P]");
+  }
+
+  if (options.frames <= 0) {
+    throw std::runtime_error("--frames must be positive");
+  }
+
+  if (options.checkAllocations && !allocationTracker::isTracking()) {
+    throw std::runtime_error("--alloc-free needs a build with -DTRACK_ALLOCATIONS");
+  }
+
+  return options;
+}
+
+static const size_t METRIC_COUNT = 6;
+
+static void addMetrics(std::vector<FrameStats::Frame> const& frames, std::vector<Metric>& metrics, bool isBaseline, double minDelta) {
+  if (metrics.empty()) {
+    const char* names[METRIC_COUNT] = { "update_ms", "render_ms", "allocations", "hook_overruns", "script_allocations", "script_kb" };
+    for (size_t i = 0; i < METRIC_COUNT; i++) {
+      Metric metric;
+      metric.name = names[i];
+      metric.minDelta = i < 2 ? minDelta : 0;
+      metric.pValue = 1;
+      metric.regression = false;
+      metrics.push_back(metric);
+    }
+  }
+
+  for (size_t i = 0; i < frames.size(); i++) {
+    FrameStats::Frame const& frame = frames[i];
+    std::vector<double>* destination[METRIC_COUNT];
+    for (size_t m = 0; m < METRIC_COUNT; m++) {
+      destination[m] = isBaseline ? &metrics[m].baseline : &metrics[m].values;
+    }
+
+    destination[0]->push_back(frame.updateMilliseconds);
+    destination[1]->push_back(frame.renderMilliseconds);
+    if (frame.allocations >= 0) {
+      destination[2]->push_back(static_cast<double>(frame.allocations));
+    }
+    destination[3]->push_back(frame.hookOverruns);
+    if (frame.scriptAllocations >= 0) {
+      destination[4]->push_back(static_cast<double>(frame.scriptAllocations));
+    }
+    if (frame.scriptBytes >= 0) {
+      destination[5]->push_back(frame.scriptBytes / 1024.0);
+    }
+  }
+}
+
+static void printJsonNumber(double value) {
+  std::cout << std::setprecision(4) << value;
+}
+
+int main(int argc, char* argv[]) {
+  std::vector<Metric> metrics;
+  Options options;
+  bool regression = false;
+  unsigned long long allocationViolations = 0;
+
+  try {
+    options = parseOptions(argc, argv);
+
+    FrameStats stats;
+    if (allocationTracker::isCounting()) {
+      stats.setAllocationCounter(allocationTracker::count);
+    }
+    // script_allocations and script_kb
+    PythonScriptingEngine::setMemoryCounting(true);
+
+    {
+      Game game(argv[0], options.script, new HeadlessBackend(), false);
+
+      // the per-frame debug logging would dominate the timings
+      game.config.debugMode = false;
+
+      game.runFrames(options.warmup, options.deltaTime);
+      if (!options.profileFile.empty()) {
+        game.context.scripting->setProfileFile(options.profileFile);
+        game.context.scripting->setProfileMode(options.profileMode);
+        if (!game.context.scripting->setProfiling(true)) {
+          throw std::runtime_error("Unable to start the script profiler");
+        }
+      }
+
+      if (options.checkAllocations) {
+        for (int phase = 0; phase < allocationTracker::PHASE_COUNT; phase++) {
+          allocationTracker::setAllocationFree(static_cast<allocationTracker::Phase>(phase), options.allocationFree[phase]);
+        }
+        allocationTracker::startChecking(0);
+      }
+
+      game.frameStats = &stats;
+      game.runFrames(options.frames, options.deltaTime);
+      game.frameStats = nullptr;
+      if (options.checkAllocations) {
+        // the destroy hook may allocate as it likes
+        allocationTracker::stopChecking();
+        allocationViolations = allocationTracker::getReport().violations;
+        regression = regression || allocationViolations > 0;
+      }
+
+      // the profile is written before the destroy hook runs
+      game.context.scripting->setProfiling(false);
+    }
+
+    if (!options.saveFile.empty()) {
+      stats.save(options.saveFile);
+    }
+
+    if (!options.traceFile.empty()) {
+      trace::write(options.traceFile);
+    }
+
+    addMetrics(stats.getFrames(), metrics, false, options.minDelta);
+
+    if (!options.baselineFile.empty()) {
+      FrameStats baseline;
+      baseline.load(options.baselineFile);
+      addMetrics(baseline.getFrames(), metrics, true, options.minDelta);
+
+      for (size_t i = 0; i < metrics.size(); i++) {
+        Metric& metric = metrics[i];
+        if (metric.values.empty() || metric.baseline.empty()) {
+          continue;
+        }
+
+        double median = statistics::median(metric.values);
+        double baselineMedian = statistics::median(metric.baseline);
+        metric.pValue = statistics::mannWhitneyGreater(metric.baseline, metric.values);
+        metric.regression = metric.pValue < options.alpha
+          && median > baselineMedian * (1 + options.tolerance)
+          && median - baselineMedian > metric.minDelta;
+        regression = regression || metric.regression;
+      }
+    }
+  } catch (const std::exception& ex) {
+    std::cerr << "Runtime Error: " << ex.what() << std::endl;
+    return EXIT_ERROR;
+  }
+
+  std::cout << std::fixed << "{" << std::endl
+    << "  \"script\": \"" << options.script << "\"," << std::endl
+    << "  \"frames\": " << options.frames << "," << std::endl
+    << "  \"delta\": " << std::setprecision(6) << options.deltaTime << "," << std::endl
+    << "  \"metrics\": [" << std::endl;
+
+  for (size_t i = 0; i < metrics.size(); i++) {
+    Metric const& metric = metrics[i];
+    std::cout << "    { \"name\": \"" << metric.name << "\"";
+
+    if (metric.values.empty()) {
+      std::cout << ", \"median\": null";
+    } else {
+      std::cout << ", \"median\": ";
+      printJsonNumber(statistics::median(metric.values));
+      std::cout << ", \"p95\": ";
+      printJsonNumber(statistics::percentile(metric.values, 0.95));
+    }
+
+    if (!metric.baseline.empty()) {
+      std::cout << ", \"baseline_median\": ";
+      printJsonNumber(statistics::median(metric.baseline));
+      std::cout << ", \"p_value\": ";
+      printJsonNumber(metric.pValue);
+      std::cout << ", \"regression\": " << (metric.regression ? "true" : "false");
+    }
+
+    std::cout << " }" << (i + 1 < metrics.size() ? "," : "") << std::endl;
+  }
+
+  std::cout << "  ]," << std::endl;
+  if (options.checkAllocations) {
+    std::cout << "  \"allocation_violations\": " << allocationViolations << "," << std::endl;
+  }
+  std::cout << "  \"regression\": " << (regression ? "true" : "false") << std::endl
+    << "}" << std::endl;
+
+  return regression ? EXIT_REGRESSION : EXIT_SUCCESS;
+}
@@ -0,0 +1,161 @@
+// KinematicsBench
+// checks the vector kernel of the bounce system (Kinematics.cpp) against its scalar loop and times the two
+//
+// usage: KinematicsBench [--bodies N] [--frames N]
+// moves the same bodies with integrate (AVX or SSE2 as compiled, scalar for the remainder) and with
+// integrateScalar alone, for every response, and compares positions, velocities and collisions after
+// every frame - the two must agree exactly. results go to stdout as JSON: the median time of a frame on
+// each path. exits with 1 when the paths disagree
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Kinematics.hpp"
+#include "Statistics.hpp"
+
+static const float DELTA_TIME = 1.0f / 60;
+static const float WIDTH = 960;
+static const float HEIGHT = 540;
+
+struct Bodies {
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> vx;
+  std::vector<float> vy;
+  std::vector<float> radius;
+};
+
+struct ResponseResult {
+  const char* name;
+  double vectorMilliseconds;
+  double scalarMilliseconds;
+  // the first frame the paths disagreed on - negative when they never did
+  int mismatchFrame;
+};
+
+// the same bodies every run - some start against the bounds so every frame has collisions
+static Bodies makeBodies(size_t count) {
+  std::mt19937 random(12345);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+  Bodies bodies;
+  for (size_t i = 0; i < count; i++) {
+    float r = 2 + unit(random) * 14;
+    bodies.radius.push_back(r);
+    bodies.x.push_back(i % 16 == 0 ? r : r + unit(random) * (WIDTH - 2 * r));
+    bodies.y.push_back(i % 16 == 1 ? HEIGHT - r : r + unit(random) * (HEIGHT - 2 * r));
+    bodies.vx.push_back((unit(random) - 0.5f) * 600);
+    bodies.vy.push_back((unit(random) - 0.5f) * 600);
+  }
+  return bodies;
+}
+
+static bool sameFloats(std::vector<float> const& a, std::vector<float> const& b) {
+  return std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+}
+
+static bool sameState(Bodies const& a, Bodies const& b, std::vector<kinematics::Collision> const& ca, std::vector<kinematics::Collision> const& cb) {
+  if (!sameFloats(a.x, b.x) || !sameFloats(a.y, b.y) || !sameFloats(a.vx, b.vx) || !sameFloats(a.vy, b.vy) || ca.size() != cb.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < ca.size(); i++) {
+    if (ca[i].index != cb[i].index || ca[i].axes != cb[i].axes) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static ResponseResult runResponse(const char* name, size_t count, int frames) {
+  kinematics::Settings settings;
+  settings.right = WIDTH;
+  settings.bottom = HEIGHT;
+  kinematics::parseResponse(name, &settings.response);
+
+  Bodies vector = makeBodies(count);
+  Bodies scalar = vector;
+  std::vector<kinematics::Collision> vectorCollisions;
+  std::vector<kinematics::Collision> scalarCollisions;
+  vectorCollisions.reserve(count);
+  scalarCollisions.reserve(count);
+
+  std::vector<double> vectorTimes;
+  std::vector<double> scalarTimes;
+
+  ResponseResult result = { name, 0, 0, -1 };
+  for (int frame = 0; frame < frames; frame++) {
+    vectorCollisions.clear();
+    scalarCollisions.clear();
+
+    auto start = std::chrono::steady_clock::now();
+    kinematics::integrate(settings, vector.x.data(), vector.y.data(), vector.vx.data(), vector.vy.data(), vector.radius.data(), count, DELTA_TIME, &vectorCollisions);
+    auto middle = std::chrono::steady_clock::now();
+    kinematics::integrateScalar(settings, scalar.x.data(), scalar.y.data(), scalar.vx.data(), scalar.vy.data(), scalar.radius.data(), 0, count, DELTA_TIME, &scalarCollisions);
+    auto end = std::chrono::steady_clock::now();
+
+    vectorTimes.push_back(std::chrono::duration<double, std::milli>(middle - start).count());
+    scalarTimes.push_back(std::chrono::duration<double, std::milli>(end - middle).count());
+
+    if (result.mismatchFrame < 0 && !sameState(vector, scalar, vectorCollisions, scalarCollisions)) {
+      result.mismatchFrame = frame;
+    }
+  }
+
+  result.vectorMilliseconds = statistics::median(vectorTimes);
+  result.scalarMilliseconds = statistics::median(scalarTimes);
+  return result;
+}
+
+int main(int argc, char* argv[]) {
+  size_t bodies = 10000;
+  int frames = 600;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--bodies" && i + 1 < argc) {
+      bodies = static_cast<size_t>(std::atol(argv[++i]));
+    } else if (arg == "--frames" && i + 1 < argc) {
+      frames = std::atoi(argv[++i]);
+    } else {
+      std::cerr << "Unknown option " << arg << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  const char* responses[] = { "reflect", "stop", "pass" };
+  std::vector<ResponseResult> results;
+  bool mismatch = false;
+  for (size_t i = 0; i < sizeof(responses) / sizeof(responses[0]); i++) {
+    results.push_back(runResponse(responses[i], bodies, frames));
+    mismatch = mismatch || results.back().mismatchFrame >= 0;
+  }
+
+  std::cout << std::fixed << "{" << std::endl
+    << "  \"instruction_set\": \"" << kinematics::instructionSet() << "\"," << std::endl
+    << "  \"bodies\": " << bodies << "," << std::endl
+    << "  \"frames\": " << frames << "," << std::endl
+    << "  \"responses\": [" << std::endl;
+  for (size_t i = 0; i < results.size(); i++) {
+    ResponseResult const& result = results[i];
+    std::cout << "    { \"name\": \"" << result.name << "\""
+      << ", \"vector_ms\": " << std::setprecision(4) << result.vectorMilliseconds
+      << ", \"scalar_ms\": " << result.scalarMilliseconds
+      << ", \"matches\": " << (result.mismatchFrame < 0 ? "true" : "false");
+    if (result.mismatchFrame >= 0) {
+      std::cout << ", \"mismatch_frame\": " << result.mismatchFrame;
+    }
+    std::cout << " }" << (i + 1 < results.size() ? "," : "") << std::endl;
+  }
+  std::cout << "  ]" << std::endl << "}" << std::endl;
+
+  if (mismatch) {
+    std::cerr << "The vector and scalar kinematics paths disagree" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,262 @@
+// LuaVMBench
+// runs a standard set of workloads on the vendored lua vm on its own, without the engine, so changes
+// to the interpreter (lvm.cpp, lgc.cpp, ltable.cpp, ...) can be tracked apart from the bridge
+//
+// usage: LuaVMBench [--lua-alloc pool|system] [workload ...]
+// runs every workload when none are given, with the allocator the engine uses (see LuaAllocator.hpp). run it from bin/bench after make bench - workloads are
+// vm/<name>.lua and return a table { size = default problem size, run = function(size) ... end }.
+// results go to stdout as JSON: median time, peak heap size, gc cycles and allocations per run, and
+// in debug builds the hit rate of the vm's field caches over every run (see lvm.cpp)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "LuaAllocator.hpp"
+#include "Statistics.hpp"
+#include "lua/lua.hpp"
+
+static const char* WORKLOADS[] = {
+  "binary_trees",
+  "n_body",
+  "spectral_norm",
+  "fannkuch",
+  "string_build",
+  "table_heavy",
+  "gc_churn"
+};
+
+static const int SAMPLES = 5;
+static const char* SENTINEL_METATABLE = "bench.GCSentinel";
+
+struct VMStats {
+  size_t currentBytes;
+  size_t peakBytes;
+  unsigned long long allocations;
+  unsigned long long gcCycles;
+  bool countingCycles;
+  // the blocks come from the pools - nullptr for the system allocator
+  LuaAllocator* pool;
+};
+
+struct WorkloadResult {
+  std::string name;
+  lua_Integer size;
+  double milliseconds;
+  size_t peakBytes;
+  unsigned long long gcCycles;
+  unsigned long long allocations;
+  // of the field caches over every run - negative when the vm does not count them
+  double fieldCacheHitRate;
+  double result;
+};
+
+// lua allocator that keeps track of the heap size
+static void* countingAllocator(void* userData, void* block, size_t oldSize, size_t newSize) {
+  VMStats* stats = static_cast<VMStats*>(userData);
+
+  // for new blocks oldSize holds the type of the object instead of a size
+  if (block == nullptr) {
+    oldSize = 0;
+  }
+
+  if (newSize == 0) {
+    if (stats->pool != nullptr) {
+      LuaAllocator::allocate(stats->pool, block, oldSize, 0);
+    } else {
+      std::free(block);
+    }
+    stats->currentBytes -= oldSize;
+    return nullptr;
+  }
+
+  void* resized = stats->pool != nullptr ? LuaAllocator::allocate(stats->pool, block, oldSize, newSize) : std::realloc(block, newSize);
+  if (resized == nullptr) {
+    return nullptr;
+  }
+
+  stats->allocations++;
+  stats->currentBytes = stats->currentBytes - oldSize + newSize;
+  stats->peakBytes = std::max(stats->peakBytes, stats->currentBytes);
+  return resized;
+}
+
+static void pushSentinel(lua_State* L) {
+  lua_newuserdata(L, 1);
+  luaL_setmetatable(L, SENTINEL_METATABLE);
+}
+
+// an unreachable sentinel is finalized once per completed collection cycle - it counts the cycle
+// and leaves a new sentinel behind for the next one
+static int finalizeSentinel(lua_State* L) {
+  VMStats* stats = static_cast<VMStats*>(lua_touserdata(L, lua_upvalueindex(1)));
+  if (stats->countingCycles) {
+    stats->gcCycles++;
+    pushSentinel(L);
+    lua_pop(L, 1);
+  }
+  return 0;
+}
+
+static WorkloadResult runWorkload(std::string const& name) {
+  VMStats stats = {};
+  LuaAllocator pool(LuaAllocator::POOLED);
+  if (LuaAllocator::getMode() == LuaAllocator::POOLED) {
+    stats.pool = &pool;
+  }
+  lua_State* L = lua_newstate(countingAllocator, &stats);
+  if (L == nullptr) {
+    throw std::runtime_error("Unable to create lua state");
+  }
+
+  luaL_openlibs(L);
+
+  luaL_newmetatable(L, SENTINEL_METATABLE);
+  lua_pushlightuserdata(L, &stats);
+  lua_pushcclosure(L, finalizeSentinel, 1);
+  lua_setfield(L, -2, "__gc");
+  lua_pop(L, 1);
+
+  std::string filename = "vm/" + name + ".lua";
+  if (luaL_loadfile(L, filename.c_str()) != LUA_OK || lua_pcall(L, 0, 1, 0) != LUA_OK) {
+    std::stringstream msg;
+    msg << "Unable to load " << filename << ": " << lua_tostring(L, -1) << std::endl;
+    lua_close(L);
+    throw std::runtime_error(msg.str());
+  }
+  // stack: [workload]
+
+  lua_getfield(L, -1, "size");
+  lua_Integer size = lua_tointeger(L, -1);
+  lua_pop(L, 1);
+
+  WorkloadResult result;
+  result.name = name;
+  result.size = size;
+  result.peakBytes = 0;
+  result.result = 0;
+
+  std::vector<double> times;
+  std::vector<double> cycles;
+  std::vector<double> allocations;
+
+  // the first run warms up and is not recorded
+  for (int sample = 0; sample <= SAMPLES; sample++) {
+    // every run starts from a fully collected heap
+    lua_gc(L, LUA_GCCOLLECT, 0);
+    stats.peakBytes = stats.currentBytes;
+    unsigned long long cyclesBefore = stats.gcCycles;
+    unsigned long long allocationsBefore = stats.allocations;
+
+    stats.countingCycles = true;
+    pushSentinel(L);
+    lua_pop(L, 1);
+
+    lua_getfield(L, -1, "run");
+    lua_pushinteger(L, size);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int status = lua_pcall(L, 1, 1, 0);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    stats.countingCycles = false;
+
+    if (status != LUA_OK) {
+      std::stringstream msg;
+      msg << "Error in " << filename << ": " << lua_tostring(L, -1) << std::endl;
+      lua_close(L);
+      throw std::runtime_error(msg.str());
+    }
+
+    result.result = lua_tonumber(L, -1);
+    lua_pop(L, 1);
+
+    if (sample > 0) {
+      times.push_back(elapsed.count());
+      cycles.push_back(static_cast<double>(stats.gcCycles - cyclesBefore));
+      allocations.push_back(static_cast<double>(stats.allocations - allocationsBefore));
+      result.peakBytes = std::max(result.peakBytes, stats.peakBytes);
+    }
+  }
+
+  lua_Unsigned hits = 0;
+  lua_Unsigned misses = 0;
+  result.fieldCacheHitRate = -1;
+  if (lua_fieldcachestats(L, &hits, &misses) && hits + misses > 0) {
+    result.fieldCacheHitRate = static_cast<double>(hits) / static_cast<double>(hits + misses);
+  }
+
+  lua_close(L);
+
+  result.milliseconds = statistics::median(times);
+  result.gcCycles = static_cast<unsigned long long>(statistics::median(cycles));
+  result.allocations = static_cast<unsigned long long>(statistics::median(allocations));
+  return result;
+}
+
+static void printResults(std::vector<WorkloadResult> const& results) {
+  std::cout << std::fixed << "{" << std::endl
+    << "  \"vm\": \"" << LUA_RELEASE << "\"," << std::endl
+    << "  \"allocator\": \"" << (LuaAllocator::getMode() == LuaAllocator::POOLED ? "pool" : "system") << "\"," << std::endl
+    << "  \"samples\": " << SAMPLES << "," << std::endl
+    << "  \"workloads\": [" << std::endl;
+
+  for (size_t i = 0; i < results.size(); i++) {
+    WorkloadResult const& result = results[i];
+    std::cout << "    { \"name\": \"" << result.name << "\""
+      << ", \"size\": " << result.size
+      << ", \"ms\": " << std::setprecision(3) << result.milliseconds
+      << ", \"peak_kb\": " << std::setprecision(1) << result.peakBytes / 1024.0
+      << ", \"gc_cycles\": " << result.gcCycles
+      << ", \"allocs\": " << result.allocations;
+    if (result.fieldCacheHitRate >= 0) {
+      std::cout << ", \"field_cache_hits\": " << std::setprecision(3) << result.fieldCacheHitRate;
+    }
+    std::cout << ", \"result\": " << std::setprecision(6) << result.result
+      << " }" << (i + 1 < results.size() ? "," : "") << std::endl;
+  }
+
+  std::cout << "  ]" << std::endl << "}" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  std::vector<std::string> workloads;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--lua-alloc" && i + 1 < argc) {
+      LuaAllocator::Mode allocatorMode = LuaAllocator::POOLED;
+      if (!LuaAllocator::parseMode(argv[++i], &allocatorMode)) {
+        std::cerr << "Unknown lua allocator " << argv[i] << std::endl;
+        return EXIT_FAILURE;
+      }
+      LuaAllocator::setMode(allocatorMode);
+    } else {
+      workloads.push_back(arg);
+    }
+  }
+
+  if (workloads.empty()) {
+    workloads.assign(WORKLOADS, WORKLOADS + sizeof(WORKLOADS) / sizeof(WORKLOADS[0]));
+  }
+
+  std::vector<WorkloadResult> results;
+
+  try {
+    for (size_t i = 0; i < workloads.size(); i++) {
+      std::cerr << workloads[i] << std::endl;
+      results.push_back(runWorkload(workloads[i]));
+    }
+  } catch (const std::exception& ex) {
+    std::cerr << "Runtime Error: " << ex.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  printResults(results);
+  return EXIT_SUCCESS;
+}
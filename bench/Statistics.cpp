@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "Statistics.hpp"
+
+namespace statistics {
+  double median(std::vector<double> values) {
+    if (values.empty()) {
+      return 0;
+    }
+
+    std::sort(values.begin(), values.end());
+    size_t middle = values.size() / 2;
+    if (values.size() % 2 == 0) {
+      return (values[middle - 1] + values[middle]) * 0.5;
+    }
+    return values[middle];
+  }
+
+  double percentile(std::vector<double> values, double fraction) {
+    if (values.empty()) {
+      return 0;
+    }
+
+    std::sort(values.begin(), values.end());
+    double rank = std::ceil(fraction * static_cast<double>(values.size()));
+    size_t index = rank < 1 ? 0 : static_cast<size_t>(rank) - 1;
+    return values[std::min(index, values.size() - 1)];
+  }
+
+  double mannWhitneyGreater(std::vector<double> const& a, std::vector<double> const& b) {
+    double countA = static_cast<double>(a.size());
+    double countB = static_cast<double>(b.size());
+    if (a.empty() || b.empty()) {
+      return 1;
+    }
+
+    // rank both samples together - second is true for values from b
+    std::vector<std::pair<double, bool> > values;
+    values.reserve(a.size() + b.size());
+    for (size_t i = 0; i < a.size(); i++) {
+      values.push_back(std::make_pair(a[i], false));
+    }
+    for (size_t i = 0; i < b.size(); i++) {
+      values.push_back(std::make_pair(b[i], true));
+    }
+    std::sort(values.begin(), values.end());
+
+    double rankSumB = 0;
+    double tieCorrection = 0;
+    size_t i = 0;
+    while (i < values.size()) {
+      size_t j = i;
+      while (j < values.size() && values[j].first == values[i].first) {
+        j++;
+      }
+
+      // ties share the average of their ranks
+      double ties = static_cast<double>(j - i);
+      double rank = (static_cast<double>(i + 1) + static_cast<double>(j)) * 0.5;
+      for (size_t k = i; k < j; k++) {
+        if (values[k].second) {
+          rankSumB += rank;
+        }
+      }
+      tieCorrection += ties * ties * ties - ties;
+      i = j;
+    }
+
+    double count = countA + countB;
+    double u = rankSumB - countB * (countB + 1) * 0.5;
+    double mean = countA * countB * 0.5;
+    double variance = countA * countB / 12.0 * ((count + 1) - tieCorrection / (count * (count - 1)));
+    if (variance <= 0) {
+      // every value is the same
+      return 1;
+    }
+
+    double z = (u - mean - 0.5) / std::sqrt(variance);
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+  }
+}
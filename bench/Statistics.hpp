@@ -0,0 +1,17 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <vector>
+
+namespace statistics {
+  double median(std::vector<double> values);
+
+  // nearest-rank percentile - fraction is between 0 and 1
+  double percentile(std::vector<double> values, double fraction);
+
+  // one-sided Mann-Whitney U test of whether the values in b tend to be larger than the values in a
+  // returns the p-value from the normal approximation (with tie and continuity corrections)
+  double mannWhitneyGreater(std::vector<double> const& a, std::vector<double> const& b);
+}
+
+#endif // !STATISTICS_H
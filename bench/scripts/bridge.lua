@@ -0,0 +1,75 @@
+-- bridge.lua
+-- script side of BridgeBench
+-- each bench function makes its call n times, where n arrives as the update argument
+
+local entity = 0
+
+function benchCreate()
+  entity = engine:createEntity()
+  engine:setPosition(entity, 1, 2)
+end
+
+function benchDestroy()
+end
+
+function benchUpdate(deltaTimeInSeconds)
+end
+
+function benchRender()
+end
+
+function benchLoop(n)
+  for i = 1, n do
+  end
+end
+
+function benchGetScreenWidth(n)
+  for i = 1, n do
+    engine:getScreenWidth()
+  end
+end
+
+function benchDrawCircle(n)
+  for i = 1, n do
+    engine:drawCircle(1, 2, 3)
+  end
+end
+
+function benchIsEntityAlive(n)
+  for i = 1, n do
+    engine:isEntityAlive(entity)
+  end
+end
+
+function benchSetPosition(n)
+  for i = 1, n do
+    engine:setPosition(entity, 1.5, 2.5)
+  end
+end
+
+function benchGetPositionX(n)
+  for i = 1, n do
+    engine:getPositionX(entity)
+  end
+end
+
+function benchUnregisterSystem(n)
+  for i = 1, n do
+    engine:unregisterSystem("render")
+  end
+end
+
+function benchArgumentError(n)
+  local drawCircle = engine.drawCircle
+  for i = 1, n do
+    pcall(drawCircle, engine, "x", 2, 3)
+  end
+end
+
+engine:init({
+  DEBUG = false,
+  create = "benchCreate",
+  destroy = "benchDestroy",
+  update = "benchUpdate",
+  render = "benchRender"
+})
@@ -0,0 +1,64 @@
+# bridge.py
+# script side of BridgeBench
+# each bench function makes its call n times, where n arrives as the update argument
+
+import engine
+
+entity = 0
+
+def benchCreate():
+  global entity
+  entity = engine.createEntity()
+  engine.setPosition(entity, 1, 2)
+
+def benchDestroy():
+  pass
+
+def benchUpdate(deltaTimeInSeconds):
+  pass
+
+def benchRender():
+  pass
+
+def benchLoop(n):
+  for i in range(int(n)):
+    pass
+
+def benchGetScreenWidth(n):
+  for i in range(int(n)):
+    engine.getScreenWidth()
+
+def benchDrawCircle(n):
+  for i in range(int(n)):
+    engine.drawCircle(1, 2, 3)
+
+def benchIsEntityAlive(n):
+  for i in range(int(n)):
+    engine.isEntityAlive(entity)
+
+def benchSetPosition(n):
+  for i in range(int(n)):
+    engine.setPosition(entity, 1.5, 2.5)
+
+def benchGetPositionX(n):
+  for i in range(int(n)):
+    engine.getPositionX(entity)
+
+def benchUnregisterSystem(n):
+  for i in range(int(n)):
+    engine.unregisterSystem('render')
+
+def benchArgumentError(n):
+  for i in range(int(n)):
+    try:
+      engine.drawCircle('x', 2, 3)
+    except TypeError:
+      pass
+
+engine.init({
+  'DEBUG': False,
+  'create': 'benchCreate',
+  'destroy': 'benchDestroy',
+  'update': 'benchUpdate',
+  'render': 'benchRender'
+})
@@ -0,0 +1,77 @@
+# bridge.rb
+# script side of BridgeBench
+# each bench function makes its call n times, where n arrives as the update argument
+
+$entity = 0
+
+def benchCreate
+  $entity = Engine::createEntity()
+  Engine::setPosition($entity, 1, 2)
+end
+
+def benchDestroy
+end
+
+def benchUpdate(deltaTimeInSeconds)
+end
+
+def benchRender
+end
+
+def benchLoop(n)
+  n.to_i.times do
+  end
+end
+
+def benchGetScreenWidth(n)
+  n.to_i.times do
+    Engine::getScreenWidth()
+  end
+end
+
+def benchDrawCircle(n)
+  n.to_i.times do
+    Engine::drawCircle(1, 2, 3)
+  end
+end
+
+def benchIsEntityAlive(n)
+  n.to_i.times do
+    Engine::isEntityAlive($entity)
+  end
+end
+
+def benchSetPosition(n)
+  n.to_i.times do
+    Engine::setPosition($entity, 1.5, 2.5)
+  end
+end
+
+def benchGetPositionX(n)
+  n.to_i.times do
+    Engine::getPositionX($entity)
+  end
+end
+
+def benchUnregisterSystem(n)
+  n.to_i.times do
+    Engine::unregisterSystem('render')
+  end
+end
+
+def benchArgumentError(n)
+  n.to_i.times do
+    begin
+      Engine::drawCircle('x', 2, 3)
+    rescue TypeError
+    end
+  end
+end
+
+Engine::init({
+  :DEBUG => false,
+  :create => 'benchCreate',
+  :destroy => 'benchDestroy',
+  :update => 'benchUpdate',
+  :render => 'benchRender'
+})
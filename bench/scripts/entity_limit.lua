@@ -0,0 +1,55 @@
+-- entity_limit.lua
+-- fills the native entity store from the script and checks that it recovers: createEntity returns -1
+-- once the store is full, and a destroyed entity's slot can be taken again
+-- run with: FrameBench entity_limit.lua --frames 1 --warmup 0 (exits with 3 when a check fails)
+
+local MAX_ENTITIES = 1048576
+
+local function check(condition, message)
+  if not condition then
+    io.stderr:write("entity_limit.lua: ", message, "\n")
+    os.exit(3)
+  end
+end
+
+function limitCreate()
+  local entities = {}
+  for i = 1, MAX_ENTITIES do
+    entities[i] = engine:createEntity()
+    check(entities[i] >= 0, "the store filled up after " .. (i - 1) .. " entities")
+  end
+  check(engine:getEntityCount() == MAX_ENTITIES, "the store does not hold every entity")
+
+  -- full: the script gets an invalid handle instead of an error
+  local ok, entity = pcall(function() return engine:createEntity() end)
+  check(ok, "createEntity raised an error on a full store: " .. tostring(entity))
+  check(entity == -1, "createEntity returned " .. tostring(entity) .. " on a full store")
+  check(not engine:isEntityAlive(entity), "the invalid handle is alive")
+
+  -- a freed slot is taken again
+  engine:destroyEntity(entities[1])
+  entities[1] = engine:createEntity()
+  check(entities[1] >= 0, "no entity after one was destroyed")
+
+  for i = 1, #entities do
+    engine:destroyEntity(entities[i])
+  end
+  check(engine:getEntityCount() == 0, "entities left after destroying them all")
+end
+
+function limitDestroy()
+end
+
+function limitUpdate(deltaTimeInSeconds)
+end
+
+function limitRender()
+end
+
+engine:init({
+  DEBUG = false,
+  create = "limitCreate",
+  destroy = "limitDestroy",
+  update = "limitUpdate",
+  render = "limitRender"
+})
@@ -0,0 +1,37 @@
+-- binary-trees
+-- allocates and walks many short lived trees next to one long lived tree
+
+local function bottomUpTree(depth)
+  if depth > 0 then
+    depth = depth - 1
+    return { bottomUpTree(depth), bottomUpTree(depth) }
+  end
+  return {}
+end
+
+local function itemCheck(tree)
+  if tree[1] then
+    return 1 + itemCheck(tree[1]) + itemCheck(tree[2])
+  end
+  return 1
+end
+
+return {
+  size = 12,
+  run = function(n)
+    local minDepth = 4
+    local maxDepth = math.max(minDepth + 2, n)
+
+    local check = itemCheck(bottomUpTree(maxDepth + 1))
+    local longLived = bottomUpTree(maxDepth)
+
+    for depth = minDepth, maxDepth, 2 do
+      local iterations = 1 << (maxDepth - depth + minDepth)
+      for i = 1, iterations do
+        check = check + itemCheck(bottomUpTree(depth))
+      end
+    end
+
+    return check + itemCheck(longLived)
+  end
+}
@@ -0,0 +1,29 @@
+-- gc churn
+-- short lived tables, closures and strings with a ring of survivors so the collector has real work
+
+return {
+  size = 300000,
+  run = function(n)
+    local ring = {}
+    local ringSize = 4096
+    local total = 0
+
+    for i = 1, n do
+      local object = { id = i, name = "object" .. (i % 1000) }
+      object.get = function() return object.id end
+      ring[(i % ringSize) + 1] = object
+      if ring[((i * 31) % ringSize) + 1] then
+        total = total + 1
+      end
+    end
+
+    for i = 1, ringSize do
+      local object = ring[i]
+      if object then
+        total = total + object.get()
+      end
+    end
+
+    return total
+  end
+}
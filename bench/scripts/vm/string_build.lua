@@ -0,0 +1,25 @@
+-- string building
+-- concatenation, table.concat, string.format and pattern matching on short strings
+
+return {
+  size = 200000,
+  run = function(n)
+    local parts = {}
+    for i = 1, n do
+      parts[#parts + 1] = string.format("%d:%s", i, "entity")
+    end
+    local joined = table.concat(parts, ",")
+
+    local count = 0
+    for key in joined:gmatch("(%d+):entity") do
+      count = count + #key
+    end
+
+    local text = ""
+    for i = 1, n // 100 do
+      text = text .. "x" .. i
+    end
+
+    return count + #joined + #text
+  end
+}
@@ -0,0 +1,42 @@
+-- table heavy
+-- array growth, hash inserts and lookups, removal and rehashing
+
+return {
+  size = 200000,
+  run = function(n)
+    local array = {}
+    for i = 1, n do
+      array[i] = i
+    end
+
+    local hash = {}
+    for i = 1, n do
+      hash["key" .. (i % 5000)] = i
+      hash[i * 7] = i
+    end
+
+    local sum = 0
+    for i = 1, n do
+      sum = sum + (hash[i * 7] or 0) + array[i]
+    end
+
+    for i = 1, n, 2 do
+      hash[i * 7] = nil
+    end
+
+    local queue = {}
+    for i = 1, n // 10 do
+      table.insert(queue, i)
+      if #queue > 64 then
+        sum = sum + table.remove(queue, 1)
+      end
+    end
+
+    local count = 0
+    for _ in pairs(hash) do
+      count = count + 1
+    end
+
+    return sum + count
+  end
+}
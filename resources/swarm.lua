@@ -0,0 +1,66 @@
+-- swarm.lua
+-- thousands of bouncing balls owned by the engine's native entity store
+-- the engine moves, bounces and draws them - the script only sets things up
+-- run with: ./game swarm.lua
+
+local BALL_COUNT = 10000
+
+local balls = {}
+local collisions = nil
+local wallHits = 0
+
+function swarmCreate()
+  local screenWidth = engine:getScreenWidth()
+  local screenHeight = engine:getScreenHeight()
+
+  engine:setWorldBounds(0, 0, screenWidth, screenHeight)
+
+  for i = 1, BALL_COUNT do
+    local radius = math.random(2, 6)
+    local speed = math.random(64, 256)
+    local angle = math.random() * math.pi * 2
+
+    local ball = engine:createEntity()
+    engine:setPosition(ball, math.random(radius + 1, screenWidth - radius - 1), math.random(radius + 1, screenHeight - radius - 1))
+    engine:setVelocity(ball, math.cos(angle) * speed, math.sin(angle) * speed)
+    engine:setCircle(ball, radius)
+    balls[i] = ball
+  end
+
+  -- room for every ball to hit a wall in the same frame - two values per hit
+  collisions = engine:createBuffer("int32", BALL_COUNT * 2)
+
+  engine:setKinematics(1, "reflect")
+  engine:registerSystem("movement")
+  engine:registerSystem("bounce")
+  engine:registerSystem("render")
+end
+
+function swarmDestroy()
+  for i = 1, #balls do
+    engine:destroyEntity(balls[i])
+  end
+  balls = {}
+end
+
+function swarmUpdate(deltaTimeInSeconds)
+  -- logic that doesn't fit a native system goes here
+  -- the bounce system hands back the balls that hit a wall during the previous update as a batch
+  local count = engine:readCollisions(collisions)
+  wallHits = wallHits + count
+end
+
+function swarmRender()
+end
+
+engine:init({
+  DEBUG = false,
+  SCREEN_WIDTH = 1920 / 2,
+  SCREEN_HEIGHT = 1080 / 2,
+  USE_FULLSCREEN = false,
+  WINDOW_TITLE = "Lua Swarm Demo",
+  create = "swarmCreate",
+  destroy = "swarmDestroy",
+  update = "swarmUpdate",
+  render = "swarmRender"
+})
@@ -0,0 +1,257 @@
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+
+#if (defined(TRACK_ALLOCATIONS) || defined(COUNT_ALLOCATIONS)) && defined(__GLIBC__)
+#define ALLOCATION_INTERPOSERS
+#endif
+
+#if defined(TRACK_ALLOCATIONS) && defined(ALLOCATION_INTERPOSERS)
+#include <execinfo.h>
+#include <unistd.h>
+#define ALLOCATION_PHASES
+#endif
+
+#include "AllocationTracker.hpp"
+
+namespace allocationTracker {
+  namespace {
+    // frames of the stack printed with a violation
+    const int MAX_STACK_DEPTH = 48;
+    const unsigned long long NEVER = ~0ull;
+
+    const char* PHASE_NAMES[PHASE_COUNT] = { "outside", "reload", "update", "render", "idle_gc", "present", "events" };
+
+    // the interposers run before any constructor does, so everything they touch is constant initialized
+    std::atomic<unsigned long long> totalCount(0);
+    std::atomic<unsigned long long> frameCounts[PHASE_COUNT];
+    std::atomic<bool> allocationFree[PHASE_COUNT];
+    std::atomic<int> currentPolicy(LOG);
+    // frames ended so far and the first one that is checked
+    std::atomic<unsigned long long> frame(0);
+    std::atomic<unsigned long long> checkFrom(NEVER);
+    std::atomic<unsigned long long> violations(0);
+
+    thread_local Phase threadPhase = OUTSIDE;
+
+    // the game thread's - endFrame and getReport
+    Report totals;
+
+    #ifdef ALLOCATION_PHASES
+    // the report's own allocations (backtrace loads libgcc the first time) are not checked
+    thread_local bool reporting = false;
+    thread_local unsigned long long reportedFrame = NEVER;
+
+    // not inlined, so the stack trace can skip it
+    __attribute__((noinline)) void reportViolation(Phase phase, size_t size) {
+      violations.fetch_add(1, std::memory_order_relaxed);
+
+      unsigned long long current = frame.load(std::memory_order_relaxed);
+      bool aborting = currentPolicy.load(std::memory_order_relaxed) == ABORT;
+      if (reportedFrame == current && !aborting) {
+        return;
+      }
+      reportedFrame = current;
+      reporting = true;
+
+      std::fprintf(stderr, "Allocation of %zu bytes in the allocation free %s phase of frame %llu:\n", size, PHASE_NAMES[phase], current);
+      void* stack[MAX_STACK_DEPTH];
+      int depth = backtrace(stack, MAX_STACK_DEPTH);
+      // the first frame is this function - counted calls it last, so it is usually gone already
+      backtrace_symbols_fd(stack + 1, depth > 1 ? depth - 1 : 0, STDERR_FILENO);
+      std::fflush(stderr);
+
+      reporting = false;
+      if (aborting) {
+        std::abort();
+      }
+    }
+    #endif
+
+    #ifdef ALLOCATION_INTERPOSERS
+    void counted(size_t size) {
+      totalCount.fetch_add(1, std::memory_order_relaxed);
+
+      #ifdef ALLOCATION_PHASES
+      Phase phase = threadPhase;
+      frameCounts[phase].fetch_add(1, std::memory_order_relaxed);
+
+      if (allocationFree[phase].load(std::memory_order_relaxed) && !reporting
+        && frame.load(std::memory_order_relaxed) >= checkFrom.load(std::memory_order_relaxed)) {
+        reportViolation(phase, size);
+      }
+      #else
+      (void)size;
+      #endif
+    }
+    #endif
+  }
+
+  const char* phaseName(Phase phase) {
+    return PHASE_NAMES[phase];
+  }
+
+  bool parsePhase(std::string const& name, Phase* phase) {
+    for (int i = 0; i < PHASE_COUNT; i++) {
+      if (name == PHASE_NAMES[i]) {
+        *phase = static_cast<Phase>(i);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool parsePhaseList(std::string const& names, bool phases[PHASE_COUNT]) {
+    size_t start = 0;
+    while (start <= names.size()) {
+      size_t end = names.find(',', start);
+      if (end == std::string::npos) {
+        end = names.size();
+      }
+
+      Phase phase = OUTSIDE;
+      if (!parsePhase(names.substr(start, end - start), &phase)) {
+        return false;
+      }
+      phases[phase] = true;
+      start = end + 1;
+    }
+    return true;
+  }
+
+  bool isCounting() {
+    #ifdef ALLOCATION_INTERPOSERS
+    return true;
+    #else
+    return false;
+    #endif
+  }
+
+  bool isTracking() {
+    #ifdef ALLOCATION_PHASES
+    return true;
+    #else
+    return false;
+    #endif
+  }
+
+  Phase setPhase(Phase phase) {
+    Phase previous = threadPhase;
+    threadPhase = phase;
+    return previous;
+  }
+
+  void setAllocationFree(Phase phase, bool isFree) {
+    allocationFree[phase].store(isFree);
+  }
+
+  void setPolicy(Policy policy) {
+    currentPolicy.store(policy);
+  }
+
+  void startChecking(unsigned long long afterFrames) {
+    checkFrom.store(frame.load() + afterFrames);
+  }
+
+  void stopChecking() {
+    checkFrom.store(NEVER);
+  }
+
+  unsigned long long count() {
+    return totalCount.load(std::memory_order_relaxed);
+  }
+
+  void endFrame() {
+    totals.frames++;
+    for (int i = 0; i < PHASE_COUNT; i++) {
+      unsigned long long allocations = frameCounts[i].exchange(0, std::memory_order_relaxed);
+      PhaseReport& phase = totals.phases[i];
+      phase.allocations += allocations;
+      if (allocations > phase.maxPerFrame) {
+        phase.maxPerFrame = allocations;
+      }
+      if (allocations > 0) {
+        phase.frames++;
+      }
+    }
+    frame.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  Report getReport() {
+    Report report = totals;
+    report.violations = violations.load();
+    return report;
+  }
+
+  void printReport(std::ostream& out) {
+    Report report = getReport();
+
+    out << "Allocations over " << report.frames << " frames:" << std::endl
+      << "  " << std::left << std::setw(10) << "phase" << std::right
+      << std::setw(12) << "total" << std::setw(12) << "per frame" << std::setw(12) << "max" << std::setw(12) << "frames" << std::endl;
+
+    for (int i = 0; i < PHASE_COUNT; i++) {
+      PhaseReport const& phase = report.phases[i];
+      double perFrame = report.frames > 0 ? static_cast<double>(phase.allocations) / report.frames : 0;
+      out << "  " << std::left << std::setw(10) << PHASE_NAMES[i] << std::right
+        << std::setw(12) << phase.allocations
+        << std::setw(12) << std::fixed << std::setprecision(2) << perFrame
+        << std::setw(12) << phase.maxPerFrame
+        << std::setw(12) << phase.frames
+        << (allocationFree[i].load() ? "  allocation free" : "") << std::endl;
+    }
+    out << "  violations: " << report.violations << std::endl;
+  }
+}
+
+#ifdef ALLOCATION_INTERPOSERS
+// the real allocator stays reachable under these names. operator new goes through malloc
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* pointer, size_t size);
+extern "C" void* __libc_memalign(size_t alignment, size_t size);
+
+extern "C" void* malloc(size_t size) noexcept {
+  allocationTracker::counted(size);
+  return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) noexcept {
+  allocationTracker::counted(count * size);
+  return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) noexcept {
+  // realloc to zero is a free
+  if (size != 0) {
+    allocationTracker::counted(size);
+  }
+  return __libc_realloc(pointer, size);
+}
+
+extern "C" void* memalign(size_t alignment, size_t size) noexcept {
+  allocationTracker::counted(size);
+  return __libc_memalign(alignment, size);
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size) noexcept {
+  allocationTracker::counted(size);
+  return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void** pointer, size_t alignment, size_t size) noexcept {
+  if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) {
+    return EINVAL;
+  }
+  allocationTracker::counted(size);
+  void* block = __libc_memalign(alignment, size);
+  if (block == nullptr) {
+    return ENOMEM;
+  }
+  *pointer = block;
+  return 0;
+}
+#endif
@@ -0,0 +1,111 @@
+#ifndef ALLOCATIONTRACKER_H
+#define ALLOCATIONTRACKER_H
+
+#include <ostream>
+#include <string>
+
+// counts heap allocations by the phase of the frame they happen in, and reports the ones made in
+// phases marked allocation free - to keep the steady state frame from allocating
+//
+//   ALLOCATION_PHASE(UPDATE);     // allocations from here to the end of the scope count as update
+//   ALLOCATION_END_FRAME();       // once per frame, on the game thread
+//
+// builds with -DTRACK_ALLOCATIONS interpose malloc, calloc, realloc, posix_memalign, memalign and
+// aligned_alloc on glibc - operator new goes through malloc, so it is counted as well. builds with
+// -DCOUNT_ALLOCATIONS (the bench programs) have the same interposers but only keep count(), without
+// phases or checks. other builds compile the macros to nothing and isCounting() and isTracking()
+// return false. python serves most small objects from its own pools, so only its requests that
+// reach malloc are counted. the phase belongs to the thread
+// that sets it: Game marks the game thread's phases and ThreadedScriptingEngine the script
+// thread's. allocations of other threads (job workers, the watchdog, the profiler's timer) count
+// as OUTSIDE
+//
+// once checking started, an allocation in an allocation free phase is a violation: it is printed
+// with a stack trace (the first one of each thread in a frame) and with the ABORT policy the
+// process aborts right there, so a debugger or core dump shows the whole stack
+namespace allocationTracker {
+  enum Phase {
+    OUTSIDE,
+    RELOAD,
+    UPDATE,
+    RENDER,
+    IDLE_GC,
+    PRESENT,
+    EVENTS,
+    PHASE_COUNT
+  };
+
+  enum Policy {
+    LOG,
+    ABORT
+  };
+
+  // "update", "render", ...
+  const char* phaseName(Phase phase);
+  bool parsePhase(std::string const& name, Phase* phase);
+  // sets the phases of a comma separated list of names
+  bool parsePhaseList(std::string const& names, bool phases[PHASE_COUNT]);
+
+  // the interposers are built in - count() counts
+  bool isCounting();
+  // and they count by phase and check the allocation free ones (TRACK_ALLOCATIONS)
+  bool isTracking();
+
+  // the calling thread's phase - returns the previous one
+  Phase setPhase(Phase phase);
+
+  void setAllocationFree(Phase phase, bool isFree);
+  // LOG by default
+  void setPolicy(Policy policy);
+  // violations count once afterFrames more frames have ended - scripts allocate while they warm up
+  void startChecking(unsigned long long afterFrames);
+  void stopChecking();
+
+  // allocation calls of every thread since the program started
+  unsigned long long count();
+
+  // closes the frame's counts
+  void endFrame();
+
+  struct PhaseReport {
+    unsigned long long allocations;
+    // the most allocations of a frame
+    unsigned long long maxPerFrame;
+    // frames with allocations in the phase
+    unsigned long long frames;
+  };
+
+  struct Report {
+    unsigned long long frames;
+    unsigned long long violations;
+    PhaseReport phases[PHASE_COUNT];
+  };
+
+  Report getReport();
+  void printReport(std::ostream& out);
+
+  class PhaseScope {
+    public:
+      explicit PhaseScope(Phase phase) : previous(setPhase(phase)) {}
+      ~PhaseScope() { setPhase(previous); }
+
+    private:
+      PhaseScope(PhaseScope const&);
+      PhaseScope& operator=(PhaseScope const&);
+
+      Phase previous;
+  };
+}
+
+#define ALLOCATION_CONCAT_INNER(a, b) a##b
+#define ALLOCATION_CONCAT(a, b) ALLOCATION_CONCAT_INNER(a, b)
+
+#ifdef TRACK_ALLOCATIONS
+#define ALLOCATION_PHASE(phase) allocationTracker::PhaseScope ALLOCATION_CONCAT(allocationPhase, __LINE__)(allocationTracker::phase)
+#define ALLOCATION_END_FRAME() allocationTracker::endFrame()
+#else
+#define ALLOCATION_PHASE(phase) ((void)0)
+#define ALLOCATION_END_FRAME() ((void)0)
+#endif
+
+#endif // !ALLOCATIONTRACKER_H
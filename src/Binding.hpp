@@ -0,0 +1,51 @@
+#ifndef BINDING_H
+#define BINDING_H
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+// language neutral part of the scripting bindings
+// a native function is declared once as a plain C++ function and LuaBinding, PythonBinding and RubyBinding
+// generate the argument unmarshalling for each language at compile time from its signature
+
+class NumericBuffer;
+
+namespace binding {
+  // the C++ types a bound function may take as arguments
+  template <typename T> struct IsArgument : std::false_type {};
+  template <> struct IsArgument<int> : std::true_type {};
+  template <> struct IsArgument<float> : std::true_type {};
+  template <> struct IsArgument<double> : std::true_type {};
+  template <> struct IsArgument<bool> : std::true_type {};
+  template <> struct IsArgument<const char*> : std::true_type {};
+  template <> struct IsArgument<NumericBuffer*> : std::true_type {};
+
+  // the C++ types a bound function may return
+  template <typename T> struct IsResult : IsArgument<T> {};
+  template <> struct IsResult<void> : std::true_type {};
+  template <> struct IsResult<NumericBuffer*> : std::false_type {};
+
+  template <bool... Values> struct All;
+  template <> struct All<> : std::true_type {};
+  template <bool Value, bool... Values> struct All<Value, Values...> : std::integral_constant<bool, Value && All<Values...>::value> {};
+
+  // maps any argument type to a fixed type - used to expand one parameter per bound argument
+  template <typename T, typename To> struct Repeat {
+    typedef To type;
+  };
+
+  template <typename Fn> struct Signature;
+
+  template <typename R, typename... Args>
+  struct Signature<R (*)(Args...)> {
+    static_assert(All<IsArgument<Args>::value...>::value, "bound function has an argument type the script bindings cannot convert");
+    static_assert(IsResult<R>::value, "bound function has a return type the script bindings cannot convert");
+
+    typedef R Result;
+    typedef std::index_sequence_for<Args...> Indices;
+    static constexpr int arity = static_cast<int>(sizeof...(Args));
+  };
+}
+
+#endif // !BINDING_H
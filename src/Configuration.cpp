@@ -13,6 +13,11 @@ Configuration::Configuration() {
   screenHeight = 480;
   useFullscreen = false;
   debugMode = true;
+  hotReload = false;
+  idleGc = false;
+  targetFps = 60;
+  hookBudgetMilliseconds = 0;
+  jobWorkers = 0;
   windowTitle = "Lua Game Scripting Engine v1.0";
   userCreateFunctionName = "create";
   userDestroyFunctionName = "destroy";
@@ -25,6 +30,11 @@ void Configuration::copy(Configuration& other) {
   screenHeight = other.screenHeight;
   useFullscreen = other.useFullscreen;
   debugMode = other.debugMode;
+  hotReload = other.hotReload;
+  idleGc = other.idleGc;
+  targetFps = other.targetFps;
+  hookBudgetMilliseconds = other.hookBudgetMilliseconds;
+  jobWorkers = other.jobWorkers;
   windowTitle = other.windowTitle;
   userCreateFunctionName = other.userCreateFunctionName;
   userDestroyFunctionName = other.userDestroyFunctionName;
@@ -38,6 +48,11 @@ void Configuration::print() {
     << "SCREEN_HEIGHT: " << screenHeight << std::endl
     << "USE_FULLSCREEN: " << (useFullscreen ? "True" : "False") << std::endl
     << "DEBUG: " << (debugMode ? "True" : "False") << std::endl
+    << "HOT_RELOAD: " << (hotReload ? "True" : "False") << std::endl
+    << "IDLE_GC: " << (idleGc ? "True" : "False") << std::endl
+    << "TARGET_FPS: " << targetFps << std::endl
+    << "HOOK_BUDGET_MS: " << hookBudgetMilliseconds << std::endl
+    << "JOB_WORKERS: " << jobWorkers << std::endl
     << "WINDOW_TITLE: " << windowTitle << std::endl
     << "create: " << userCreateFunctionName << std::endl
     << "destroy: " << userDestroyFunctionName << std::endl
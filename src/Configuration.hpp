@@ -8,6 +8,11 @@ struct Configuration {
   int screenHeight;
   bool useFullscreen;
   bool debugMode;
+  bool hotReload;
+  bool idleGc;
+  int targetFps;
+  int hookBudgetMilliseconds;
+  int jobWorkers;
   std::string windowTitle;
   std::string userCreateFunctionName;
   std::string userDestroyFunctionName;
@@ -0,0 +1,35 @@
+#include "DrawQueue.hpp"
+
+DrawQueue::DrawQueue(size_t capacity)
+  : mask(0),
+    head(0),
+    tail(0) {
+  size_t size = 1;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  commands.resize(size);
+  mask = size - 1;
+}
+
+bool DrawQueue::push(Command const& command) {
+  size_t index = tail.load(std::memory_order_relaxed);
+  if (index - head.load(std::memory_order_acquire) == commands.size()) {
+    return false;
+  }
+
+  commands[index & mask] = command;
+  tail.store(index + 1, std::memory_order_release);
+  return true;
+}
+
+bool DrawQueue::pop(Command& command) {
+  size_t index = head.load(std::memory_order_relaxed);
+  if (index == tail.load(std::memory_order_acquire)) {
+    return false;
+  }
+
+  command = commands[index & mask];
+  head.store(index + 1, std::memory_order_release);
+  return true;
+}
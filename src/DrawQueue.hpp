@@ -0,0 +1,46 @@
+#ifndef DRAWQUEUE_H
+#define DRAWQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// fixed size ring of draw commands between one producing and one consuming thread - the script
+// thread records its frames into it and the main thread replays them (see ThreadedScriptingEngine.hpp).
+// push and pop take no locks: each side owns one index and only reads the other's
+class DrawQueue {
+  public:
+    struct Command {
+      enum Type { CIRCLE, END_FRAME };
+
+      Type type;
+      int x;
+      int y;
+      int radius;
+    };
+
+    // the capacity is rounded up to a power of two
+    explicit DrawQueue(size_t capacity);
+
+    // producer side - returns false when the queue is full
+    bool push(Command const& command);
+    // consumer side - returns false when the queue is empty
+    bool pop(Command& command);
+
+  private:
+    DrawQueue(DrawQueue const&);
+    DrawQueue& operator=(DrawQueue const&);
+
+    static const size_t CACHE_LINE = 64;
+
+    std::vector<Command> commands;
+    size_t mask;
+
+    // the indices only grow - each is written by one side and kept off the other's cache line
+    std::atomic<size_t> head;
+    char headPadding[CACHE_LINE - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> tail;
+    char tailPadding[CACHE_LINE - sizeof(std::atomic<size_t>)];
+};
+
+#endif // !DRAWQUEUE_H
@@ -0,0 +1,159 @@
+#include <algorithm>
+
+#include "EngineApi.hpp"
+#include "EntityStore.hpp"
+#include "NumericBuffer.hpp"
+#include "ScriptingEngine.hpp"
+#include "SharedContext.hpp"
+#include "Trace.hpp"
+
+namespace engine {
+  namespace native {
+    int getScreenWidth() {
+      TRACE_ZONE("native.getScreenWidth");
+      return SharedContext::instance->scripting->getScreenWidth();
+    }
+
+    int getScreenHeight() {
+      TRACE_ZONE("native.getScreenHeight");
+      return SharedContext::instance->scripting->getScreenHeight();
+    }
+
+    void drawCircle(int x, int y, int radius) {
+      TRACE_ZONE("native.drawCircle");
+      SharedContext::instance->scripting->drawCircle(x, y, radius);
+    }
+
+    int createEntity() {
+      TRACE_ZONE("native.createEntity");
+      return SharedContext::instance->world->create();
+    }
+
+    void destroyEntity(int entity) {
+      TRACE_ZONE("native.destroyEntity");
+      SharedContext::instance->world->destroy(entity);
+    }
+
+    bool isEntityAlive(int entity) {
+      TRACE_ZONE("native.isEntityAlive");
+      return SharedContext::instance->world->isAlive(entity);
+    }
+
+    int getEntityCount() {
+      TRACE_ZONE("native.getEntityCount");
+      return static_cast<int>(SharedContext::instance->world->size());
+    }
+
+    void setPosition(int entity, float x, float y) {
+      TRACE_ZONE("native.setPosition");
+      SharedContext::instance->world->setPosition(entity, x, y);
+    }
+
+    float getPositionX(int entity) {
+      TRACE_ZONE("native.getPositionX");
+      return SharedContext::instance->world->getPositionX(entity);
+    }
+
+    float getPositionY(int entity) {
+      TRACE_ZONE("native.getPositionY");
+      return SharedContext::instance->world->getPositionY(entity);
+    }
+
+    void setVelocity(int entity, float vx, float vy) {
+      TRACE_ZONE("native.setVelocity");
+      SharedContext::instance->world->setVelocity(entity, vx, vy);
+    }
+
+    float getVelocityX(int entity) {
+      TRACE_ZONE("native.getVelocityX");
+      return SharedContext::instance->world->getVelocityX(entity);
+    }
+
+    float getVelocityY(int entity) {
+      TRACE_ZONE("native.getVelocityY");
+      return SharedContext::instance->world->getVelocityY(entity);
+    }
+
+    void setCircle(int entity, float radius) {
+      TRACE_ZONE("native.setCircle");
+      SharedContext::instance->world->setCircle(entity, radius);
+    }
+
+    void setWorldBounds(float left, float top, float right, float bottom) {
+      TRACE_ZONE("native.setWorldBounds");
+      SharedContext::instance->world->setBounds(left, top, right, bottom);
+    }
+
+    bool registerSystem(const char* name) {
+      TRACE_ZONE("native.registerSystem");
+      EntityStore::System system;
+      if (!EntityStore::parseSystem(name, &system)) {
+        return false;
+      }
+      SharedContext::instance->world->enableSystem(system, true);
+      return true;
+    }
+
+    bool unregisterSystem(const char* name) {
+      TRACE_ZONE("native.unregisterSystem");
+      EntityStore::System system;
+      if (!EntityStore::parseSystem(name, &system)) {
+        return false;
+      }
+      SharedContext::instance->world->enableSystem(system, false);
+      return true;
+    }
+
+    bool setKinematics(float speed, const char* response) {
+      TRACE_ZONE("native.setKinematics");
+      kinematics::Response parsed;
+      if (!kinematics::parseResponse(response, &parsed)) {
+        return false;
+      }
+      SharedContext::instance->world->setKinematics(speed, parsed);
+      return true;
+    }
+
+    int getCollisionCount() {
+      TRACE_ZONE("native.getCollisionCount");
+      return static_cast<int>(SharedContext::instance->world->getCollisions().size());
+    }
+
+    int readCollisions(NumericBuffer* out) {
+      TRACE_ZONE("native.readCollisions");
+      int32_t* data = out->int32();
+      if (!data) {
+        return -1;
+      }
+
+      // two values per collision: the entity handle and its AXIS_X / AXIS_Y bits
+      std::vector<kinematics::Collision> const& collisions = SharedContext::instance->world->getCollisions();
+      size_t count = std::min(collisions.size(), out->size() / 2);
+      for (size_t i = 0; i < count; i++) {
+        data[i * 2] = static_cast<int32_t>(collisions[i].index);
+        data[i * 2 + 1] = static_cast<int32_t>(collisions[i].axes);
+      }
+      return static_cast<int>(count);
+    }
+
+    void traceBegin(const char* name) {
+      #ifdef ENABLE_TRACING
+      trace::beginCopy(name);
+      #else
+      (void)name;
+      #endif
+    }
+
+    void traceEnd() {
+      TRACE_END();
+    }
+
+    bool profile(bool enabled) {
+      return SharedContext::instance->scripting->setProfiling(enabled);
+    }
+
+    bool shouldYield() {
+      return SharedContext::instance->scripting->shouldYield();
+    }
+  }
+}
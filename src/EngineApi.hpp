@@ -0,0 +1,79 @@
+#ifndef ENGINEAPI_H
+#define ENGINEAPI_H
+
+// native engine functions shared by every scripting language
+// each function is declared once here and bound to lua, python and ruby by the glue generated in
+// LuaBinding.hpp, PythonBinding.hpp and RubyBinding.hpp - the argument and return types must be
+// ones listed in Binding.hpp (the bindings refuse to compile otherwise)
+//
+// to add a function declare it below, implement it in EngineApi.cpp and add it to ENGINE_NATIVE_API
+
+class NumericBuffer;
+
+namespace engine {
+  namespace native {
+    int getScreenWidth();
+    int getScreenHeight();
+    void drawCircle(int x, int y, int radius);
+
+    // entity-component store - see EntityStore.hpp
+    int createEntity();
+    void destroyEntity(int entity);
+    bool isEntityAlive(int entity);
+    int getEntityCount();
+    void setPosition(int entity, float x, float y);
+    float getPositionX(int entity);
+    float getPositionY(int entity);
+    void setVelocity(int entity, float vx, float vy);
+    float getVelocityX(int entity);
+    float getVelocityY(int entity);
+    void setCircle(int entity, float radius);
+    void setWorldBounds(float left, float top, float right, float bottom);
+    bool registerSystem(const char* name);
+    bool unregisterSystem(const char* name);
+
+    // kinematics kernel behind the movement / bounce systems - see Kinematics.hpp
+    bool setKinematics(float speed, const char* response);
+    int getCollisionCount();
+    int readCollisions(NumericBuffer* out);
+
+    // script zones on the trace timeline - see Trace.hpp. no-ops unless built with ENABLE_TRACING
+    void traceBegin(const char* name);
+    void traceEnd();
+
+    // script profiler - see Profile.hpp. stopping writes the profile
+    bool profile(bool enabled);
+
+    // hook budget - see HookWatchdog.hpp. true once the running hook used half of HOOK_BUDGET_MS
+    bool shouldYield();
+  }
+}
+
+// X(name, description) for each native function
+#define ENGINE_NATIVE_API(X) \
+  X(getScreenWidth, "get the width of the screen") \
+  X(getScreenHeight, "get the height of the screen") \
+  X(drawCircle, "draw a filled circle given center x and y and radius") \
+  X(createEntity, "create an entity and return its handle, or -1 when the store is full") \
+  X(destroyEntity, "destroy an entity given its handle") \
+  X(isEntityAlive, "check if an entity handle refers to a live entity") \
+  X(getEntityCount, "get the number of live entities") \
+  X(setPosition, "set the position component of an entity given x and y") \
+  X(getPositionX, "get the x position of an entity") \
+  X(getPositionY, "get the y position of an entity") \
+  X(setVelocity, "set the velocity component of an entity in pixels per second given vx and vy") \
+  X(getVelocityX, "get the x velocity of an entity") \
+  X(getVelocityY, "get the y velocity of an entity") \
+  X(setCircle, "set the circle component of an entity given a radius") \
+  X(setWorldBounds, "set the area the bounce system keeps entities inside given left, top, right and bottom") \
+  X(registerSystem, "enable a native system by name: movement, bounce or render") \
+  X(unregisterSystem, "disable a native system by name") \
+  X(setKinematics, "set the velocity multiplier and bounds response of the bounce system: reflect, stop or pass") \
+  X(getCollisionCount, "get the number of entities that touched the bounds during the last update") \
+  X(readCollisions, "copy entity and axes pairs of the last update's collisions into an int32 buffer and return the number copied") \
+  X(traceBegin, "start a named zone on the trace timeline") \
+  X(traceEnd, "end the zone started last by traceBegin") \
+  X(profile, "start (true) or stop (false) sampling the script call stacks - stopping writes the profile") \
+  X(shouldYield, "check if the running hook has used half its time budget and should leave the rest of its work for later frames")
+
+#endif // !ENGINEAPI_H
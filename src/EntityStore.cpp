@@ -0,0 +1,304 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "EntityStore.hpp"
+#include "Backend.hpp"
+
+EntityStore::EntityStore()
+  : movingCount(0),
+    systems(0) {
+}
+
+EntityStore::Entity EntityStore::create() {
+  uint32_t slot = 0;
+  if (!freeSlots.empty()) {
+    slot = freeSlots.back();
+    freeSlots.pop_back();
+  } else {
+    // scripts test the handle - an exception would unwind through the interpreter
+    if (slotRow.size() > SLOT_MASK) {
+      return INVALID_ENTITY;
+    }
+    slot = static_cast<uint32_t>(slotRow.size());
+    slotGeneration.push_back(0);
+    slotRow.push_back(-1);
+  }
+
+  slotRow[slot] = static_cast<int32_t>(mask.size());
+  rowSlot.push_back(slot);
+  mask.push_back(0);
+  x.push_back(0);
+  y.push_back(0);
+  vx.push_back(0);
+  vy.push_back(0);
+  radius.push_back(0);
+  // every body collides at most once an update - grow the buffer with the columns, so update never does
+  if (collisions.capacity() < radius.capacity()) {
+    collisions.reserve(radius.capacity());
+  }
+
+  return static_cast<Entity>((slotGeneration[slot] << SLOT_BITS) | slot);
+}
+
+void EntityStore::destroy(Entity entity) {
+  int found = rowOf(entity);
+  if (found < 0) {
+    return;
+  }
+
+  size_t row = static_cast<size_t>(found);
+  uint32_t slot = static_cast<uint32_t>(entity) & SLOT_MASK;
+
+  // keep the moving range contiguous - swap the row to the end of the range first
+  if (row < movingCount) {
+    movingCount -= 1;
+    swapRows(row, movingCount);
+    row = movingCount;
+  }
+
+  // then move it to the end so removing it leaves the arrays dense
+  swapRows(row, mask.size() - 1);
+  popRow();
+
+  slotRow[slot] = -1;
+  slotGeneration[slot] = (slotGeneration[slot] + 1) & GENERATION_MASK;
+  freeSlots.push_back(slot);
+}
+
+void EntityStore::swapRows(size_t a, size_t b) {
+  if (a == b) {
+    return;
+  }
+
+  std::swap(rowSlot[a], rowSlot[b]);
+  std::swap(mask[a], mask[b]);
+  std::swap(x[a], x[b]);
+  std::swap(y[a], y[b]);
+  std::swap(vx[a], vx[b]);
+  std::swap(vy[a], vy[b]);
+  std::swap(radius[a], radius[b]);
+
+  slotRow[rowSlot[a]] = static_cast<int32_t>(a);
+  slotRow[rowSlot[b]] = static_cast<int32_t>(b);
+}
+
+void EntityStore::popRow() {
+  rowSlot.pop_back();
+  mask.pop_back();
+  x.pop_back();
+  y.pop_back();
+  vx.pop_back();
+  vy.pop_back();
+  radius.pop_back();
+}
+
+void EntityStore::updateMovingRange(size_t row) {
+  const unsigned required = POSITION | VELOCITY;
+  bool moving = (mask[row] & required) == required;
+
+  if (moving && row >= movingCount) {
+    swapRows(row, movingCount);
+    movingCount += 1;
+  } else if (!moving && row < movingCount) {
+    movingCount -= 1;
+    swapRows(row, movingCount);
+  }
+}
+
+bool EntityStore::isAlive(Entity entity) const {
+  return rowOf(entity) >= 0;
+}
+
+void EntityStore::clear() {
+  for (size_t row = 0; row < rowSlot.size(); row++) {
+    uint32_t slot = rowSlot[row];
+    slotRow[slot] = -1;
+    slotGeneration[slot] = (slotGeneration[slot] + 1) & GENERATION_MASK;
+    freeSlots.push_back(slot);
+  }
+
+  movingCount = 0;
+  collisions.clear();
+  rowSlot.clear();
+  mask.clear();
+  x.clear();
+  y.clear();
+  vx.clear();
+  vy.clear();
+  radius.clear();
+}
+
+int EntityStore::rowOf(Entity entity) const {
+  if (entity < 0) {
+    return -1;
+  }
+
+  uint32_t handle = static_cast<uint32_t>(entity);
+  uint32_t slot = handle & SLOT_MASK;
+  if (slot >= slotRow.size() || slotGeneration[slot] != (handle >> SLOT_BITS)) {
+    return -1;
+  }
+
+  return slotRow[slot];
+}
+
+void EntityStore::setPosition(Entity entity, float px, float py) {
+  int row = rowOf(entity);
+  if (row >= 0) {
+    x[row] = px;
+    y[row] = py;
+    mask[row] |= POSITION;
+    updateMovingRange(static_cast<size_t>(row));
+  }
+}
+
+void EntityStore::setVelocity(Entity entity, float pvx, float pvy) {
+  int row = rowOf(entity);
+  if (row >= 0) {
+    vx[row] = pvx;
+    vy[row] = pvy;
+    mask[row] |= VELOCITY;
+    updateMovingRange(static_cast<size_t>(row));
+  }
+}
+
+void EntityStore::setCircle(Entity entity, float pradius) {
+  int row = rowOf(entity);
+  if (row >= 0) {
+    radius[row] = pradius;
+    mask[row] |= CIRCLE;
+  }
+}
+
+void EntityStore::removeComponents(Entity entity, unsigned components) {
+  int row = rowOf(entity);
+  if (row < 0) {
+    return;
+  }
+
+  // fields of a missing component read as zero
+  if (components & POSITION) {
+    x[row] = 0;
+    y[row] = 0;
+  }
+
+  if (components & VELOCITY) {
+    vx[row] = 0;
+    vy[row] = 0;
+  }
+
+  if (components & CIRCLE) {
+    radius[row] = 0;
+  }
+
+  mask[row] &= ~components;
+  updateMovingRange(static_cast<size_t>(row));
+}
+
+bool EntityStore::hasComponents(Entity entity, unsigned components) const {
+  int row = rowOf(entity);
+  return row >= 0 && (mask[row] & components) == components;
+}
+
+float EntityStore::getPositionX(Entity entity) const {
+  int row = rowOf(entity);
+  return row >= 0 ? x[row] : 0;
+}
+
+float EntityStore::getPositionY(Entity entity) const {
+  int row = rowOf(entity);
+  return row >= 0 ? y[row] : 0;
+}
+
+float EntityStore::getVelocityX(Entity entity) const {
+  int row = rowOf(entity);
+  return row >= 0 ? vx[row] : 0;
+}
+
+float EntityStore::getVelocityY(Entity entity) const {
+  int row = rowOf(entity);
+  return row >= 0 ? vy[row] : 0;
+}
+
+float EntityStore::getRadius(Entity entity) const {
+  int row = rowOf(entity);
+  return row >= 0 ? radius[row] : 0;
+}
+
+void EntityStore::setBounds(float left, float top, float right, float bottom) {
+  kinematicsSettings.left = left;
+  kinematicsSettings.top = top;
+  kinematicsSettings.right = right;
+  kinematicsSettings.bottom = bottom;
+}
+
+void EntityStore::setKinematics(float speed, kinematics::Response response) {
+  kinematicsSettings.speed = speed;
+  kinematicsSettings.response = response;
+}
+
+bool EntityStore::parseSystem(const char* name, System* system) {
+  if (std::strcmp(name, "movement") == 0) {
+    *system = MOVEMENT_SYSTEM;
+  } else if (std::strcmp(name, "bounce") == 0) {
+    *system = BOUNCE_SYSTEM;
+  } else if (std::strcmp(name, "render") == 0) {
+    *system = RENDER_SYSTEM;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void EntityStore::enableSystem(System system, bool enabled) {
+  if (enabled) {
+    systems |= system;
+  } else {
+    systems &= ~static_cast<unsigned>(system);
+  }
+}
+
+void EntityStore::update(float deltaTime) {
+  collisions.clear();
+
+  if (!isSystemEnabled(MOVEMENT_SYSTEM) || movingCount == 0) {
+    return;
+  }
+
+  if (isSystemEnabled(BOUNCE_SYSTEM)) {
+    kinematics::integrate(kinematicsSettings, &x[0], &y[0], &vx[0], &vy[0], &radius[0], movingCount, deltaTime, &collisions);
+
+    // the kernel reports rows - scripts know entities
+    for (size_t i = 0; i < collisions.size(); i++) {
+      uint32_t slot = rowSlot[collisions[i].index];
+      collisions[i].index = (slotGeneration[slot] << SLOT_BITS) | slot;
+    }
+  } else {
+    // plain movement - nothing to bounce off
+    kinematics::Settings settings = kinematicsSettings;
+    settings.response = kinematics::PASS;
+    settings.left = -HUGE_VALF;
+    settings.top = -HUGE_VALF;
+    settings.right = HUGE_VALF;
+    settings.bottom = HUGE_VALF;
+    kinematics::integrate(settings, &x[0], &y[0], &vx[0], &vy[0], &radius[0], movingCount, deltaTime, nullptr);
+  }
+}
+
+void EntityStore::render(Backend& backend) {
+  if (!isSystemEnabled(RENDER_SYSTEM)) {
+    return;
+  }
+
+  const unsigned required = POSITION | CIRCLE;
+  size_t count = mask.size();
+
+  for (size_t row = 0; row < count; row++) {
+    if ((mask[row] & required) != required) {
+      continue;
+    }
+
+    backend.drawCircle(static_cast<int>(x[row]), static_cast<int>(y[row]), static_cast<int>(radius[row]));
+  }
+}
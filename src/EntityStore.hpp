@@ -0,0 +1,128 @@
+#ifndef ENTITYSTORE_H
+#define ENTITYSTORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Kinematics.hpp"
+
+class Backend;
+
+// native entity-component store
+//
+// components are kept as a struct of arrays: every live entity owns one row and each component field
+// is its own tightly packed array (x[], y[], vx[], ...), so the native systems stream through memory.
+// rows of entities with both a position and a velocity are kept at the front so the movement
+// system runs the kinematics kernel over one contiguous range. destroying an entity swaps its row
+// to the end of that range (when it moves), then with the last row, and drops the last row - the
+// rows stay dense and the moving ones stay together.
+//
+// scripts refer to entities through handles - the low bits select a slot and the high bits hold the
+// slot's generation, which counts up every time the slot is freed. a handle to a destroyed entity
+// does not resolve to the entity that reuses its slot, until the 11 bit generation wraps: after
+// 2048 reuses of the same slot an old handle is valid again
+class EntityStore {
+  public:
+    typedef int32_t Entity;
+
+    static const Entity INVALID_ENTITY = -1;
+    // live entities at once
+    static const size_t MAX_ENTITIES = 1 << 20;
+
+    // component bits
+    enum Component {
+      POSITION = 1 << 0,
+      VELOCITY = 1 << 1,
+      CIRCLE = 1 << 2
+    };
+
+    // native systems that can be enabled from scripts
+    enum System {
+      MOVEMENT_SYSTEM = 1 << 0,
+      BOUNCE_SYSTEM = 1 << 1,
+      RENDER_SYSTEM = 1 << 2
+    };
+
+    EntityStore();
+
+    // INVALID_ENTITY once every slot is taken (MAX_ENTITIES)
+    Entity create();
+    void destroy(Entity entity);
+    bool isAlive(Entity entity) const;
+    void clear();
+
+    // number of live entities
+    size_t size() const { return mask.size(); }
+
+    void setPosition(Entity entity, float x, float y);
+    void setVelocity(Entity entity, float vx, float vy);
+    void setCircle(Entity entity, float radius);
+    void removeComponents(Entity entity, unsigned components);
+    bool hasComponents(Entity entity, unsigned components) const;
+
+    // component reads return 0 for dead entities or missing components
+    float getPositionX(Entity entity) const;
+    float getPositionY(Entity entity) const;
+    float getVelocityX(Entity entity) const;
+    float getVelocityY(Entity entity) const;
+    float getRadius(Entity entity) const;
+
+    // the area the bounce system keeps circles inside
+    void setBounds(float left, float top, float right, float bottom);
+
+    // velocity multiplier and what the bounce system does when an entity touches the bounds
+    void setKinematics(float speed, kinematics::Response response);
+
+    // collisions found by the bounce system during the last update - index is the entity handle
+    std::vector<kinematics::Collision> const& getCollisions() const { return collisions; }
+
+    // system names used by scripts: "movement", "bounce", "render"
+    static bool parseSystem(const char* name, System* system);
+    void enableSystem(System system, bool enabled);
+    bool isSystemEnabled(System system) const { return (systems & system) != 0; }
+
+    // runs the enabled movement / bounce systems
+    void update(float deltaTime);
+
+    // runs the enabled render system
+    void render(Backend& backend);
+
+  private:
+    // returns the row of a live entity or -1
+    int rowOf(Entity entity) const;
+
+    void swapRows(size_t a, size_t b);
+    void popRow();
+
+    // moves a row in or out of the moving range after its components changed
+    void updateMovingRange(size_t row);
+
+    // MAX_ENTITIES slots
+    static const int SLOT_BITS = 20;
+    static const uint32_t SLOT_MASK = (1u << SLOT_BITS) - 1;
+    static const uint32_t GENERATION_MASK = (1u << (31 - SLOT_BITS)) - 1;
+
+    // handle slots
+    std::vector<uint32_t> slotGeneration;
+    std::vector<int32_t> slotRow;
+    std::vector<uint32_t> freeSlots;
+
+    // rows - one entry per live entity in every array
+    std::vector<uint32_t> rowSlot;
+    std::vector<unsigned> mask;
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> vx;
+    std::vector<float> vy;
+    std::vector<float> radius;
+
+    // rows [0, movingCount) have both a position and a velocity
+    size_t movingCount;
+
+    unsigned systems;
+    kinematics::Settings kinematicsSettings;
+    std::vector<kinematics::Collision> collisions;
+};
+
+#endif // !ENTITYSTORE_H
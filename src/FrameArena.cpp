@@ -0,0 +1,101 @@
+#include <cstdlib>
+#include <cstring>
+
+#include "FrameArena.hpp"
+
+namespace {
+  const size_t ALIGNMENT = alignof(std::max_align_t);
+
+  size_t aligned(size_t size) {
+    return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+  }
+}
+
+FrameArena::FrameArena()
+  : block(nullptr) {
+}
+
+FrameArena::~FrameArena() {
+  releaseBlocks();
+}
+
+FrameArena& FrameArena::current() {
+  // created on the thread's first use and freed when the thread exits
+  thread_local FrameArena arena;
+  return arena;
+}
+
+void* FrameArena::allocate(size_t size) {
+  size = aligned(size > 0 ? size : 1);
+
+  if (block == nullptr || block->size - block->used < size) {
+    size_t blockSize = block != nullptr ? block->size * 2 : INITIAL_SIZE;
+    block = newBlock(blockSize > size ? blockSize : size, block);
+  }
+
+  void* result = dataOf(block) + block->used;
+  block->used += size;
+  return result;
+}
+
+StringView FrameArena::copyString(const char* value, size_t length) {
+  char* copy = static_cast<char*>(allocate(length + 1));
+  std::memcpy(copy, value, length);
+  copy[length] = '\0';
+
+  StringView view = { copy, length };
+  return view;
+}
+
+void FrameArena::reset() {
+  if (block == nullptr) {
+    return;
+  }
+
+  if (block->previous != nullptr) {
+    // the frame outgrew the first block - the next one gets a block that fits all of it
+    size_t total = getCapacity();
+    releaseBlocks();
+    block = newBlock(total, nullptr);
+  }
+  block->used = 0;
+}
+
+size_t FrameArena::getUsed() const {
+  size_t used = 0;
+  for (Block* current = block; current != nullptr; current = current->previous) {
+    used += current->used;
+  }
+  return used;
+}
+
+size_t FrameArena::getCapacity() const {
+  size_t capacity = 0;
+  for (Block* current = block; current != nullptr; current = current->previous) {
+    capacity += current->size;
+  }
+  return capacity;
+}
+
+void FrameArena::releaseBlocks() {
+  while (block != nullptr) {
+    Block* previous = block->previous;
+    std::free(block);
+    block = previous;
+  }
+}
+
+FrameArena::Block* FrameArena::newBlock(size_t size, Block* previous) {
+  Block* result = static_cast<Block*>(std::malloc(aligned(sizeof(Block)) + size));
+  if (result == nullptr) {
+    throw std::bad_alloc();
+  }
+  result->previous = previous;
+  result->size = size;
+  result->used = 0;
+  return result;
+}
+
+char* FrameArena::dataOf(Block* block) {
+  return reinterpret_cast<char*>(block) + aligned(sizeof(Block));
+}
@@ -0,0 +1,77 @@
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+// a string in a FrameArena, or any other characters that outlive it - data is nul terminated
+struct StringView {
+  const char* data;
+  size_t length;
+
+  const char* c_str() const { return data; }
+  bool empty() const { return length == 0; }
+};
+
+// bump allocator for the temporaries of a frame: the scripting bridges' copies and scratch arrays
+// that would otherwise go through new and malloc on every call. everything allocated is dropped at
+// once by reset, at the end of the frame - destructors are never run, so only trivially
+// destructible types go in it
+//
+// every thread has an arena of its own (current). the game thread's is reset by Game once the frame
+// is rendered and the script thread's by ThreadedScriptingEngine after each step, so temporaries
+// must not be kept past the frame that allocated them
+//
+// a frame that outgrows the arena chains more blocks to it, and reset merges them into one block of
+// their total size - a steady state frame allocates nothing once the arena has seen its largest frame
+class FrameArena {
+  public:
+    FrameArena();
+    ~FrameArena();
+
+    // the calling thread's arena
+    static FrameArena& current();
+
+    // size bytes aligned for any type - throws std::bad_alloc like new
+    void* allocate(size_t size);
+
+    template <typename T>
+    T* allocateArray(size_t count) {
+      static_assert(std::is_trivially_destructible<T>::value, "the arena never runs destructors");
+      return static_cast<T*>(allocate(count * sizeof(T)));
+    }
+
+    StringView copyString(const char* value, size_t length);
+
+    // drops everything allocated since the last reset
+    void reset();
+
+    // bytes allocated since the last reset
+    size_t getUsed() const;
+    // bytes the arena holds from the system
+    size_t getCapacity() const;
+
+    // the first block - reset grows it to the largest frame
+    static const size_t INITIAL_SIZE = 16 * 1024;
+
+  private:
+    struct Block {
+      // the block that filled up before this one
+      Block* previous;
+      size_t size;
+      size_t used;
+    };
+
+    FrameArena(FrameArena const&);
+    FrameArena& operator=(FrameArena const&);
+
+    Block* newBlock(size_t size, Block* previous);
+    void releaseBlocks();
+    static char* dataOf(Block* block);
+
+    // the block allocations are cut from - the full ones are chained behind it
+    Block* block;
+};
+
+#endif // !FRAMEARENA_H
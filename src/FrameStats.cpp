@@ -0,0 +1,125 @@
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "FrameStats.hpp"
+
+FrameStats::FrameStats()
+  : allocationCounter(nullptr),
+    inFrame(false),
+    allocationsAtStart(0),
+    lastScriptAllocations(0),
+    haveScriptAllocations(false) {
+}
+
+void FrameStats::setAllocationCounter(AllocationCounter counter) {
+  allocationCounter = counter;
+}
+
+void FrameStats::beginFrame() {
+  if (inFrame) {
+    return;
+  }
+
+  inFrame = true;
+  current.updateMilliseconds = 0;
+  current.renderMilliseconds = 0;
+  current.allocations = -1;
+  current.hookOverruns = 0;
+  current.scriptAllocations = -1;
+  current.scriptBytes = -1;
+
+  if (allocationCounter) {
+    allocationsAtStart = allocationCounter();
+  }
+}
+
+void FrameStats::beginUpdate() {
+  beginFrame();
+  phaseStart = Clock::now();
+}
+
+void FrameStats::endUpdate() {
+  std::chrono::duration<double, std::milli> elapsed = Clock::now() - phaseStart;
+  current.updateMilliseconds = elapsed.count();
+}
+
+void FrameStats::beginRender() {
+  beginFrame();
+  phaseStart = Clock::now();
+}
+
+void FrameStats::endRender() {
+  std::chrono::duration<double, std::milli> elapsed = Clock::now() - phaseStart;
+  current.renderMilliseconds = elapsed.count();
+
+  if (allocationCounter) {
+    current.allocations = static_cast<long long>(allocationCounter() - allocationsAtStart);
+  }
+
+  frames.push_back(current);
+  inFrame = false;
+}
+
+void FrameStats::recordHookOverruns(int count) {
+  beginFrame();
+  current.hookOverruns += count;
+}
+
+void FrameStats::recordScriptMemory(size_t liveBytes, unsigned long long allocations) {
+  beginFrame();
+  current.scriptBytes = static_cast<long long>(liveBytes);
+  if (haveScriptAllocations) {
+    current.scriptAllocations = static_cast<long long>(allocations - lastScriptAllocations);
+  }
+  lastScriptAllocations = allocations;
+  haveScriptAllocations = true;
+}
+
+void FrameStats::clear() {
+  frames.clear();
+  inFrame = false;
+  haveScriptAllocations = false;
+}
+
+void FrameStats::save(std::string const& filename) const {
+  std::ofstream file(filename.c_str());
+  if (!file) {
+    std::stringstream msg;
+    msg << "Unable to write " << filename << std::endl;
+    throw std::runtime_error(msg.str());
+  }
+
+  for (size_t i = 0; i < frames.size(); i++) {
+    file << frames[i].updateMilliseconds << " " << frames[i].renderMilliseconds << " " << frames[i].allocations << " " << frames[i].hookOverruns
+      << " " << frames[i].scriptAllocations << " " << frames[i].scriptBytes << "\n";
+  }
+}
+
+void FrameStats::load(std::string const& filename) {
+  std::ifstream file(filename.c_str());
+  if (!file) {
+    std::stringstream msg;
+    msg << "Unable to read " << filename << std::endl;
+    throw std::runtime_error(msg.str());
+  }
+
+  clear();
+
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    Frame frame;
+    if (!(fields >> frame.updateMilliseconds >> frame.renderMilliseconds >> frame.allocations)) {
+      continue;
+    }
+    if (!(fields >> frame.hookOverruns)) {
+      frame.hookOverruns = 0;
+    }
+    if (!(fields >> frame.scriptAllocations >> frame.scriptBytes)) {
+      frame.scriptAllocations = -1;
+      frame.scriptBytes = -1;
+    }
+    frames.push_back(frame);
+  }
+}
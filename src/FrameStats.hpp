@@ -0,0 +1,68 @@
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// per-frame timings recorded by the Game loop when a FrameStats is attached to it
+class FrameStats {
+  public:
+    struct Frame {
+      double updateMilliseconds;
+      double renderMilliseconds;
+      // heap allocations during the frame or -1 when they are not counted
+      long long allocations;
+      // script hooks that overran the HOOK_BUDGET_MS budget
+      int hookOverruns;
+      // blocks the script vm allocated during the frame and the bytes it had in use at the end of
+      // it, or -1 when the engine does not count its memory
+      long long scriptAllocations;
+      long long scriptBytes;
+    };
+
+    // returns the number of allocations made so far by the process
+    typedef unsigned long long (*AllocationCounter)();
+
+    FrameStats();
+
+    // allocations are only recorded when a counter is set
+    void setAllocationCounter(AllocationCounter counter);
+
+    // a frame is every update and render pair - frames that skip the update record 0 for it
+    void beginUpdate();
+    void endUpdate();
+    void beginRender();
+    void endRender();
+    // adds to the frame in progress
+    void recordHookOverruns(int count);
+    // the script vm's memory at the end of the frame in progress - allocations is the vm's running
+    // count, the frame records how much it grew since the frame before. the first frame after
+    // clear has nothing to compare with and records -1
+    void recordScriptMemory(size_t liveBytes, unsigned long long allocations);
+
+    std::vector<Frame> const& getFrames() const { return frames; }
+    void clear();
+
+    // one frame per line: update milliseconds, render milliseconds, allocations, hook overruns,
+    // script allocations and script bytes. files without the overruns column load with 0 for it,
+    // files without the script columns with -1
+    void save(std::string const& filename) const;
+    void load(std::string const& filename);
+
+  private:
+    void beginFrame();
+
+    typedef std::chrono::steady_clock Clock;
+
+    AllocationCounter allocationCounter;
+    std::vector<Frame> frames;
+    Frame current;
+    bool inFrame;
+    unsigned long long allocationsAtStart;
+    unsigned long long lastScriptAllocations;
+    bool haveScriptAllocations;
+    Clock::time_point phaseStart;
+};
+
+#endif // !FRAMESTATS_H
@@ -0,0 +1,270 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "Game.hpp"
+#include "AllocationTracker.hpp"
+#include "Backend.hpp"
+#include "FrameArena.hpp"
+#include "FrameStats.hpp"
+#include "Trace.hpp"
+
+#include "LuaScriptingEngine.hpp"
+#include "RubyScriptingEngine.hpp"
+#include "PythonScriptingEngine.hpp"
+#include "ThreadedScriptingEngine.hpp"
+
+Game::Game(std::string const& programName, std::string const& mainScriptFile, Backend* backend, bool pythonThread)
+  : isRunning(false),
+    frameStats(nullptr),
+    scriptThread(false) {
+  // initialize the shared context
+  SharedContext::instance = &context;
+  context.config = &config;
+  context.world = &world;
+  context.backend = backend;
+  context.scripting = nullptr;
+
+  // the destructor does not run for a constructor that throws - the backend is ours from here on
+  bool backendStarted = false;
+  try {
+    std::string scriptExtention = mainScriptFile.substr(mainScriptFile.rfind('.') + 1);
+
+    if (scriptExtention == "lua") {
+      context.scripting = new LuaScriptingEngine();
+    } else if (scriptExtention == "rb") {
+      context.scripting = new RubyScriptingEngine();
+    } else if (scriptExtention == "py" && pythonThread) {
+      context.scripting = new ThreadedScriptingEngine([programName]() { return new PythonScriptingEngine(programName); });
+      scriptThread = true;
+    } else if (scriptExtention == "py") {
+      context.scripting = new PythonScriptingEngine(programName);
+    } else {
+      std::stringstream msg;
+      msg << "Unsupported script [" << scriptExtention << "] : " << mainScriptFile << std::endl;
+      throw std::runtime_error(msg.str());
+    }
+
+    context.scripting->load(mainScriptFile);
+
+    if (config.debugMode) {
+      std::cout << "Game::Game()" << std::endl;
+      config.print();
+    }
+
+    backendStarted = true;
+    backend->init();
+    backend->createWindow(
+      config.screenWidth,
+      config.screenHeight,
+      config.useFullscreen,
+      config.windowTitle
+    );
+
+    if (config.idleGc) {
+      context.scripting->setIdleGc(true);
+    }
+
+    create();
+
+    // the create hook may take its time loading - the budget holds from the first frame on
+    if (config.hookBudgetMilliseconds > 0) {
+      context.scripting->setHookBudget(config.hookBudgetMilliseconds);
+    }
+  } catch (...) {
+    if (backendStarted) {
+      backend->shutdown();
+    }
+    delete backend;
+    context.backend = nullptr;
+
+    delete context.scripting;
+    context.scripting = nullptr;
+    SharedContext::instance = nullptr;
+    throw;
+  }
+}
+
+void Game::run() {
+  Backend& backend = *context.backend;
+
+  isRunning = true;
+  float lastTime = backend.getTimestamp();
+  float newTime = 0;
+  float deltaTime = 0.0f;
+  while (isRunning) {
+    TRACE_ZONE("frame");
+    beginFrame();
+
+    // changed scripts are swapped in between frames
+    reload();
+
+    newTime = backend.getTimestamp();
+    if (newTime - lastTime < 1) {
+      deltaTime = (newTime - lastTime);
+      frameUpdate(deltaTime);
+    }
+    lastTime = newTime;
+    frameRender();
+    endFrame();
+  }
+}
+
+void Game::runFrames(int frameCount, float deltaTime) {
+  isRunning = true;
+  for (int frame = 0; frame < frameCount && isRunning; frame++) {
+    TRACE_ZONE("frame");
+    beginFrame();
+
+    reload();
+
+    frameUpdate(deltaTime);
+    frameRender();
+    endFrame();
+  }
+}
+
+void Game::beginFrame() {
+  int framesPerSecond = config.targetFps > 0 ? config.targetFps : 60;
+  frameDeadline = std::chrono::steady_clock::now() + std::chrono::microseconds(1000000 / framesPerSecond);
+}
+
+void Game::reload() {
+  TRACE_ZONE("game.reload");
+  ALLOCATION_PHASE(RELOAD);
+  context.scripting->processReloads();
+}
+
+void Game::frameUpdate(float deltaTime) {
+  TRACE_ZONE("game.update");
+  Backend& backend = *context.backend;
+
+  backend.preFrameUpdate(deltaTime);
+  if (frameStats) {
+    frameStats->beginUpdate();
+  }
+  update(deltaTime);
+  if (frameStats) {
+    frameStats->endUpdate();
+  }
+  backend.postFrameUpdate(deltaTime);
+}
+
+void Game::frameRender() {
+  TRACE_ZONE("game.render");
+  Backend& backend = *context.backend;
+
+  backend.preFrameRender();
+  if (frameStats) {
+    frameStats->beginRender();
+  }
+  render();
+  if (frameStats) {
+    frameStats->recordHookOverruns(context.scripting->takeHookOverruns());
+    MemoryStats memory;
+    if (context.scripting->getMemoryStats(memory)) {
+      frameStats->recordScriptMemory(memory.liveBytes, memory.allocations);
+    }
+    frameStats->endRender();
+  }
+
+  // postFrameRender presents the frame and may wait for vsync there - the idle time is before it
+  collectGarbage();
+  {
+    ALLOCATION_PHASE(PRESENT);
+    backend.postFrameRender();
+  }
+
+  // the frame's temporaries on this thread - the script thread drops its own after each step
+  FrameArena::current().reset();
+}
+
+void Game::endFrame() {
+  {
+    ALLOCATION_PHASE(EVENTS);
+    if (!context.backend->processEvents()) {
+      isRunning = false;
+    }
+  }
+  ALLOCATION_END_FRAME();
+}
+
+void Game::collectGarbage() {
+  if (!config.idleGc) {
+    return;
+  }
+
+  TRACE_ZONE("game.idleGc");
+  ALLOCATION_PHASE(IDLE_GC);
+  context.scripting->collectGarbage(frameDeadline);
+}
+
+Game::~Game() {
+  destroy();
+
+  if (context.backend != nullptr) {
+    context.backend->shutdown();
+    delete context.backend;
+    context.backend = nullptr;
+  }
+
+  if (context.scripting != nullptr) {
+    delete context.scripting;
+    context.scripting = nullptr;
+  }
+
+  if (context.config->debugMode) {
+    std::cout << "Game::~Game()" << std::endl;
+  }
+}
+
+void Game::create() {
+  if (context.config->debugMode) {
+    std::cout << "Game::create()" << std::endl;
+  }
+
+  context.scripting->runCreate();
+}
+
+void Game::destroy() {
+  if (context.config->debugMode) {
+    std::cout << "Game::destroy()" << std::endl;
+  }
+
+  context.scripting->runDestroy();
+}
+
+void Game::update(float deltaTime) {
+  ALLOCATION_PHASE(UPDATE);
+  if (context.config->debugMode) {
+    std::cout << "Game::update(" << deltaTime << ")" << std::endl;
+  }
+
+  context.scripting->runUpdate(deltaTime);
+  if (scriptThread) {
+    return;
+  }
+
+  // native systems run after the script has had a chance to change the world
+  TRACE_ZONE("world.update");
+  world.update(deltaTime);
+}
+
+void Game::render() {
+  ALLOCATION_PHASE(RENDER);
+  if (context.config->debugMode) {
+    std::cout << "Game::render(" << std::endl;
+  }
+
+  context.scripting->runRender();
+  if (scriptThread) {
+    return;
+  }
+
+  TRACE_ZONE("world.render");
+  world.render(*context.backend);
+}
@@ -0,0 +1,57 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include <chrono>
+#include <string>
+
+#include "SharedContext.hpp"
+#include "Configuration.hpp"
+#include "EntityStore.hpp"
+
+class Backend;
+class FrameStats;
+
+class Game {
+  public:
+    // loads the main script, opens the window and runs the script's create event
+    // the game takes ownership of the backend
+    // pythonThread runs a python script on a thread of its own - see ThreadedScriptingEngine.hpp
+    Game(std::string const& programName, std::string const& mainScriptFile, Backend* backend, bool pythonThread);
+    ~Game();
+
+    // runs the main game loop until the backend asks to stop
+    void run();
+
+    // runs a fixed number of frames with a fixed delta time - for headless runs
+    void runFrames(int frameCount, float deltaTime);
+
+    void create();
+    void destroy();
+    void update(float deltaTime);
+    void render();
+
+    Configuration config;
+    SharedContext context;
+    EntityStore world;
+    bool isRunning;
+
+    // records update and render timings when set
+    FrameStats* frameStats;
+
+  private:
+    // the next frame is due one TARGET_FPS period after this one started
+    void beginFrame();
+    void reload();
+    void frameUpdate(float deltaTime);
+    void frameRender();
+    // handles the backend's events and closes the frame
+    void endFrame();
+    // the IDLE_GC collection in the time left before the frame is due
+    void collectGarbage();
+
+    std::chrono::steady_clock::time_point frameDeadline;
+    // the scripting engine runs the native systems on its own thread
+    bool scriptThread;
+};
+
+#endif // !GAME_H
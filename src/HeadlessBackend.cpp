@@ -0,0 +1,54 @@
+#include "HeadlessBackend.hpp"
+
+HeadlessBackend::HeadlessBackend()
+  : width(0),
+    height(0),
+    drawCount(0),
+    start(std::chrono::steady_clock::now()) {
+}
+
+void HeadlessBackend::init() {
+}
+
+void HeadlessBackend::createWindow(int width, int height, bool fullscreen, std::string const& title) {
+  this->width = width;
+  this->height = height;
+}
+
+void HeadlessBackend::getWindowSize(int* width, int* height) {
+  if (width) {
+    *width = this->width;
+  }
+
+  if (height) {
+    *height = this->height;
+  }
+}
+
+float HeadlessBackend::getTimestamp() {
+  std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+void HeadlessBackend::shutdown() {
+}
+
+bool HeadlessBackend::processEvents() {
+  return true;
+}
+
+void HeadlessBackend::preFrameUpdate(float deltaTime) {
+}
+
+void HeadlessBackend::postFrameUpdate(float deltaTime) {
+}
+
+void HeadlessBackend::preFrameRender() {
+}
+
+void HeadlessBackend::postFrameRender() {
+}
+
+void HeadlessBackend::drawCircle(int x, int y, int radius) {
+  drawCount++;
+}
@@ -0,0 +1,60 @@
+#ifndef HEADLESSBACKEND_H
+#define HEADLESSBACKEND_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include "Backend.hpp"
+
+// a backend without a window for benchmarks and automated runs
+// frames run as fast as the scripts allow and draw calls are only counted
+class HeadlessBackend : public Backend {
+  public:
+    HeadlessBackend();
+    virtual ~HeadlessBackend() {}
+
+    // initialize any libraries
+    virtual void init();
+
+    // create the main game window
+    virtual void createWindow(int width, int height, bool fullscreen, std::string const& title);
+
+    // retrieves the size of the window
+    virtual void getWindowSize(int* width, int* height);
+
+    // returns a timestamp
+    virtual float getTimestamp();
+
+    // shutdown any libraries
+    virtual void shutdown();
+
+    // process any events - return false to stop the main game loop
+    virtual bool processEvents();
+
+    // perform any needed operations before the main game loop update
+    virtual void preFrameUpdate(float deltaTime);
+
+    // perform any needed operations after the main game loop update
+    virtual void postFrameUpdate(float deltaTime);
+
+    // perform any needed operations before the main game loop render
+    virtual void preFrameRender();
+
+    // perform any needed operations after the main game loop render
+    virtual void postFrameRender();
+
+    // draws a filled circle to the screen
+    virtual void drawCircle(int x, int y, int radius);
+
+    // number of draw calls since the backend was created
+    size_t getDrawCount() const { return drawCount; }
+
+  protected:
+    int width;
+    int height;
+    size_t drawCount;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif // !HEADLESSBACKEND_H
@@ -0,0 +1,103 @@
+#include "HookWatchdog.hpp"
+
+// how often a call that overran is interrupted again
+static const int RETRY_MILLISECONDS = 5;
+
+HookWatchdog::HookWatchdog()
+  : budgetMilliseconds(0),
+    depth(0),
+    expired(false),
+    stopping(false) {
+}
+
+HookWatchdog::~HookWatchdog() {
+  stop();
+  if (thread.joinable()) {
+    thread.join();
+  }
+}
+
+void HookWatchdog::setBudget(int milliseconds) {
+  std::lock_guard<std::mutex> lock(mutex);
+  budgetMilliseconds = milliseconds > 0 ? milliseconds : 0;
+}
+
+void HookWatchdog::arm() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (depth++ > 0 || budgetMilliseconds == 0) {
+    return;
+  }
+
+  expired = false;
+  started = Clock::now();
+  deadline = started + std::chrono::milliseconds(budgetMilliseconds);
+  changed.notify_all();
+}
+
+bool HookWatchdog::disarm() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (depth == 0 || --depth > 0) {
+    return false;
+  }
+
+  bool overran = expired;
+  expired = false;
+  changed.notify_all();
+  return overran;
+}
+
+bool HookWatchdog::isExpired() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return expired;
+}
+
+bool HookWatchdog::shouldYield() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (depth == 0 || budgetMilliseconds == 0) {
+    return false;
+  }
+  return Clock::now() - started >= std::chrono::microseconds(budgetMilliseconds * 500);
+}
+
+bool HookWatchdog::waitForOverrun() {
+  std::unique_lock<std::mutex> lock(mutex);
+  return waitForOverrun(lock);
+}
+
+bool HookWatchdog::waitForOverrun(std::unique_lock<std::mutex>& lock) {
+  while (!stopping) {
+    if (depth == 0 || budgetMilliseconds == 0) {
+      changed.wait(lock);
+      continue;
+    }
+
+    Clock::time_point wakeUp = expired ? Clock::now() + std::chrono::milliseconds(RETRY_MILLISECONDS) : deadline;
+    // a new call or the end of this one wakes the wait early
+    if (changed.wait_until(lock, wakeUp) == std::cv_status::timeout && depth > 0 && Clock::now() >= deadline) {
+      expired = true;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void HookWatchdog::stop() {
+  std::lock_guard<std::mutex> lock(mutex);
+  stopping = true;
+  changed.notify_all();
+}
+
+void HookWatchdog::start(Callback callback, void* data) {
+  if (thread.joinable()) {
+    return;
+  }
+  thread = std::thread(&HookWatchdog::run, this, callback, data);
+}
+
+void HookWatchdog::run(Callback callback, void* data) {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (waitForOverrun(lock)) {
+    callback(data);
+  }
+}
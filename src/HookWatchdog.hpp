@@ -0,0 +1,68 @@
+#ifndef HOOKWATCHDOG_H
+#define HOOKWATCHDOG_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// keeps script hooks to a time budget (the HOOK_BUDGET_MS configuration field). the engine arms the
+// watchdog when it calls into the script and disarms it when the call returns. a call that is still
+// running when its budget is used up has overrun - the waiting side is told straight away and again
+// every few milliseconds while the call keeps running, so a script that catches the interruption is
+// interrupted again
+//
+// the engines interrupt the script their own way, from a thread of the watchdog's own (start) or from
+// one of the language's threads that waits for overruns itself (waitForOverrun)
+class HookWatchdog {
+  public:
+    typedef void (*Callback)(void* data);
+
+    HookWatchdog();
+    ~HookWatchdog();
+
+    // 0 turns the budget off
+    void setBudget(int milliseconds);
+    int getBudget() const { return budgetMilliseconds; }
+
+    // calls into the script nest - only the outermost call is timed
+    void arm();
+    // returns true when the call overran its budget
+    bool disarm();
+
+    bool isExpired();
+    // true once the running call has used half its budget - scripts check it to spread work over frames
+    bool shouldYield();
+
+    // blocks until the armed call overruns and returns true, or returns false once the watchdog stops
+    bool waitForOverrun();
+    // wakes every waitForOverrun for good
+    void stop();
+
+    // waits for overruns on a thread of its own and calls callback there on every one. the callback
+    // runs before the call can be disarmed, so it never interrupts the next call by mistake - it must
+    // not block or use the watchdog
+    void start(Callback callback, void* data);
+
+  private:
+    typedef std::chrono::steady_clock Clock;
+
+    HookWatchdog(HookWatchdog const&);
+    HookWatchdog& operator=(HookWatchdog const&);
+
+    void run(Callback callback, void* data);
+    bool waitForOverrun(std::unique_lock<std::mutex>& lock);
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::thread thread;
+
+    int budgetMilliseconds;
+    int depth;
+    bool expired;
+    bool stopping;
+    Clock::time_point started;
+    Clock::time_point deadline;
+};
+
+#endif // !HOOKWATCHDOG_H
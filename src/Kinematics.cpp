@@ -0,0 +1,208 @@
+#include <cstring>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "Kinematics.hpp"
+
+namespace kinematics {
+  Settings::Settings()
+    : speed(1.0f),
+      left(0),
+      top(0),
+      right(0),
+      bottom(0),
+      response(REFLECT) {
+  }
+
+  bool parseResponse(const char* name, Response* response) {
+    if (std::strcmp(name, "reflect") == 0) {
+      *response = REFLECT;
+    } else if (std::strcmp(name, "stop") == 0) {
+      *response = STOP;
+    } else if (std::strcmp(name, "pass") == 0) {
+      *response = PASS;
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  // one axis of one body - returns true when the next position touches the bounds
+  static inline bool stepAxis(Response response, float scale, float lo, float hi, float& position, float& velocity) {
+    float next = position + velocity * scale;
+    bool hit = next <= lo || next >= hi;
+
+    if (!hit || response == PASS) {
+      position = next;
+    }
+
+    if (hit) {
+      if (response == REFLECT) {
+        velocity = -velocity;
+      } else if (response == STOP) {
+        velocity = 0;
+      }
+    }
+
+    return hit;
+  }
+
+  void integrateScalar(
+    Settings const& settings,
+    float* x,
+    float* y,
+    float* vx,
+    float* vy,
+    const float* radius,
+    size_t begin,
+    size_t end,
+    float deltaTime,
+    std::vector<Collision>* collisions) {
+    const float scale = settings.speed * deltaTime;
+
+    for (size_t i = begin; i < end; i++) {
+      float r = radius[i];
+      uint32_t axes = 0;
+
+      if (stepAxis(settings.response, scale, settings.left + r, settings.right - r, x[i], vx[i])) {
+        axes |= AXIS_X;
+      }
+
+      if (stepAxis(settings.response, scale, settings.top + r, settings.bottom - r, y[i], vy[i])) {
+        axes |= AXIS_Y;
+      }
+
+      if (axes && collisions) {
+        Collision collision = { static_cast<uint32_t>(i), axes };
+        collisions->push_back(collision);
+      }
+    }
+  }
+
+  #if defined(__AVX__)
+  struct Lanes {
+    typedef __m256 V;
+    static const size_t WIDTH = 8;
+    static V load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, V v) { _mm256_storeu_ps(p, v); }
+    static V set(float f) { return _mm256_set1_ps(f); }
+    static V zero() { return _mm256_setzero_ps(); }
+    static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static V negate(V a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+    static V outside(V next, V lo, V hi) {
+      return _mm256_or_ps(_mm256_cmp_ps(next, lo, _CMP_LE_OQ), _mm256_cmp_ps(next, hi, _CMP_GE_OQ));
+    }
+    static V select(V mask, V a, V b) { return _mm256_blendv_ps(b, a, mask); }
+    static unsigned bits(V mask) { return static_cast<unsigned>(_mm256_movemask_ps(mask)); }
+  };
+  #elif defined(__SSE2__)
+  struct Lanes {
+    typedef __m128 V;
+    static const size_t WIDTH = 4;
+    static V load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, V v) { _mm_storeu_ps(p, v); }
+    static V set(float f) { return _mm_set1_ps(f); }
+    static V zero() { return _mm_setzero_ps(); }
+    static V add(V a, V b) { return _mm_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static V negate(V a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+    static V outside(V next, V lo, V hi) {
+      return _mm_or_ps(_mm_cmple_ps(next, lo), _mm_cmpge_ps(next, hi));
+    }
+    static V select(V mask, V a, V b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+    static unsigned bits(V mask) { return static_cast<unsigned>(_mm_movemask_ps(mask)); }
+  };
+  #endif
+
+  #if defined(__AVX__) || defined(__SSE2__)
+  // one axis for a full set of lanes - returns the lanes that touched the bounds
+  static inline unsigned stepAxes(Response response, Lanes::V scale, Lanes::V lo, Lanes::V hi, float* position, float* velocity) {
+    Lanes::V p = Lanes::load(position);
+    Lanes::V v = Lanes::load(velocity);
+    Lanes::V next = Lanes::add(p, Lanes::mul(v, scale));
+    Lanes::V hit = Lanes::outside(next, lo, hi);
+
+    if (response == PASS) {
+      Lanes::store(position, next);
+    } else {
+      Lanes::store(position, Lanes::select(hit, p, next));
+      Lanes::store(velocity, Lanes::select(hit, response == REFLECT ? Lanes::negate(v) : Lanes::zero(), v));
+    }
+
+    return Lanes::bits(hit);
+  }
+
+  // processes whole sets of lanes and returns how many bodies were done
+  static size_t integrateLanes(
+    Settings const& settings,
+    float* x,
+    float* y,
+    float* vx,
+    float* vy,
+    const float* radius,
+    size_t count,
+    float deltaTime,
+    std::vector<Collision>* collisions) {
+    const Lanes::V scale = Lanes::set(settings.speed * deltaTime);
+    const Lanes::V left = Lanes::set(settings.left);
+    const Lanes::V top = Lanes::set(settings.top);
+    const Lanes::V right = Lanes::set(settings.right);
+    const Lanes::V bottom = Lanes::set(settings.bottom);
+
+    size_t end = count - (count % Lanes::WIDTH);
+
+    for (size_t i = 0; i < end; i += Lanes::WIDTH) {
+      Lanes::V r = Lanes::load(radius + i);
+
+      unsigned hitX = stepAxes(settings.response, scale, Lanes::add(left, r), Lanes::sub(right, r), x + i, vx + i);
+      unsigned hitY = stepAxes(settings.response, scale, Lanes::add(top, r), Lanes::sub(bottom, r), y + i, vy + i);
+
+      if ((hitX | hitY) && collisions) {
+        for (size_t lane = 0; lane < Lanes::WIDTH; lane++) {
+          uint32_t axes = ((hitX >> lane) & 1) * AXIS_X | ((hitY >> lane) & 1) * AXIS_Y;
+          if (axes) {
+            Collision collision = { static_cast<uint32_t>(i + lane), axes };
+            collisions->push_back(collision);
+          }
+        }
+      }
+    }
+
+    return end;
+  }
+  #endif
+
+  const char* instructionSet() {
+    #if defined(__AVX__)
+    return "avx";
+    #elif defined(__SSE2__)
+    return "sse2";
+    #else
+    return "scalar";
+    #endif
+  }
+
+  void integrate(
+    Settings const& settings,
+    float* x,
+    float* y,
+    float* vx,
+    float* vy,
+    const float* radius,
+    size_t count,
+    float deltaTime,
+    std::vector<Collision>* collisions) {
+    size_t done = 0;
+
+    #if defined(__AVX__) || defined(__SSE2__)
+    done = integrateLanes(settings, x, y, vx, vy, radius, count, deltaTime, collisions);
+    #endif
+
+    integrateScalar(settings, x, y, vx, vy, radius, done, count, deltaTime, collisions);
+  }
+}
@@ -0,0 +1,81 @@
+#ifndef KINEMATICS_H
+#define KINEMATICS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// bulk movement and bounds-bounce over packed position / velocity / radius arrays
+//
+// this is the per-ball work of the demo scripts done natively for any number of bodies:
+// integrate the position, test the next position against the bounds (inset by the radius) and
+// respond on the axis that hit. the loop is vectorised with AVX when the compiler targets it
+// (eg CFLAGS += -mavx), otherwise SSE2, with a scalar loop for the remainder and other cpus
+namespace kinematics {
+  enum Response {
+    // reverse the velocity on the axis that hit and hold the position on that axis (the demo behaviour)
+    REFLECT,
+    // zero the velocity on the axis that hit and hold the position on that axis
+    STOP,
+    // keep moving - collisions are only reported
+    PASS
+  };
+
+  struct Settings {
+    // velocity multiplier
+    float speed;
+    float left;
+    float top;
+    float right;
+    float bottom;
+    Response response;
+
+    Settings();
+  };
+
+  // axes that touched the bounds
+  enum Axis {
+    AXIS_X = 1,
+    AXIS_Y = 2
+  };
+
+  struct Collision {
+    uint32_t index;
+    uint32_t axes;
+  };
+
+  // response names used by scripts: "reflect", "stop", "pass"
+  bool parseResponse(const char* name, Response* response);
+
+  // the name of the instruction set the kernel was compiled for: "avx", "sse2" or "scalar"
+  const char* instructionSet();
+
+  // moves count bodies - collisions (may be null) receives one entry per body that touched the bounds
+  void integrate(
+    Settings const& settings,
+    float* x,
+    float* y,
+    float* vx,
+    float* vy,
+    const float* radius,
+    size_t count,
+    float deltaTime,
+    std::vector<Collision>* collisions
+  );
+
+  // the scalar loop on its own - used for the remainder, and KinematicsBench checks the vector paths against it
+  void integrateScalar(
+    Settings const& settings,
+    float* x,
+    float* y,
+    float* vx,
+    float* vy,
+    const float* radius,
+    size_t begin,
+    size_t end,
+    float deltaTime,
+    std::vector<Collision>* collisions
+  );
+}
+
+#endif // !KINEMATICS_H
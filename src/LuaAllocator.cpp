@@ -0,0 +1,314 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "LuaAllocator.hpp"
+
+static LuaAllocator::Mode currentMode = LuaAllocator::POOLED;
+
+namespace {
+  // the slab header keeps the blocks after it aligned
+  const size_t HEADER_SIZE = 64;
+
+  size_t blockSize(int sizeClass) {
+    return (sizeClass + 1) * LuaAllocator::GRANULE;
+  }
+
+  int sizeClassOf(size_t size) {
+    return static_cast<int>((size - 1) / LuaAllocator::GRANULE);
+  }
+
+  size_t slabCapacity(int sizeClass) {
+    return (LuaAllocator::SLAB_SIZE - HEADER_SIZE) / blockSize(sizeClass);
+  }
+
+  // the same as lauxlib's - it is static there
+  int panic(lua_State* L) {
+    std::fprintf(stderr, "PANIC: unprotected error in call to Lua API (%s)\n", lua_tostring(L, -1));
+    std::fflush(stderr);
+    return 0;
+  }
+}
+
+bool LuaAllocator::parseMode(std::string const& name, Mode* mode) {
+  if (name == "system") {
+    *mode = SYSTEM;
+  } else if (name == "pool") {
+    *mode = POOLED;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void LuaAllocator::setMode(Mode mode) {
+  currentMode = mode;
+}
+
+LuaAllocator::Mode LuaAllocator::getMode() {
+  return currentMode;
+}
+
+lua_State* LuaAllocator::newState() {
+  LuaAllocator* allocator = new LuaAllocator(currentMode);
+  lua_State* L = lua_newstate(allocate, allocator);
+  if (L == nullptr) {
+    delete allocator;
+    return nullptr;
+  }
+  lua_atpanic(L, panic);
+  return L;
+}
+
+void LuaAllocator::closeState(lua_State* L) {
+  void* userData = nullptr;
+  lua_Alloc function = lua_getallocf(L, &userData);
+  lua_close(L);
+
+  if (function == allocate) {
+    delete static_cast<LuaAllocator*>(userData);
+  }
+}
+
+LuaAllocator* LuaAllocator::getAllocator(lua_State* L) {
+  void* userData = nullptr;
+  return lua_getallocf(L, &userData) == allocate ? static_cast<LuaAllocator*>(userData) : nullptr;
+}
+
+LuaAllocator::LuaAllocator(Mode mode)
+  : mode(mode),
+    slabsInUse(nullptr),
+    spareCount(0),
+    strayCount(0) {
+  static_assert(sizeof(Slab) <= HEADER_SIZE, "the slab header outgrew its space");
+
+  for (int i = 0; i < CLASSES; i++) {
+    available[i] = nullptr;
+  }
+}
+
+LuaAllocator::~LuaAllocator() {
+  for (int i = 0; i < spareCount; i++) {
+    std::free(spareSlabs[i]);
+  }
+}
+
+void* LuaAllocator::allocate(void* userData, void* block, size_t oldSize, size_t newSize) {
+  LuaAllocator* allocator = static_cast<LuaAllocator*>(userData);
+
+  // for new blocks oldSize holds the type of the object instead of a size
+  if (block == nullptr) {
+    oldSize = 0;
+  }
+
+  void* result = nullptr;
+  if (allocator->mode == POOLED) {
+    result = allocator->allocatePooled(block, oldSize, newSize);
+  } else if (newSize == 0) {
+    std::free(block);
+  } else {
+    result = std::realloc(block, newSize);
+    // a shrink must not fail
+    if (result == nullptr && newSize < oldSize) {
+      result = block;
+    }
+  }
+
+  if (newSize == 0) {
+    if (block != nullptr) {
+      allocator->stats.freed(oldSize);
+    }
+  } else if (result != nullptr) {
+    if (block == nullptr) {
+      allocator->stats.allocated(newSize);
+    } else {
+      allocator->stats.resized(oldSize, newSize);
+    }
+  }
+  return result;
+}
+
+void* LuaAllocator::allocatePooled(void* block, size_t oldSize, size_t newSize) {
+  Slab* slab = block != nullptr ? slabOf(block, oldSize) : nullptr;
+  bool stray = block != nullptr && slab == nullptr && oldSize <= MAX_SMALL;
+
+  if (newSize == 0) {
+    if (slab != nullptr) {
+      freeSmall(block, slab);
+    } else if (block != nullptr) {
+      std::free(block);
+      if (stray) {
+        strayCount--;
+      }
+    }
+    return nullptr;
+  }
+
+  if (block == nullptr) {
+    return newSize <= MAX_SMALL ? allocateSmall(sizeClassOf(newSize)) : std::malloc(newSize);
+  }
+
+  if (slab == nullptr && newSize > MAX_SMALL) {
+    void* resized = std::realloc(block, newSize);
+    if (resized == nullptr) {
+      return newSize < oldSize ? block : nullptr;
+    }
+    if (stray) {
+      strayCount--;
+    }
+    return resized;
+  }
+
+  if (slab != nullptr && sizeClassOf(newSize) == slab->sizeClass) {
+    return block;
+  }
+
+  // the block moves between a slab and malloc or between size classes
+  void* resized = newSize <= MAX_SMALL ? allocateSmall(sizeClassOf(newSize)) : std::malloc(newSize);
+  if (resized == nullptr) {
+    if (newSize >= oldSize) {
+      return nullptr;
+    }
+    // the shrink keeps the old block, which has room for it
+    if (slab == nullptr && !stray) {
+      strayCount++;
+    }
+    return block;
+  }
+  std::memcpy(resized, block, oldSize < newSize ? oldSize : newSize);
+
+  if (slab != nullptr) {
+    freeSmall(block, slab);
+  } else {
+    std::free(block);
+    if (stray) {
+      strayCount--;
+    }
+  }
+  return resized;
+}
+
+void* LuaAllocator::allocateSmall(int sizeClass) {
+  Slab* slab = available[sizeClass];
+  if (slab == nullptr) {
+    slab = newSlab(sizeClass);
+    if (slab == nullptr) {
+      return nullptr;
+    }
+    link(slab, sizeClass);
+  }
+
+  void* block = slab->freeBlocks;
+  if (block != nullptr) {
+    slab->freeBlocks = *static_cast<void**>(block);
+  } else {
+    block = slab->untouched;
+    slab->untouched += blockSize(sizeClass);
+  }
+
+  if (++slab->used == slabCapacity(sizeClass)) {
+    unlink(slab, sizeClass);
+  }
+  return block;
+}
+
+LuaAllocator::Slab* LuaAllocator::slabOf(void* block, size_t size) const {
+  if (size > MAX_SMALL) {
+    return nullptr;
+  }
+
+  // slabs are aligned to their size
+  Slab* slab = reinterpret_cast<Slab*>(reinterpret_cast<uintptr_t>(block) & ~(SLAB_SIZE - 1));
+  if (strayCount == 0) {
+    return slab;
+  }
+
+  // the masked address of a stray is not ours to read
+  for (Slab* inUse = slabsInUse; inUse != nullptr; inUse = inUse->nextInUse) {
+    if (inUse == slab) {
+      return slab;
+    }
+  }
+  return nullptr;
+}
+
+void LuaAllocator::freeSmall(void* block, Slab* slab) {
+  // the slab's class - lua may know the block by a smaller size after a failed shrink
+  int sizeClass = slab->sizeClass;
+  if (slab->used == slabCapacity(sizeClass)) {
+    link(slab, sizeClass);
+  }
+
+  *static_cast<void**>(block) = slab->freeBlocks;
+  slab->freeBlocks = block;
+
+  if (--slab->used == 0) {
+    unlink(slab, sizeClass);
+    releaseSlab(slab);
+  }
+}
+
+LuaAllocator::Slab* LuaAllocator::newSlab(int sizeClass) {
+  void* memory = nullptr;
+  if (spareCount > 0) {
+    memory = spareSlabs[--spareCount];
+  } else if (posix_memalign(&memory, SLAB_SIZE, SLAB_SIZE) != 0) {
+    return nullptr;
+  }
+
+  Slab* slab = static_cast<Slab*>(memory);
+  slab->next = nullptr;
+  slab->prev = nullptr;
+  slab->freeBlocks = nullptr;
+  slab->untouched = static_cast<char*>(memory) + HEADER_SIZE;
+  slab->used = 0;
+  slab->sizeClass = sizeClass;
+
+  slab->prevInUse = nullptr;
+  slab->nextInUse = slabsInUse;
+  if (slabsInUse != nullptr) {
+    slabsInUse->prevInUse = slab;
+  }
+  slabsInUse = slab;
+  return slab;
+}
+
+void LuaAllocator::releaseSlab(Slab* slab) {
+  if (slab->prevInUse != nullptr) {
+    slab->prevInUse->nextInUse = slab->nextInUse;
+  } else {
+    slabsInUse = slab->nextInUse;
+  }
+  if (slab->nextInUse != nullptr) {
+    slab->nextInUse->prevInUse = slab->prevInUse;
+  }
+
+  if (spareCount < MAX_SPARE_SLABS) {
+    spareSlabs[spareCount++] = slab;
+  } else {
+    std::free(slab);
+  }
+}
+
+void LuaAllocator::link(Slab* slab, int sizeClass) {
+  slab->prev = nullptr;
+  slab->next = available[sizeClass];
+  if (slab->next != nullptr) {
+    slab->next->prev = slab;
+  }
+  available[sizeClass] = slab;
+}
+
+void LuaAllocator::unlink(Slab* slab, int sizeClass) {
+  if (slab->prev != nullptr) {
+    slab->prev->next = slab->next;
+  } else {
+    available[sizeClass] = slab->next;
+  }
+  if (slab->next != nullptr) {
+    slab->next->prev = slab->prev;
+  }
+  slab->next = nullptr;
+  slab->prev = nullptr;
+}
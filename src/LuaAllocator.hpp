@@ -0,0 +1,107 @@
+#ifndef LUAALLOCATOR_H
+#define LUAALLOCATOR_H
+
+#include <cstddef>
+#include <string>
+
+#include "MemoryStats.hpp"
+#include "lua/lua.hpp"
+
+// the allocator behind the engine's lua states. lua allocates lots of small, short lived blocks
+// (strings, tables, closures, upvalues), which the system allocator serves with locks and scatters
+// over the heap. POOLED serves blocks up to MAX_SMALL bytes from slabs: SLAB_SIZE aligned chunks cut
+// into blocks of one size class (multiples of GRANULE), with a free list each. larger blocks go to
+// malloc. lua passes the size of every block it frees, so a block needs no header
+//
+// every state gets an allocator of its own and a state is only used by one thread at a time, so the
+// slabs are never shared and need no locks - the job workers' states pool on their own threads
+//
+// slabs that empty are given back to the system, apart from a few kept to start new slabs with.
+// both modes count the state's memory as it is allocated (getStats)
+//
+// lua counts on shrinking never failing (the collector shrinks blocks), so a shrink that can't get
+// its new block keeps the old one. lua then knows the block by a smaller size than its real one: a
+// slab block stays in its slab, whose header keeps the class, and a malloc block that lua now sees
+// as small is a stray - while there are strays, a small block is only taken for a slab block once
+// it is found among the slabs
+class LuaAllocator {
+  public:
+    enum Mode {
+      // realloc and free, like lauxlib's allocator
+      SYSTEM,
+      POOLED
+    };
+
+    // "system" or "pool"
+    static bool parseMode(std::string const& name, Mode* mode);
+
+    // the mode of the states created from now on (POOLED) - set at startup, see --lua-alloc
+    static void setMode(Mode mode);
+    static Mode getMode();
+
+    // creates a lua state in the current mode, or returns nullptr like luaL_newstate
+    static lua_State* newState();
+    // closes a state from newState along with its allocator
+    static void closeState(lua_State* L);
+    // the allocator of a state from newState - nullptr for other states
+    static LuaAllocator* getAllocator(lua_State* L);
+
+    explicit LuaAllocator(Mode mode);
+    // gives back the slabs - every block must have been freed
+    ~LuaAllocator();
+
+    // a lua_Alloc - userData is the allocator
+    static void* allocate(void* userData, void* block, size_t oldSize, size_t newSize);
+
+    // the sizes lua asked for - the slabs' and malloc's own overhead is not included
+    MemoryStats const& getStats() const { return stats; }
+
+    static const size_t GRANULE = 16;
+    static const size_t MAX_SMALL = 256;
+    static const size_t SLAB_SIZE = 16 * 1024;
+
+  private:
+    static const int CLASSES = MAX_SMALL / GRANULE;
+    // empty slabs kept for reuse by any size class
+    static const int MAX_SPARE_SLABS = 4;
+
+    struct Slab {
+      Slab* next;
+      Slab* prev;
+      // every slab in use, full or not - searched for strays only
+      Slab* nextInUse;
+      Slab* prevInUse;
+      // blocks that were freed
+      void* freeBlocks;
+      // the blocks past it were never handed out
+      char* untouched;
+      size_t used;
+      int sizeClass;
+    };
+
+    LuaAllocator(LuaAllocator const&);
+    LuaAllocator& operator=(LuaAllocator const&);
+
+    void* allocatePooled(void* block, size_t oldSize, size_t newSize);
+    void* allocateSmall(int sizeClass);
+    // the slab of a block lua knows by size - nullptr for malloc blocks
+    Slab* slabOf(void* block, size_t size) const;
+    void freeSmall(void* block, Slab* slab);
+    Slab* newSlab(int sizeClass);
+    void releaseSlab(Slab* slab);
+    void link(Slab* slab, int sizeClass);
+    void unlink(Slab* slab, int sizeClass);
+
+    Mode mode;
+    MemoryStats stats;
+
+    // slabs of each class with free blocks - full slabs are in no list
+    Slab* available[CLASSES];
+    Slab* slabsInUse;
+    Slab* spareSlabs[MAX_SPARE_SLABS];
+    int spareCount;
+    // malloc blocks lua knows by a size of MAX_SMALL or less, after a failed shrink
+    size_t strayCount;
+};
+
+#endif // !LUAALLOCATOR_H
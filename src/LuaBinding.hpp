@@ -0,0 +1,98 @@
+#ifndef LUABINDING_H
+#define LUABINDING_H
+
+#include "Binding.hpp"
+#include "LuaBuffer.hpp"
+#include "lua/lua.hpp"
+
+// generates lua_CFunction glue for a native function - see Binding.hpp
+// arguments are read from the top of the stack so both engine:fn(...) and engine.fn(...) work
+
+namespace binding {
+  namespace lua {
+    template <typename T> struct Arg;
+
+    template <> struct Arg<int> {
+      static int get(lua_State* L, int index) {
+        return static_cast<int>(luaL_checknumber(L, index));
+      }
+    };
+
+    template <> struct Arg<float> {
+      static float get(lua_State* L, int index) {
+        return static_cast<float>(luaL_checknumber(L, index));
+      }
+    };
+
+    template <> struct Arg<double> {
+      static double get(lua_State* L, int index) {
+        return static_cast<double>(luaL_checknumber(L, index));
+      }
+    };
+
+    template <> struct Arg<bool> {
+      static bool get(lua_State* L, int index) {
+        return lua_toboolean(L, index) != 0;
+      }
+    };
+
+    template <> struct Arg<const char*> {
+      static const char* get(lua_State* L, int index) {
+        return luaL_checkstring(L, index);
+      }
+    };
+
+    template <> struct Arg<NumericBuffer*> {
+      static NumericBuffer* get(lua_State* L, int index) {
+        return LuaBuffer::check(L, index);
+      }
+    };
+
+    inline void push(lua_State* L, int value) { lua_pushinteger(L, value); }
+    inline void push(lua_State* L, float value) { lua_pushnumber(L, value); }
+    inline void push(lua_State* L, double value) { lua_pushnumber(L, value); }
+    inline void push(lua_State* L, bool value) { lua_pushboolean(L, value); }
+    inline void push(lua_State* L, const char* value) { lua_pushstring(L, value); }
+
+    template <typename R> struct Invoke {
+      template <typename Fn, typename... Values>
+      static int call(lua_State* L, Fn fn, Values... values) {
+        push(L, fn(values...));
+        return 1;
+      }
+    };
+
+    template <> struct Invoke<void> {
+      template <typename Fn, typename... Values>
+      static int call(lua_State* L, Fn fn, Values... values) {
+        fn(values...);
+        return 0;
+      }
+    };
+
+    template <typename Fn, Fn fn> struct Function;
+
+    template <typename R, typename... Args, R (*fn)(Args...)>
+    struct Function<R (*)(Args...), fn> {
+      typedef Signature<R (*)(Args...)> Traits;
+
+      static int call(lua_State* L) {
+        int base = lua_gettop(L) - Traits::arity;
+        if (base < 0) {
+          return luaL_error(L, "expected %d arguments, got %d", Traits::arity, lua_gettop(L));
+        }
+        return invoke(L, base, typename Traits::Indices());
+      }
+
+      template <std::size_t... I>
+      static int invoke(lua_State* L, int base, std::index_sequence<I...>) {
+        return Invoke<R>::call(L, fn, Arg<Args>::get(L, base + static_cast<int>(I) + 1)...);
+      }
+    };
+  }
+}
+
+// lua_CFunction for a native function
+#define LUA_BINDING(fn) binding::lua::Function<decltype(&fn), &fn>::call
+
+#endif // !LUABINDING_H
@@ -0,0 +1,122 @@
+#include <exception>
+#include <new>
+
+#include "LuaBuffer.hpp"
+
+static const char* BUFFER_METATABLE = "engine.Buffer";
+
+static NumericBufferRef* checkReference(lua_State* L, int index) {
+  return static_cast<NumericBufferRef*>(luaL_checkudata(L, index, BUFFER_METATABLE));
+}
+
+// converts a 1 based lua index into a 0 based element index or raises a lua error
+static size_t checkElement(lua_State* L, NumericBuffer* buffer, int index) {
+  lua_Integer element = luaL_checkinteger(L, index);
+  if (element < 1 || static_cast<size_t>(element) > buffer->size()) {
+    luaL_error(L, "buffer index %d out of range (size %d)", static_cast<int>(element), static_cast<int>(buffer->size()));
+  }
+  return static_cast<size_t>(element - 1);
+}
+
+static int bufferGc(lua_State* L) {
+  NumericBufferRef* ref = checkReference(L, 1);
+  ref->~NumericBufferRef();
+  return 0;
+}
+
+static int bufferLen(lua_State* L) {
+  lua_pushinteger(L, static_cast<lua_Integer>(LuaBuffer::check(L, 1)->size()));
+  return 1;
+}
+
+static int bufferType(lua_State* L) {
+  lua_pushstring(L, NumericBuffer::typeName(LuaBuffer::check(L, 1)->getType()));
+  return 1;
+}
+
+static int bufferFill(lua_State* L) {
+  LuaBuffer::check(L, 1)->fill(luaL_checknumber(L, 2));
+  return 0;
+}
+
+static int bufferIndex(lua_State* L) {
+  NumericBuffer* buffer = LuaBuffer::check(L, 1);
+
+  if (lua_type(L, 2) == LUA_TNUMBER) {
+    size_t element = checkElement(L, buffer, 2);
+    if (buffer->getType() == NumericBuffer::INT32) {
+      lua_pushinteger(L, buffer->int32()[element]);
+    } else {
+      lua_pushnumber(L, buffer->get(element));
+    }
+    return 1;
+  }
+
+  // methods live in the metatable
+  lua_getmetatable(L, 1);
+  lua_pushvalue(L, 2);
+  lua_rawget(L, -2);
+  return 1;
+}
+
+static int bufferNewIndex(lua_State* L) {
+  NumericBuffer* buffer = LuaBuffer::check(L, 1);
+  size_t element = checkElement(L, buffer, 2);
+  buffer->set(element, luaL_checknumber(L, 3));
+  return 0;
+}
+
+void LuaBuffer::registerType(lua_State* L) {
+  luaL_Reg methods[] = {
+    { "__gc", bufferGc },
+    { "__len", bufferLen },
+    { "__index", bufferIndex },
+    { "__newindex", bufferNewIndex },
+    { "size", bufferLen },
+    { "type", bufferType },
+    { "fill", bufferFill },
+    { nullptr, nullptr }
+  };
+
+  luaL_newmetatable(L, BUFFER_METATABLE);
+  luaL_setfuncs(L, methods, 0);
+  lua_pop(L, 1);
+}
+
+void LuaBuffer::push(lua_State* L, NumericBufferRef const& buffer) {
+  void* memory = lua_newuserdata(L, sizeof(NumericBufferRef));
+  new (memory) NumericBufferRef(buffer);
+  luaL_setmetatable(L, BUFFER_METATABLE);
+}
+
+NumericBuffer* LuaBuffer::check(lua_State* L, int index) {
+  return checkReference(L, index)->get();
+}
+
+int LuaBuffer::apiCreateBuffer(lua_State* L) {
+  // arguments are read from the top so engine:createBuffer and engine.createBuffer both work
+  const char* typeName = luaL_checkstring(L, -2);
+  lua_Integer count = luaL_checkinteger(L, -1);
+
+  NumericBuffer::Type type;
+  if (!NumericBuffer::parseType(typeName, &type)) {
+    return luaL_error(L, "unknown buffer type %s (expected float32, float64 or int32)", typeName);
+  }
+
+  if (count < 0) {
+    return luaL_error(L, "buffer size must not be negative");
+  }
+
+  // the error is raised outside the handler - no C++ exception may cross the interpreter's frames
+  NumericBufferRef buffer;
+  try {
+    buffer = std::make_shared<NumericBuffer>(type, static_cast<size_t>(count));
+  } catch (std::exception const&) {
+  }
+  if (!buffer) {
+    return luaL_error(L, "unable to allocate a buffer of %I elements", count);
+  }
+
+  push(L, buffer);
+  return 1;
+}
@@ -0,0 +1,24 @@
+#ifndef LUABUFFER_H
+#define LUABUFFER_H
+
+#include "NumericBuffer.hpp"
+#include "lua/lua.hpp"
+
+// exposes NumericBuffer to lua as a full userdata holding a reference to the engine buffer
+// elements are indexed from 1 like lua arrays: buf[1] = 2.5, #buf, buf:type()
+class LuaBuffer {
+  public:
+    // creates the metatable shared by every buffer userdata
+    static void registerType(lua_State* L);
+
+    // pushes a userdata referencing the buffer
+    static void push(lua_State* L, NumericBufferRef const& buffer);
+
+    // returns the buffer at the stack index or raises a lua error
+    static NumericBuffer* check(lua_State* L, int index);
+
+    // engine:createBuffer(type, count)
+    static int apiCreateBuffer(lua_State* L);
+};
+
+#endif // !LUABUFFER_H
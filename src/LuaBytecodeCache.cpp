@@ -0,0 +1,139 @@
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "LuaBytecodeCache.hpp"
+
+static const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+static uint64_t fnv1a(const char* data, size_t size, uint64_t hash) {
+  for (size_t i = 0; i < size; i++) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+// an entry's header: the source hash and the bytecode checksum in hex, and a newline
+static const size_t HEADER_SIZE = 16 + 16 + 1;
+
+static std::string hexKey(uint64_t key) {
+  std::stringstream hex;
+  hex << std::hex << std::setw(16) << std::setfill('0') << key;
+  return hex.str();
+}
+
+static bool readFile(std::string const& filename, std::string& contents) {
+  std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!file) {
+    return false;
+  }
+
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  contents = buffer.str();
+  return true;
+}
+
+static int writeChunk(lua_State* L, const void* data, size_t size, void* userData) {
+  static_cast<std::string*>(userData)->append(static_cast<const char*>(data), size);
+  return 0;
+}
+
+LuaBytecodeCache::LuaBytecodeCache()
+  : hits(0),
+    misses(0),
+    #ifdef LUA_STRIP_BYTECODE
+    strip(true) {
+    #else
+    strip(false) {
+    #endif
+}
+
+void LuaBytecodeCache::setDirectory(std::string const& directory) {
+  this->directory = directory;
+
+  if (!directory.empty()) {
+    // an existing directory is fine and a failure only means nothing gets cached
+    mkdir(directory.c_str(), 0755);
+  }
+}
+
+int LuaBytecodeCache::load(lua_State* L, std::string const& filename) {
+  std::string source;
+  if (directory.empty() || !readFile(filename, source)) {
+    return luaL_loadfile(L, filename.c_str());
+  }
+
+  std::string chunkName = "@" + filename;
+
+  // everything that changes the bytecode but the source names the entry - one per script, so an
+  // edited script overwrites its entry rather than adding one
+  std::stringstream header;
+  header << LUA_RELEASE << ':' << sizeof(lua_Integer) << ':' << sizeof(lua_Number) << ':' << strip << ':' << chunkName << ':';
+  std::string prefix = header.str();
+  uint64_t nameKey = fnv1a(prefix.data(), prefix.size(), FNV_OFFSET_BASIS);
+  uint64_t sourceKey = fnv1a(source.data(), source.size(), nameKey);
+
+  std::string cacheFilename = directory + '/' + hexKey(nameKey) + ".luac";
+
+  // the entry starts with the hash of the source it was compiled from and a checksum of the bytecode
+  // after the header - undump does not validate its input, so a damaged file must never reach it
+  std::string sourceStamp = hexKey(sourceKey);
+
+  std::string entry;
+  if (readFile(cacheFilename, entry) && entry.size() >= HEADER_SIZE && entry.compare(0, sourceStamp.size(), sourceStamp) == 0
+    && entry[HEADER_SIZE - 1] == '\n') {
+    const char* bytecode = entry.data() + HEADER_SIZE;
+    size_t bytecodeSize = entry.size() - HEADER_SIZE;
+    std::string checksum = hexKey(fnv1a(bytecode, bytecodeSize, FNV_OFFSET_BASIS));
+
+    // damaged files fail the checksum
+    if (entry.compare(sourceStamp.size(), checksum.size(), checksum) == 0) {
+      // binary mode only - a cache file can never be compiled as source
+      if (luaL_loadbufferx(L, bytecode, bytecodeSize, chunkName.c_str(), "b") == LUA_OK) {
+        hits++;
+        return LUA_OK;
+      }
+
+      // written by an incompatible build - compile it again
+      lua_pop(L, 1);
+    }
+  }
+
+  misses++;
+
+  // luaL_loadfile also skips a leading # line like the standalone interpreter
+  int status = luaL_loadfile(L, filename.c_str());
+  if (status != LUA_OK) {
+    return status;
+  }
+
+  std::string bytecode;
+  if (lua_dump(L, writeChunk, &bytecode, strip) == 0) {
+    bytecode.insert(0, sourceStamp + hexKey(fnv1a(bytecode.data(), bytecode.size(), FNV_OFFSET_BASIS)) + '\n');
+
+    // write to a temporary file first so another process never reads a partial chunk - the job
+    // workers' caches write from threads of the same process
+    std::stringstream temporary;
+    temporary << cacheFilename << '.' << getpid() << '.' << this;
+    std::string temporaryFilename = temporary.str();
+
+    std::ofstream file(temporaryFilename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (file) {
+      file.write(bytecode.data(), static_cast<std::streamsize>(bytecode.size()));
+      file.close();
+      if (!file || std::rename(temporaryFilename.c_str(), cacheFilename.c_str()) != 0) {
+        std::remove(temporaryFilename.c_str());
+      }
+    }
+  }
+
+  return LUA_OK;
+}
@@ -0,0 +1,47 @@
+#ifndef LUABYTECODECACHE_H
+#define LUABYTECODECACHE_H
+
+#include <cstddef>
+#include <string>
+
+#include "lua/lua.hpp"
+
+// loads lua scripts through a directory of precompiled chunks
+//
+// the first time a script is loaded it is compiled as usual and the bytecode from lua_dump is written to
+// <directory>/<key>.luac, where the key is an FNV-1a hash of the script's chunk name and the vm version and
+// number sizes. the entry starts with a hash of the script's contents: later loads of the same contents
+// read the bytecode in binary mode and skip the parser, while a changed script is compiled again and
+// overwrites its entry - every script has one entry however often hot reload recompiles it, entries are
+// never stale, and the directory can be deleted at any time. a checksum of the bytecode in the
+// header keeps damaged files away from lua's undump, which trusts its input - they are compiled again.
+//
+// builds with -DLUA_STRIP_BYTECODE cache bytecode stripped of debug information, which makes the
+// files smaller. stripped chunks report errors without file names and line numbers, and hot reload
+// cannot match their upvalues by name, so a reload resets the script's locals - other builds keep
+// the debug information. the strip mode is part of the key, so the two kinds never mix
+class LuaBytecodeCache {
+  public:
+    LuaBytecodeCache();
+
+    // where the cache files go - created when missing. an empty directory turns the cache off
+    void setDirectory(std::string const& directory);
+    std::string const& getDirectory() const { return directory; }
+
+    // the cached bytecode has no debug information (LUA_STRIP_BYTECODE)
+    bool isStripping() const { return strip; }
+
+    // loads a script like luaL_loadfile: pushes the compiled chunk and returns LUA_OK,
+    // or pushes an error message and returns the error code
+    int load(lua_State* L, std::string const& filename);
+
+    // loads that were served from / missed the cache
+    size_t hits;
+    size_t misses;
+
+  private:
+    std::string directory;
+    bool strip;
+};
+
+#endif // !LUABYTECODECACHE_H
@@ -0,0 +1,332 @@
+#include <iostream>
+#include <cstring>
+
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "LuaHotReloader.hpp"
+#include "LuaBytecodeCache.hpp"
+
+static long long modificationTime(std::string const& filename) {
+  struct stat info;
+  if (stat(filename.c_str(), &info) != 0) {
+    return 0;
+  }
+  return static_cast<long long>(info.st_mtime);
+}
+
+// true for functions written in lua - c functions have no upvalue names to join
+static bool isLuaFunction(lua_State* L, int index) {
+  return lua_isfunction(L, index) && !lua_iscfunction(L, index);
+}
+
+LuaHotReloader::LuaHotReloader(lua_State* L, LuaBytecodeCache& cache)
+  : L(L),
+    cache(cache),
+    inotifyFd(-1) {
+  #ifdef __linux__
+  inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  #endif
+}
+
+LuaHotReloader::~LuaHotReloader() {
+  #ifdef __linux__
+  if (inotifyFd >= 0) {
+    close(inotifyFd);
+    inotifyFd = -1;
+  }
+  #endif
+}
+
+void LuaHotReloader::watch(std::string const& filename, std::string const& moduleName) {
+  for (size_t i = 0; i < files.size(); i++) {
+    if (files[i].script.filename == filename) {
+      return;
+    }
+  }
+
+  WatchedFile file;
+  file.script.filename = filename;
+  file.script.moduleName = moduleName;
+
+  size_t slash = filename.rfind('/');
+  if (slash == std::string::npos) {
+    file.directory = ".";
+    file.name = filename;
+  } else {
+    file.directory = slash == 0 ? "/" : filename.substr(0, slash);
+    file.name = filename.substr(slash + 1);
+  }
+
+  file.watchDescriptor = -1;
+  file.modified = modificationTime(filename);
+  file.changed = false;
+
+  #ifdef __linux__
+  if (inotifyFd >= 0) {
+    std::map<std::string, int>::iterator found = directories.find(file.directory);
+    if (found != directories.end()) {
+      file.watchDescriptor = found->second;
+    } else {
+      // editors often save by writing a new file and renaming it over the old one
+      int watchDescriptor = inotify_add_watch(inotifyFd, file.directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+      if (watchDescriptor >= 0) {
+        directories[file.directory] = watchDescriptor;
+        file.watchDescriptor = watchDescriptor;
+      }
+    }
+  }
+  #endif
+
+  files.push_back(file);
+}
+
+void LuaHotReloader::markChanged(int watchDescriptor, const char* name) {
+  for (size_t i = 0; i < files.size(); i++) {
+    WatchedFile& file = files[i];
+    if (file.watchDescriptor == watchDescriptor && file.name == name) {
+      file.changed = true;
+    }
+  }
+}
+
+void LuaHotReloader::poll(std::vector<Script>& changed) {
+  #ifdef __linux__
+  if (inotifyFd >= 0) {
+    // the descriptor is non-blocking so this stops as soon as the queued events are drained
+    alignas(struct inotify_event) char buffer[4096];
+    for (;;) {
+      ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+      if (length <= 0) {
+        break;
+      }
+
+      for (char* cursor = buffer; cursor < buffer + length;) {
+        struct inotify_event* event = reinterpret_cast<struct inotify_event*>(cursor);
+        if (event->len > 0) {
+          markChanged(event->wd, event->name);
+        }
+        cursor += sizeof(struct inotify_event) + event->len;
+      }
+    }
+  }
+  #endif
+
+  for (size_t i = 0; i < files.size(); i++) {
+    WatchedFile& file = files[i];
+
+    // files without an inotify watch are checked by modification time
+    if (file.watchDescriptor < 0) {
+      long long modified = modificationTime(file.script.filename);
+      if (modified != 0 && modified != file.modified) {
+        file.modified = modified;
+        file.changed = true;
+      }
+    }
+
+    if (file.changed) {
+      file.changed = false;
+      changed.push_back(file.script);
+    }
+  }
+}
+
+bool LuaHotReloader::reload(Script const& script) {
+  int top = lua_gettop(L);
+
+  if (cache.load(L, script.filename) != LUA_OK) {
+    std::cerr << "Unable to reload " << script.filename << ": " << lua_tostring(L, -1) << std::endl;
+    lua_settop(L, top);
+    return false;
+  }
+  int chunk = lua_gettop(L);
+  // stack: [.., chunk]
+
+  // run the chunk in a sandbox so its definitions land in a table of their own
+  lua_newtable(L);
+  int sandbox = lua_gettop(L);
+  lua_newtable(L);
+  lua_pushglobaltable(L);
+  lua_setfield(L, -2, "__index");
+  lua_setmetatable(L, sandbox);
+  lua_pushvalue(L, sandbox);
+  // the first upvalue of a main chunk is its _ENV
+  lua_setupvalue(L, chunk, 1);
+  // stack: [.., chunk, sandbox]
+
+  lua_pushvalue(L, chunk);
+  int arguments = 0;
+  if (!script.moduleName.empty()) {
+    // modules are called like require calls them
+    lua_pushstring(L, script.moduleName.c_str());
+    lua_pushstring(L, script.filename.c_str());
+    arguments = 2;
+  }
+
+  if (lua_pcall(L, arguments, 1, 0) != LUA_OK) {
+    std::cerr << "Error reloading " << script.filename << ": " << lua_tostring(L, -1) << std::endl;
+    lua_settop(L, top);
+    return false;
+  }
+  int result = lua_gettop(L);
+  // stack: [.., chunk, sandbox, result]
+
+  lua_newtable(L);
+  int sources = lua_gettop(L);
+  lua_newtable(L);
+  int assignments = lua_gettop(L);
+  lua_newtable(L);
+  int visited = lua_gettop(L);
+  lua_pushglobaltable(L);
+  int globals = lua_gettop(L);
+  // stack: [.., chunk, sandbox, result, sources, assignments, visited, globals]
+
+  collect(globals, sandbox, sources, assignments, visited);
+
+  // a module's table is merged into the table require handed out the first time
+  if (!script.moduleName.empty() && lua_istable(L, result)) {
+    lua_getfield(L, LUA_REGISTRYINDEX, LUA_LOADED_TABLE);
+    lua_getfield(L, -1, script.moduleName.c_str());
+    if (lua_istable(L, -1)) {
+      collect(lua_gettop(L), result, sources, assignments, visited);
+    }
+    lua_pop(L, 2);
+  }
+
+  // every function gets its upvalues joined before any of them goes live
+  lua_Integer count = static_cast<lua_Integer>(lua_rawlen(L, assignments));
+  for (lua_Integer i = 1; i <= count; i++) {
+    lua_rawgeti(L, assignments, i);
+    lua_rawgeti(L, -1, 3);
+    if (isLuaFunction(L, -1)) {
+      joinUpvalues(lua_gettop(L), sources);
+    }
+    lua_pop(L, 2);
+  }
+
+  for (lua_Integer i = 1; i <= count; i++) {
+    lua_rawgeti(L, assignments, i);
+    // stack: [.., assignment]
+    lua_rawgeti(L, -1, 1);
+    lua_rawgeti(L, -2, 2);
+    lua_rawgeti(L, -3, 3);
+    // stack: [.., assignment, table, key, value]
+    lua_rawset(L, -3);
+    lua_pop(L, 2);
+  }
+
+  // functions that were not joined to a live _ENV still see the sandbox - point it at the globals
+  lua_pushvalue(L, globals);
+  lua_setupvalue(L, chunk, 1);
+
+  lua_settop(L, top);
+  return true;
+}
+
+void LuaHotReloader::collect(int liveTable, int newTable, int sources, int assignments, int visited) {
+  luaL_checkstack(L, 8, "hot reload merge");
+
+  // tables can refer to each other - merge each one once
+  lua_pushvalue(L, newTable);
+  if (lua_rawget(L, visited) != LUA_TNIL) {
+    lua_pop(L, 1);
+    return;
+  }
+  lua_pop(L, 1);
+  lua_pushvalue(L, newTable);
+  lua_pushboolean(L, 1);
+  lua_rawset(L, visited);
+
+  lua_pushnil(L);
+  while (lua_next(L, newTable) != 0) {
+    int key = lua_gettop(L) - 1;
+    int value = key + 1;
+    lua_pushvalue(L, key);
+    lua_rawget(L, liveTable);
+    int live = lua_gettop(L);
+    // stack: [.., key, value, live]
+
+    if (isLuaFunction(L, value)) {
+      // code always replaces code
+      if (isLuaFunction(L, live)) {
+        addSources(live, sources);
+      }
+      addAssignment(liveTable, key, value, assignments);
+    } else if (lua_istable(L, value) && lua_istable(L, live)) {
+      collect(live, value, sources, assignments, visited);
+    } else if (lua_isnil(L, live)) {
+      addAssignment(liveTable, key, value, assignments);
+    }
+
+    lua_pop(L, 2);
+    // stack: [.., key]
+  }
+}
+
+void LuaHotReloader::addSources(int function, int sources) {
+  for (int i = 1;; i++) {
+    const char* name = lua_getupvalue(L, function, i);
+    if (name == nullptr) {
+      break;
+    }
+    lua_pop(L, 1);
+
+    // stripped functions have no upvalue names to match on
+    if (name[0] == '\0' || name[0] == '(' || name[0] == '?') {
+      continue;
+    }
+
+    if (lua_getfield(L, sources, name) == LUA_TNIL) {
+      lua_pushvalue(L, function);
+      lua_setfield(L, sources, name);
+    }
+    lua_pop(L, 1);
+  }
+}
+
+void LuaHotReloader::addAssignment(int table, int key, int value, int assignments) {
+  lua_createtable(L, 3, 0);
+  lua_pushvalue(L, table);
+  lua_rawseti(L, -2, 1);
+  lua_pushvalue(L, key);
+  lua_rawseti(L, -2, 2);
+  lua_pushvalue(L, value);
+  lua_rawseti(L, -2, 3);
+  lua_rawseti(L, assignments, static_cast<lua_Integer>(lua_rawlen(L, assignments)) + 1);
+}
+
+void LuaHotReloader::joinUpvalues(int function, int sources) {
+  for (int i = 1;; i++) {
+    const char* name = lua_getupvalue(L, function, i);
+    if (name == nullptr) {
+      break;
+    }
+    lua_pop(L, 1);
+
+    if (lua_getfield(L, sources, name) != LUA_TFUNCTION) {
+      // a new local - the function keeps the fresh value
+      lua_pop(L, 1);
+      continue;
+    }
+    int live = lua_gettop(L);
+
+    for (int j = 1;; j++) {
+      const char* liveName = lua_getupvalue(L, live, j);
+      if (liveName == nullptr) {
+        break;
+      }
+      lua_pop(L, 1);
+
+      if (std::strcmp(name, liveName) == 0) {
+        lua_upvaluejoin(L, function, i, live, j);
+        break;
+      }
+    }
+
+    lua_pop(L, 1);
+  }
+}
@@ -0,0 +1,72 @@
+#ifndef LUAHOTRELOADER_H
+#define LUAHOTRELOADER_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "lua/lua.hpp"
+
+class LuaBytecodeCache;
+
+// reloads changed lua scripts into a running lua state
+//
+// loaded files are watched through inotify (directories are watched so editors that save by renaming
+// are seen too) or, where inotify is not available, by checking modification times. polling never blocks.
+//
+// a changed file is compiled and run in a sandbox table whose reads fall through to the globals. its
+// definitions are then merged into the live state:
+// + functions replace the live functions of the same name, with their upvalues joined by name to the
+//   upvalues of the functions they replace so they keep working on the existing local state
+// + tables are merged key by key
+// + any other value is only added when the live state does not have it, so data survives the reload
+// a file that fails to compile or run is reported and the live state is left as it was
+class LuaHotReloader {
+  public:
+    struct Script {
+      std::string filename;
+      // the name the script was required as - empty for the main script
+      std::string moduleName;
+    };
+
+    // changed scripts are compiled through the cache so the next start finds them
+    LuaHotReloader(lua_State* L, LuaBytecodeCache& cache);
+    ~LuaHotReloader();
+
+    // starts watching a script - watching the same file again does nothing
+    void watch(std::string const& filename, std::string const& moduleName);
+
+    // collects the scripts that changed since the last poll
+    void poll(std::vector<Script>& changed);
+
+    // reloads a script - returns false (and prints why) when the script could not be reloaded
+    bool reload(Script const& script);
+
+  private:
+    struct WatchedFile {
+      Script script;
+      std::string directory;
+      std::string name;
+      // inotify watch descriptor of the directory or -1 when checking modification times
+      int watchDescriptor;
+      long long modified;
+      bool changed;
+    };
+
+    void markChanged(int watchDescriptor, const char* name);
+
+    // merge helpers - indices are absolute stack indices
+    void collect(int liveTable, int newTable, int sources, int assignments, int visited);
+    void addSources(int function, int sources);
+    void addAssignment(int table, int key, int value, int assignments);
+    void joinUpvalues(int function, int sources);
+
+    lua_State* L;
+    LuaBytecodeCache& cache;
+    int inotifyFd;
+    // directory -> inotify watch descriptor
+    std::map<std::string, int> directories;
+    std::vector<WatchedFile> files;
+};
+
+#endif // !LUAHOTRELOADER_H
@@ -0,0 +1,464 @@
+#include <iostream>
+
+#include "LuaJobSystem.hpp"
+#include "LuaAllocator.hpp"
+#include "LuaBytecodeCache.hpp"
+#include "LuaProfiler.hpp"
+#include "LuaSerializer.hpp"
+#include "Configuration.hpp"
+#include "FrameArena.hpp"
+#include "ScriptingEngine.hpp"
+#include "SharedContext.hpp"
+#include "Trace.hpp"
+
+static const char* FUTURE_TYPE = "engine.JobFuture";
+
+// instructions between the checks of a worker state that is told to stop
+static const int STOP_CHECK_INSTRUCTIONS = 1000;
+
+namespace {
+  struct Future {
+    unsigned id;
+  };
+
+  // the package.searchers entry of the worker states - require goes through the worker's bytecode
+  // cache. upvalue: the cache
+  int searchWorkerModule(lua_State* L) {
+    const char* moduleName = luaL_checkstring(L, 1);
+    LuaBytecodeCache* cache = static_cast<LuaBytecodeCache*>(lua_touserdata(L, lua_upvalueindex(1)));
+
+    lua_getglobal(L, "package");
+    lua_getfield(L, -1, "searchpath");
+    lua_pushstring(L, moduleName);
+    lua_getfield(L, -3, "path");
+    // stack: [.., package, searchpath, name, path]
+    lua_call(L, 2, 2);
+    // stack: [.., package, filename or nil, message?]
+
+    if (lua_isnil(L, -2)) {
+      // the list of files that were tried
+      return 1;
+    }
+
+    const char* filename = lua_tostring(L, -2);
+    if (cache->load(L, filename) != LUA_OK) {
+      return luaL_error(L, "error loading module '%s' from file '%s':\n\t%s", moduleName, filename, lua_tostring(L, -1));
+    }
+    // stack: [.., package, filename, message, loader]
+
+    lua_pushstring(L, filename);
+    return 2;
+  }
+
+  int traceback(lua_State* L) {
+    const char* message = lua_tostring(L, 1);
+    luaL_traceback(L, L, message ? message : "(error object is not a string)", 1);
+    return 1;
+  }
+
+  void stopHook(lua_State* L, lua_Debug* ar) {
+    luaL_error(L, "the job system stopped");
+  }
+}
+
+LuaJobSystem::LuaJobSystem(lua_State* L, ScriptingEngine* engine, LuaProfiler* profiler)
+  : L(L),
+    engine(engine),
+    profiler(profiler),
+    nextId(1),
+    stopping(false) {
+}
+
+LuaJobSystem::~LuaJobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    // a job that is still running is stopped at its next instructions
+    for (size_t i = 0; i < workerStates.size(); i++) {
+      if (workerStates[i] != nullptr) {
+        lua_sethook(workerStates[i], stopHook, LUA_MASKCOUNT, STOP_CHECK_INSTRUCTIONS);
+      }
+    }
+  }
+  workReady.notify_all();
+
+  for (size_t i = 0; i < workers.size(); i++) {
+    workers[i].join();
+  }
+
+  for (size_t i = 0; i < queued.size(); i++) {
+    delete queued[i];
+  }
+  for (size_t i = 0; i < finished.size(); i++) {
+    delete finished[i];
+  }
+}
+
+void LuaJobSystem::registerApi() {
+  // stack: [.., engine]
+  luaL_newmetatable(L, FUTURE_TYPE);
+  // stack: [.., engine, metatable]
+
+  luaL_Reg methods[] = {
+    { "isDone", futureIsDone },
+    { "get", futureGet },
+    { "wait", futureWait },
+    { "onDone", futureOnDone },
+    { nullptr, nullptr }
+  };
+  lua_newtable(L);
+  lua_pushlightuserdata(L, this);
+  luaL_setfuncs(L, methods, 1);
+  lua_setfield(L, -2, "__index");
+
+  lua_pushlightuserdata(L, this);
+  lua_pushcclosure(L, futureGc, 1);
+  lua_setfield(L, -2, "__gc");
+
+  lua_pop(L, 1);
+  // stack: [.., engine]
+
+  lua_pushlightuserdata(L, this);
+  lua_pushcclosure(L, apiJob, 1);
+  lua_setfield(L, -2, "job");
+}
+
+void LuaJobSystem::setCacheDirectory(std::string const& directory) {
+  cacheDirectory = directory;
+}
+
+void LuaJobSystem::update() {
+  // the lists trade places, so both keep their capacity from frame to frame
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    done.swap(finished);
+  }
+  if (done.empty() && doneCallbacks.empty()) {
+    return;
+  }
+
+  // the callbacks may call onDone and add to doneCallbacks, so the ids to run are taken out first
+  unsigned* callbacks = FrameArena::current().allocateArray<unsigned>(doneCallbacks.size() + done.size());
+  size_t callbackCount = 0;
+
+  // onDone on a job that was already done
+  for (size_t i = 0; i < doneCallbacks.size(); i++) {
+    callbacks[callbackCount++] = doneCallbacks[i];
+  }
+  doneCallbacks.clear();
+
+  for (size_t i = 0; i < done.size(); i++) {
+    Work* work = done[i];
+    std::unordered_map<unsigned, Job>::iterator it = jobs.find(work->id);
+    if (it != jobs.end()) {
+      it->second.status = work->failed ? FAILED : DONE;
+      it->second.result.swap(work->result);
+      callbacks[callbackCount++] = work->id;
+    }
+    delete work;
+  }
+  done.clear();
+
+  for (size_t i = 0; i < callbackCount; i++) {
+    runCallback(callbacks[i]);
+  }
+}
+
+void LuaJobSystem::runCallback(unsigned id) {
+  std::unordered_map<unsigned, Job>::iterator it = jobs.find(id);
+  if (it == jobs.end()) {
+    return;
+  }
+
+  if (it->second.callback != LUA_NOREF) {
+    // the callback may start jobs and collect futures, which changes the table - it works on a copy
+    Job job = it->second;
+    it->second.callback = LUA_NOREF;
+
+    lua_pushcfunction(L, callCallback);
+    lua_pushlightuserdata(L, &job);
+    // stack: [.., callCallback, job]
+
+    int status = LUA_OK;
+    {
+      ScriptingEngine::HookCall call(engine);
+      status = lua_pcall(L, 1, 0, 0);
+      if (call.finish() && profiler) {
+        // the budget hook took the profiler's place
+        profiler->restoreHook(L);
+      }
+    }
+    luaL_unref(L, LUA_REGISTRYINDEX, job.callback);
+
+    if (status != LUA_OK) {
+      const char* message = lua_tostring(L, -1);
+      std::cerr << "Lua job callback error: " << (message ? message : "(error object is not a string)") << std::endl;
+      lua_pop(L, 1);
+    }
+
+    it = jobs.find(id);
+    if (it == jobs.end()) {
+      return;
+    }
+  }
+
+  if (it->second.abandoned) {
+    jobs.erase(it);
+  }
+}
+
+int LuaJobSystem::callCallback(lua_State* L) {
+  Job* job = static_cast<Job*>(lua_touserdata(L, 1));
+
+  lua_rawgeti(L, LUA_REGISTRYINDEX, job->callback);
+  lua_pushboolean(L, job->status == DONE);
+  // stack: [job, callback, ok]
+  int count = 1;
+  if (job->status == DONE) {
+    count += LuaSerializer::read(L, job->result);
+  } else {
+    lua_pushlstring(L, job->result.data(), job->result.size());
+    count++;
+  }
+  // stack: [job, callback, ok, results or error..]
+
+  lua_call(L, count, 0);
+  return 0;
+}
+
+LuaJobSystem* LuaJobSystem::getSystem(lua_State* L) {
+  return static_cast<LuaJobSystem*>(lua_touserdata(L, lua_upvalueindex(1)));
+}
+
+int LuaJobSystem::apiJob(lua_State* L) {
+  LuaJobSystem* system = getSystem(L);
+
+  // engine:job passes the engine table first
+  int first = lua_istable(L, 1) ? 2 : 1;
+  const char* module = luaL_checkstring(L, first);
+  const char* function = luaL_checkstring(L, first + 1);
+  int nargs = lua_gettop(L) - first - 1;
+
+  std::vector<char> arguments;
+  LuaSerializer::write(L, first + 2, nargs, arguments);
+
+  if (system->workers.empty()) {
+    system->startWorkers(L);
+  }
+
+  unsigned id = system->nextId++;
+  Job job = { PENDING, std::vector<char>(), LUA_NOREF, false };
+  system->jobs[id] = job;
+
+  Future* future = static_cast<Future*>(lua_newuserdata(L, sizeof(Future)));
+  future->id = id;
+  luaL_setmetatable(L, FUTURE_TYPE);
+  // stack: [.., future]
+
+  Work* work = new Work();
+  work->id = id;
+  work->module = module;
+  work->function = function;
+  work->arguments.swap(arguments);
+  work->failed = false;
+  {
+    std::lock_guard<std::mutex> lock(system->mutex);
+    system->queued.push_back(work);
+  }
+  system->workReady.notify_one();
+
+  return 1;
+}
+
+LuaJobSystem::Job& LuaJobSystem::checkFuture(lua_State* L, int index) {
+  LuaJobSystem* system = getSystem(L);
+  Future* future = static_cast<Future*>(luaL_checkudata(L, index, FUTURE_TYPE));
+  // a future always has its job until it is collected
+  return system->jobs[future->id];
+}
+
+int LuaJobSystem::pushResults(lua_State* L, Job& job) {
+  if (job.status == FAILED) {
+    lua_pushlstring(L, job.result.data(), job.result.size());
+    return lua_error(L);
+  }
+  return LuaSerializer::read(L, job.result);
+}
+
+int LuaJobSystem::futureIsDone(lua_State* L) {
+  lua_pushboolean(L, checkFuture(L, 1).status != PENDING);
+  return 1;
+}
+
+int LuaJobSystem::futureGet(lua_State* L) {
+  Job& job = checkFuture(L, 1);
+  if (job.status == PENDING) {
+    return luaL_error(L, "the job is still running - check future:isDone first or use future:wait or future:onDone");
+  }
+  return pushResults(L, job);
+}
+
+int LuaJobSystem::futureWait(lua_State* L) {
+  Job& job = checkFuture(L, 1);
+  if (job.status != PENDING) {
+    return pushResults(L, job);
+  }
+
+  if (!lua_isyieldable(L)) {
+    return luaL_error(L, "future:wait can only be called by a task started with engine:spawn");
+  }
+  // the scheduler resumes a task that yielded on its own on the next frame
+  return lua_yieldk(L, 0, 0, futureWaitContinue);
+}
+
+int LuaJobSystem::futureWaitContinue(lua_State* L, int status, lua_KContext context) {
+  return futureWait(L);
+}
+
+int LuaJobSystem::futureOnDone(lua_State* L) {
+  LuaJobSystem* system = getSystem(L);
+  Job& job = checkFuture(L, 1);
+  luaL_checktype(L, 2, LUA_TFUNCTION);
+
+  bool waiting = job.callback != LUA_NOREF;
+  if (waiting) {
+    luaL_unref(L, LUA_REGISTRYINDEX, job.callback);
+  }
+  lua_pushvalue(L, 2);
+  job.callback = luaL_ref(L, LUA_REGISTRYINDEX);
+
+  // the callbacks run in update, even for a job that is already done
+  if (job.status != PENDING && !waiting) {
+    Future* future = static_cast<Future*>(lua_touserdata(L, 1));
+    system->doneCallbacks.push_back(future->id);
+  }
+
+  lua_settop(L, 1);
+  return 1;
+}
+
+int LuaJobSystem::futureGc(lua_State* L) {
+  LuaJobSystem* system = getSystem(L);
+  Future* future = static_cast<Future*>(lua_touserdata(L, 1));
+
+  std::unordered_map<unsigned, Job>::iterator it = system->jobs.find(future->id);
+  if (it == system->jobs.end()) {
+    return 0;
+  }
+
+  // a job still owes its callback a call - update drops it afterwards
+  if (it->second.status == PENDING || it->second.callback != LUA_NOREF) {
+    it->second.abandoned = true;
+  } else {
+    system->jobs.erase(it);
+  }
+  return 0;
+}
+
+void LuaJobSystem::startWorkers(lua_State* L) {
+  lua_getglobal(L, "package");
+  lua_getfield(L, -1, "path");
+  packagePath = lua_isstring(L, -1) ? lua_tostring(L, -1) : "";
+  lua_getfield(L, -2, "cpath");
+  packageCPath = lua_isstring(L, -1) ? lua_tostring(L, -1) : "";
+  lua_pop(L, 3);
+
+  int count = SharedContext::instance->config->jobWorkers;
+  if (count <= 0) {
+    count = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+  }
+  if (count < 1) {
+    count = 1;
+  }
+
+  workerStates.resize(count, nullptr);
+  for (int i = 0; i < count; i++) {
+    workers.push_back(std::thread(&LuaJobSystem::runWorker, this, i));
+  }
+}
+
+void LuaJobSystem::runWorker(int index) {
+  LuaBytecodeCache cache;
+  cache.setDirectory(cacheDirectory);
+
+  lua_State* W = LuaAllocator::newState();
+  luaL_openlibs(W);
+
+  lua_getglobal(W, "package");
+  lua_pushstring(W, packagePath.c_str());
+  lua_setfield(W, -2, "path");
+  lua_pushstring(W, packageCPath.c_str());
+  lua_setfield(W, -2, "cpath");
+  lua_getfield(W, -1, "searchers");
+  // stack: [package, searchers]
+  lua_pushlightuserdata(W, &cache);
+  lua_pushcclosure(W, searchWorkerModule, 1);
+  lua_rawseti(W, -2, 2);
+  lua_pop(W, 2);
+  // stack: []
+
+  std::unique_lock<std::mutex> lock(mutex);
+  workerStates[index] = W;
+
+  while (true) {
+    while (!stopping && queued.empty()) {
+      workReady.wait(lock);
+    }
+    if (stopping) {
+      break;
+    }
+
+    Work* work = queued.front();
+    queued.pop_front();
+    lock.unlock();
+
+    {
+      TRACE_ZONE("lua.job");
+
+      lua_pushcfunction(W, traceback);
+      lua_pushcfunction(W, runWork);
+      lua_pushlightuserdata(W, work);
+      // stack: [traceback, runWork, work]
+      if (lua_pcall(W, 1, 0, 1) != LUA_OK) {
+        size_t length = 0;
+        const char* message = lua_tolstring(W, -1, &length);
+        work->failed = true;
+        work->result.assign(message, message + length);
+      }
+      lua_settop(W, 0);
+    }
+
+    lock.lock();
+    finished.push_back(work);
+  }
+
+  workerStates[index] = nullptr;
+  lock.unlock();
+  LuaAllocator::closeState(W);
+}
+
+int LuaJobSystem::runWork(lua_State* L) {
+  Work* work = static_cast<Work*>(lua_touserdata(L, 1));
+
+  lua_getglobal(L, "require");
+  lua_pushstring(L, work->module.c_str());
+  lua_call(L, 1, 1);
+  // stack: [work, module]
+
+  if (!lua_istable(L, -1)) {
+    return luaL_error(L, "module '%s' did not return a table", work->module.c_str());
+  }
+  lua_getfield(L, -1, work->function.c_str());
+  if (!lua_isfunction(L, -1)) {
+    return luaL_error(L, "module '%s' has no function '%s'", work->module.c_str(), work->function.c_str());
+  }
+  // stack: [work, module, function]
+
+  int nargs = LuaSerializer::read(L, work->arguments);
+  lua_call(L, nargs, LUA_MULTRET);
+  // stack: [work, module, results..]
+
+  work->result.clear();
+  LuaSerializer::write(L, 3, lua_gettop(L) - 2, work->result);
+  return 0;
+}
@@ -0,0 +1,125 @@
+#ifndef LUAJOBSYSTEM_H
+#define LUAJOBSYSTEM_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "lua/lua.hpp"
+
+class LuaProfiler;
+class ScriptingEngine;
+
+// runs lua functions on worker threads, each with a lua state of its own, so scripts can move
+// pathfinding, ai evaluation or procedural generation off the frame thread:
+//
+//   local future = engine:job(module, fn, ...)   calls require(module)[fn](...) on a worker
+//   future:isDone()     true once the job finished or failed
+//   future:get()        the job's results - raises the job's error, or an error while it runs
+//   future:wait()       in a task (see LuaScheduler.hpp): waits frame by frame, then returns the results
+//   future:onDone(fn)   calls fn(true, results...) or fn(false, error) on the frame thread once the
+//                       job is done, even when the future itself is no longer referenced
+//
+// arguments and results are copied through flat buffers (see LuaSerializer.hpp) - the states share
+// no lua objects. workers load modules with require from the main state's package.path, through a
+// bytecode cache of their own in the main script's cache directory. they have no engine table: the
+// native api works on the frame thread's world. hot reload does not reach modules a worker loaded
+//
+// the workers start with the first job: JOB_WORKERS of them, or one less than the cores when it is 0.
+// a job still running at shutdown is stopped with a lua error
+class LuaJobSystem {
+  public:
+    // the engine and profiler time the callbacks like hooks
+    LuaJobSystem(lua_State* L, ScriptingEngine* engine, LuaProfiler* profiler);
+    // stops the workers. it runs after the lua state was closed, which collects the futures
+    ~LuaJobSystem();
+
+    // adds job to the table on the top of the stack
+    void registerApi();
+
+    // where the workers cache compiled modules - read when they start
+    void setCacheDirectory(std::string const& directory);
+
+    // hands the finished jobs to their futures and runs their callbacks
+    void update();
+
+  private:
+    enum Status { PENDING, DONE, FAILED };
+
+    // a job as the frame thread sees it
+    struct Job {
+      Status status;
+      // the serialized results, or the error message
+      std::vector<char> result;
+      // registry reference of the onDone function
+      int callback;
+      // the future was collected - the job is dropped once it is done and its callback ran
+      bool abandoned;
+    };
+
+    // a job as a worker sees it
+    struct Work {
+      unsigned id;
+      std::string module;
+      std::string function;
+      std::vector<char> arguments;
+      bool failed;
+      std::vector<char> result;
+    };
+
+    // the system is the upvalue of every api function
+    static LuaJobSystem* getSystem(lua_State* L);
+    static int apiJob(lua_State* L);
+    static int futureIsDone(lua_State* L);
+    static int futureGet(lua_State* L);
+    static int futureWait(lua_State* L);
+    static int futureWaitContinue(lua_State* L, int status, lua_KContext context);
+    static int futureOnDone(lua_State* L);
+    static int futureGc(lua_State* L);
+
+    // the job of the future at the stack index - raises a lua error for anything else
+    static Job& checkFuture(lua_State* L, int index);
+    // pushes the results of a finished job or raises its error
+    static int pushResults(lua_State* L, Job& job);
+
+    void runCallback(unsigned id);
+    // protected call of a callback - the Job is a light userdata
+    static int callCallback(lua_State* L);
+
+    void startWorkers(lua_State* L);
+    void runWorker(int index);
+    // protected call of a job on a worker state - the Work is a light userdata
+    static int runWork(lua_State* L);
+
+    lua_State* L;
+    ScriptingEngine* engine;
+    LuaProfiler* profiler;
+
+    // frame thread only
+    std::unordered_map<unsigned, Job> jobs;
+    unsigned nextId;
+    std::vector<unsigned> doneCallbacks;
+    // the jobs update took from finished
+    std::vector<Work*> done;
+
+    // shared with the workers
+    std::mutex mutex;
+    std::condition_variable workReady;
+    std::deque<Work*> queued;
+    std::vector<Work*> finished;
+    bool stopping;
+    std::vector<std::thread> workers;
+    // the lua state of each worker while it runs
+    std::vector<lua_State*> workerStates;
+
+    // copied from the main state when the workers start
+    std::string packagePath;
+    std::string packageCPath;
+    std::string cacheDirectory;
+};
+
+#endif // !LUAJOBSYSTEM_H
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include "LuaProfiler.hpp"
+#include "SamplingTimer.hpp"
+
+namespace {
+  // the hooks have no user data - only one profiler runs at a time
+  LuaProfiler* activeProfiler = nullptr;
+}
+
+LuaProfiler::LuaProfiler(lua_State* L)
+  : L(L),
+    running(L) {
+}
+
+LuaProfiler::~LuaProfiler() {
+  stop();
+}
+
+bool LuaProfiler::startSampling(int intervalMicroseconds) {
+  globalNames.clear();
+
+  activeProfiler = this;
+  if (!samplingTimer::start(intervalMicroseconds, tick, this)) {
+    activeProfiler = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void LuaProfiler::stopSampling() {
+  samplingTimer::stop();
+  cancelSample();
+  activeProfiler = nullptr;
+}
+
+bool LuaProfiler::startTracing() {
+  if (activeProfiler != nullptr) {
+    return false;
+  }
+
+  globalNames.clear();
+  activeProfiler = this;
+  lua_sethook(L, traceHook, LUA_MASKCALL | LUA_MASKRET, 0);
+  return true;
+}
+
+void LuaProfiler::stopTracing() {
+  lua_sethook(L, nullptr, 0, 0);
+  activeProfiler = nullptr;
+}
+
+// signal context
+void LuaProfiler::requestSample() {
+  lua_sethook(running.load(), sampleHook, LUA_MASKCOUNT, 1);
+}
+
+void LuaProfiler::cancelSample() {
+  lua_sethook(L, nullptr, 0, 0);
+  lua_State* thread = running.load();
+  if (thread != L) {
+    lua_sethook(thread, nullptr, 0, 0);
+  }
+}
+
+void LuaProfiler::restoreHook(lua_State* thread) {
+  if (thread == L && isRunning() && getMode() == TRACING) {
+    lua_sethook(L, traceHook, LUA_MASKCALL | LUA_MASKRET, 0);
+  } else {
+    lua_sethook(thread, nullptr, 0, 0);
+  }
+}
+
+// signal context
+void LuaProfiler::tick(void* data) {
+  static_cast<LuaProfiler*>(data)->ScriptProfiler::tick();
+}
+
+void LuaProfiler::sampleHook(lua_State* L, lua_Debug* ar) {
+  lua_sethook(L, nullptr, 0, 0);
+
+  if (activeProfiler != nullptr) {
+    activeProfiler->sample(L);
+  }
+}
+
+void LuaProfiler::traceHook(lua_State* L, lua_Debug* ar) {
+  // coroutines inherit the hook, but their yields would unbalance the calls and returns
+  if (activeProfiler == nullptr || L != activeProfiler->L) {
+    return;
+  }
+
+  lua_getinfo(L, "Snf", ar);
+  // stack: [.., function]
+
+  if (ar->what[0] == 'C') {
+    lua_pop(L, 1);
+    // stack: [..]
+    return;
+  }
+
+  if (ar->event == LUA_HOOKRET) {
+    lua_pop(L, 1);
+    // stack: [..]
+    activeProfiler->profile.endCall();
+    return;
+  }
+
+  // a tail call replaces the frame that made it
+  if (ar->event == LUA_HOOKTAILCALL) {
+    activeProfiler->profile.endCall();
+  }
+
+  std::string frame = activeProfiler->describeFrame(L, *ar);
+  lua_pop(L, 1);
+  // stack: [..]
+  activeProfiler->profile.beginCall(frame);
+}
+
+void LuaProfiler::sample(lua_State* thread) {
+  unsigned ticks = takeTicks();
+  if (ticks == 0) {
+    return;
+  }
+
+  std::vector<std::string> stack;
+  lua_Debug ar;
+  for (int level = 0; lua_getstack(thread, level, &ar); level++) {
+    lua_getinfo(thread, "Snf", &ar);
+    // stack: [.., function]
+    stack.push_back(describeFrame(thread, ar));
+    lua_pop(thread, 1);
+    // stack: [..]
+  }
+  std::reverse(stack.begin(), stack.end());
+
+  profile.addSample(stack, ticks);
+}
+
+// ar holds "Sn" and the function is on the top of the stack
+std::string LuaProfiler::describeFrame(lua_State* thread, lua_Debug& ar) {
+  std::stringstream frame;
+  std::string what = ar.what;
+
+  const char* name = ar.name;
+  if (name == nullptr) {
+    std::string const& global = globalName(thread, lua_topointer(thread, -1));
+    name = global.empty() ? "?" : global.c_str();
+  }
+
+  if (what == "C") {
+    frame << "[C] " << name;
+  } else if (what == "main") {
+    frame << "main chunk (" << ar.short_src << ")";
+  } else {
+    frame << name << " (" << ar.short_src << ":" << ar.linedefined << ")";
+  }
+
+  return frame.str();
+}
+
+std::string const& LuaProfiler::globalName(lua_State* thread, const void* function) {
+  std::map<const void*, std::string>::iterator found = globalNames.find(function);
+  if (found != globalNames.end()) {
+    return found->second;
+  }
+
+  std::string& name = globalNames[function];
+
+  lua_pushglobaltable(thread);
+  lua_pushnil(thread);
+  // stack: [.., _G, nil]
+  while (lua_next(thread, -2) != 0) {
+    // stack: [.., _G, key, value]
+    if (lua_type(thread, -2) == LUA_TSTRING && lua_topointer(thread, -1) == function) {
+      name = lua_tostring(thread, -2);
+      lua_pop(thread, 2);
+      break;
+    }
+    lua_pop(thread, 1);
+  }
+  // stack: [.., _G]
+  lua_pop(thread, 1);
+
+  return name;
+}
@@ -0,0 +1,58 @@
+#ifndef LUAPROFILER_H
+#define LUAPROFILER_H
+
+#include <atomic>
+#include <map>
+#include <string>
+
+#include "ScriptProfiler.hpp"
+#include "lua/lua.hpp"
+
+// profiler for a lua state - see ScriptProfiler.hpp
+//
+// sampling: every SIGPROF tick (see SamplingTimer.hpp) the signal handler only arms a count hook with
+// lua_sethook, which is safe to call from a signal. the hook runs on the next lua instruction, walks
+// the call stack there and disarms itself. a tick inside a native function is recorded at the next
+// lua instruction, in the script function that called it. the hook is armed on the running thread -
+// the main one unless the engine resumes a task (see LuaScheduler.hpp) - so time spent inside
+// coroutines the script resumes itself shows up at the coroutine.resume that runs them.
+//
+// tracing: call and return hooks on the main thread only
+class LuaProfiler : public ScriptProfiler {
+  public:
+    explicit LuaProfiler(lua_State* L);
+    virtual ~LuaProfiler();
+
+    // the engine tells the profiler which thread it is about to resume - returns the previous one
+    lua_State* setRunningThread(lua_State* thread) { return running.exchange(thread); }
+    lua_State* getRunningThread() const { return running.load(); }
+
+    // puts the profiler's hook back on a thread after the engine used the hook for something else -
+    // a pending sample on it is dropped
+    void restoreHook(lua_State* thread);
+
+  protected:
+    virtual bool startSampling(int intervalMicroseconds);
+    virtual void stopSampling();
+    virtual bool startTracing();
+    virtual void stopTracing();
+    virtual void requestSample();
+    virtual void cancelSample();
+
+  private:
+    static void tick(void* data);
+    static void sampleHook(lua_State* L, lua_Debug* ar);
+    static void traceHook(lua_State* L, lua_Debug* ar);
+
+    // thread: the state the hook ran on - coroutines inherit an armed hook
+    void sample(lua_State* thread);
+    std::string describeFrame(lua_State* thread, lua_Debug& ar);
+    // name of a function that was called without one (the engine's hooks) - "" when it is not a global
+    std::string const& globalName(lua_State* thread, const void* function);
+
+    lua_State* L;
+    std::atomic<lua_State*> running;
+    std::map<const void*, std::string> globalNames;
+};
+
+#endif // !LUAPROFILER_H
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "LuaScheduler.hpp"
+#include "LuaProfiler.hpp"
+#include "ScriptingEngine.hpp"
+
+// longer waits (math.huge included) are cut to this - about 30000 years, and far from overflowing a tick
+static const lua_Number MAX_WAIT_MILLISECONDS = 1e15;
+
+LuaScheduler::LuaScheduler(lua_State* L, ScriptingEngine* engine, LuaProfiler* profiler)
+  : L(L),
+    engine(engine),
+    profiler(profiler),
+    nextId(1),
+    runningTask(0),
+    sleeping(false),
+    time(0),
+    frame(0) {
+}
+
+// the tasks' registry references go with the lua state
+LuaScheduler::~LuaScheduler() {
+}
+
+void LuaScheduler::registerApi() {
+  lua_pushlightuserdata(L, this);
+  lua_pushcclosure(L, apiSpawn, 1);
+  lua_setfield(L, -2, "spawn");
+
+  lua_pushlightuserdata(L, this);
+  lua_pushcclosure(L, apiWait, 1);
+  lua_setfield(L, -2, "wait");
+
+  lua_pushlightuserdata(L, this);
+  lua_pushcclosure(L, apiWaitFrames, 1);
+  lua_setfield(L, -2, "waitFrames");
+}
+
+void LuaScheduler::update(float deltaTime) {
+  frame++;
+  time += deltaTime;
+
+  due.clear();
+  frameWheel.advance(frame, due);
+  timeWheel.advance(static_cast<TimerWheel::Tick>(time * 1000.0), due);
+
+  for (size_t i = 0; i < due.size(); i++) {
+    resume(due[i], L, 0);
+  }
+}
+
+void LuaScheduler::resume(unsigned id, lua_State* from, int nargs) {
+  Task task = tasks[id];
+
+  // a task may spawn another one, which runs inside its resume
+  unsigned outerTask = runningTask;
+  bool outerSleeping = sleeping;
+  runningTask = id;
+  sleeping = false;
+
+  lua_State* outerThread = profiler ? profiler->setRunningThread(task.thread) : nullptr;
+  int status = LUA_OK;
+  {
+    ScriptingEngine::HookCall call(engine);
+    status = lua_resume(task.thread, from, nargs);
+    // a task that yielded just before the budget hook ran keeps it armed
+    if (call.finish() && profiler) {
+      profiler->restoreHook(task.thread);
+    }
+  }
+  if (profiler) {
+    profiler->setRunningThread(outerThread);
+  }
+
+  bool slept = sleeping;
+  runningTask = outerTask;
+  sleeping = outerSleeping;
+
+  if (status == LUA_YIELD) {
+    lua_settop(task.thread, 0);
+    if (!slept) {
+      frameWheel.schedule(id, frame + 1);
+    }
+    return;
+  }
+
+  if (status != LUA_OK) {
+    luaL_traceback(L, task.thread, lua_tostring(task.thread, -1), 0);
+    std::cerr << "Lua task error: " << lua_tostring(L, -1) << std::endl;
+    lua_pop(L, 1);
+  }
+
+  luaL_unref(L, LUA_REGISTRYINDEX, task.reference);
+  tasks.erase(id);
+}
+
+int LuaScheduler::apiSpawn(lua_State* L) {
+  LuaScheduler* scheduler = static_cast<LuaScheduler*>(lua_touserdata(L, lua_upvalueindex(1)));
+
+  // engine:spawn passes the engine table first
+  int function = lua_istable(L, 1) ? 2 : 1;
+  luaL_checktype(L, function, LUA_TFUNCTION);
+  int nargs = lua_gettop(L) - function;
+
+  lua_State* thread = lua_newthread(L);
+  lua_pushvalue(L, -1);
+  int reference = luaL_ref(L, LUA_REGISTRYINDEX);
+  // stack: [.., function, args.., thread]
+
+  for (int i = function; i <= function + nargs; i++) {
+    lua_pushvalue(L, i);
+  }
+  lua_xmove(L, thread, nargs + 1);
+  // stack: [.., function, args.., thread]
+
+  unsigned id = scheduler->nextId++;
+  Task task = { thread, reference };
+  scheduler->tasks[id] = task;
+  scheduler->resume(id, L, nargs);
+
+  return 1;
+}
+
+LuaScheduler* LuaScheduler::checkTask(lua_State* L, const char* function) {
+  LuaScheduler* scheduler = static_cast<LuaScheduler*>(lua_touserdata(L, lua_upvalueindex(1)));
+
+  std::unordered_map<unsigned, Task>::iterator it = scheduler->tasks.find(scheduler->runningTask);
+  if (it == scheduler->tasks.end() || it->second.thread != L) {
+    luaL_error(L, "engine:%s can only be called by a task started with engine:spawn", function);
+  }
+  return scheduler;
+}
+
+int LuaScheduler::apiWait(lua_State* L) {
+  LuaScheduler* scheduler = checkTask(L, "wait");
+
+  // arguments are read from the top so engine:wait and engine.wait both work
+  lua_Number seconds = luaL_checknumber(L, -1);
+  if (std::isnan(seconds)) {
+    return luaL_error(L, "engine:wait expects a number of seconds, got nan");
+  }
+  lua_Number wait = std::min(std::ceil(seconds * 1000.0), MAX_WAIT_MILLISECONDS);
+  TimerWheel::Tick milliseconds = wait > 0 ? static_cast<TimerWheel::Tick>(wait) : 0;
+
+  scheduler->timeWheel.schedule(scheduler->runningTask, scheduler->timeWheel.getTick() + milliseconds);
+  scheduler->sleeping = true;
+  return lua_yield(L, 0);
+}
+
+int LuaScheduler::apiWaitFrames(lua_State* L) {
+  LuaScheduler* scheduler = checkTask(L, "waitFrames");
+
+  lua_Integer frames = luaL_checkinteger(L, -1);
+
+  scheduler->frameWheel.schedule(scheduler->runningTask, scheduler->frame + (frames > 1 ? frames : 1));
+  scheduler->sleeping = true;
+  return lua_yield(L, 0);
+}
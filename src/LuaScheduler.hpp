@@ -0,0 +1,73 @@
+#ifndef LUASCHEDULER_H
+#define LUASCHEDULER_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "TimerWheel.hpp"
+#include "lua/lua.hpp"
+
+class LuaProfiler;
+class ScriptingEngine;
+
+// runs lua coroutines as tasks for time based behaviours:
+//
+//   engine:spawn(fn, ...)   starts fn(...) as a task right away and returns its coroutine
+//   engine:wait(seconds)    sleeps the task for an amount of game time (the sum of the update deltas)
+//   engine:waitFrames(n)    sleeps the task for n frames
+//
+// a plain coroutine.yield() in a task waits one frame. sleeping tasks are kept in timer wheels (see
+// TimerWheel.hpp), one in milliseconds and one in frames, so each frame only resumes the tasks that
+// are due - the cost of a frame does not depend on how many tasks are waiting. a task that raises an
+// error is reported and dropped. each resume is a hook call of its own for the HOOK_BUDGET_MS budget
+class LuaScheduler {
+  public:
+    // the engine times the resumes, the profiler follows the tasks as they run - it may be null
+    LuaScheduler(lua_State* L, ScriptingEngine* engine, LuaProfiler* profiler);
+    // may run after the lua state was closed
+    ~LuaScheduler();
+
+    // adds spawn, wait and waitFrames to the table on the top of the stack
+    void registerApi();
+
+    // moves the clocks on by a frame and resumes the tasks that are due
+    void update(float deltaTime);
+
+    size_t getTaskCount() const { return tasks.size(); }
+
+  private:
+    struct Task {
+      lua_State* thread;
+      // keeps the coroutine alive in the registry
+      int reference;
+    };
+
+    static int apiSpawn(lua_State* L);
+    static int apiWait(lua_State* L);
+    static int apiWaitFrames(lua_State* L);
+
+    // the scheduler in the upvalue of the api functions - raises a lua error unless the caller is
+    // the task being resumed
+    static LuaScheduler* checkTask(lua_State* L, const char* function);
+
+    // resumes a task with nargs arguments on its stack, drops it when it finished or failed
+    void resume(unsigned id, lua_State* from, int nargs);
+
+    lua_State* L;
+    ScriptingEngine* engine;
+    LuaProfiler* profiler;
+
+    std::unordered_map<unsigned, Task> tasks;
+    unsigned nextId;
+    // the task being resumed and whether it went to sleep through wait or waitFrames
+    unsigned runningTask;
+    bool sleeping;
+
+    double time;
+    TimerWheel::Tick frame;
+    TimerWheel timeWheel;
+    TimerWheel frameWheel;
+    std::vector<unsigned> due;
+};
+
+#endif // !LUASCHEDULER_H
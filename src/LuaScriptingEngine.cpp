@@ -7,20 +7,64 @@
 #include <algorithm>
 
 #include "LuaScriptingEngine.hpp"
+#include "LuaAllocator.hpp"
+#include "LuaBinding.hpp"
+#include "LuaBuffer.hpp"
+#include "LuaHotReloader.hpp"
+#include "LuaJobSystem.hpp"
+#include "LuaProfiler.hpp"
+#include "LuaScheduler.hpp"
+#include "EngineApi.hpp"
 #include "Backend.hpp"
+#include "FrameArena.hpp"
 #include "ScriptingEngine.hpp"
 #include "SharedContext.hpp"
+#include "Trace.hpp"
 
 
 void parseConfigurationTable(lua_State* L, Configuration& config);
 
+// IDLE_GC: an idle cycle starts once the heap grew by half since the last cycle finished, and the
+// frames collect again once it doubled - lua's own default pause. small heaps get some headroom
+static const int IDLE_GC_STEP_KB = 64;
+static const int IDLE_GC_MIN_LIMIT_KB = 4096;
+
 // Engine C API
 namespace engine {
   // Lua side of the API
   int apiInit(lua_State* L);
-  int apiGetScreenWidth(lua_State* L);
-  int apiGetScreenHeight(lua_State* L);
-  int apiDrawCircle(lua_State* L);
+  int apiMemStats(lua_State* L);
+}
+
+// replaces the package.searchers entry that finds lua files so require goes through the bytecode cache
+// and the engine learns which files are loaded. upvalue: the engine
+int searchLuaModule(lua_State* L) {
+  std::string moduleName = luaL_checkstring(L, 1);
+  LuaScriptingEngine* engine = static_cast<LuaScriptingEngine*>(lua_touserdata(L, lua_upvalueindex(1)));
+
+  lua_getglobal(L, "package");
+  lua_getfield(L, -1, "searchpath");
+  lua_pushstring(L, moduleName.c_str());
+  lua_getfield(L, -3, "path");
+  // stack: [.., package, searchpath, name, path]
+  lua_call(L, 2, 2);
+  // stack: [.., package, filename or nil, message?]
+
+  if (lua_isnil(L, -2)) {
+    // the list of files that were tried
+    return 1;
+  }
+
+  std::string filename = lua_tostring(L, -2);
+  if (engine->bytecodeCache.load(L, filename) != LUA_OK) {
+    return luaL_error(L, "error loading module '%s' from file '%s':\n\t%s", moduleName.c_str(), filename.c_str(), lua_tostring(L, -1));
+  }
+  // stack: [.., package, filename, message, loader]
+
+  engine->addModule(moduleName, filename);
+
+  lua_pushstring(L, filename.c_str());
+  return 2;
 }
 
 struct Variant {
@@ -29,7 +73,7 @@ struct Variant {
   Variant::Type valueType;
 
   union VarValue {
-    const char* stringValue;
+    StringView stringValue;
     double numberValue;
     bool booleanValue;
   };
@@ -54,7 +98,10 @@ void readField(lua_State* L, std::string const& fieldName, Variant& result) {
     switch(lua_type(L, -1)) {
       case LUA_TSTRING: {
         result.valueType = Variant::Type::STRING;
-        result.value.stringValue = std::string(lua_tostring(L, -1)).c_str();
+        // the string goes with the pop - the copy lasts until the end of the frame
+        size_t length = 0;
+        const char* value = lua_tolstring(L, -1, &length);
+        result.value.stringValue = FrameArena::current().copyString(value, length);
         // std::cerr << "readField(" << fieldName << ") is string: " << result.value.stringValue << std::endl;
         lua_pop(L, 1);
         // stack: [.., table]
@@ -86,53 +133,266 @@ void readField(lua_State* L, std::string const& fieldName, Variant& result) {
 }
 
 LuaScriptingEngine::LuaScriptingEngine()
-  : L(nullptr) {
-  L = luaL_newstate();
+  : L(nullptr),
+    reloader(nullptr),
+    isReloading(false),
+    scheduler(nullptr),
+    jobs(nullptr),
+    idleGc(false),
+    idleGcCycle(false),
+    liveHeapKb(0) {
+  L = LuaAllocator::newState();
+  // the hooks find the engine in the extra space - threads copy it from the main one
+  *static_cast<LuaScriptingEngine**>(lua_getextraspace(L)) = this;
+  LuaProfiler* luaProfiler = new LuaProfiler(L);
+  profiler = luaProfiler;
+  scheduler = new LuaScheduler(L, this, luaProfiler);
+  jobs = new LuaJobSystem(L, this, luaProfiler);
 
   // provide standard libraries to script
   luaL_openlibs(L);
 
+  lua_getglobal(L, "package");
+  lua_getfield(L, -1, "searchers");
+  // stack: [.., package, searchers]
+  lua_pushlightuserdata(L, this);
+  lua_pushcclosure(L, searchLuaModule, 1);
+  lua_rawseti(L, -2, 2);
+  lua_pop(L, 2);
+  // stack: [..]
+
+  LuaBuffer::registerType(L);
+
   // tell lua about our engine capabilities
+  #define LUA_API_FUNCTION(name, description) { #name, LUA_BINDING(engine::native::name) },
   luaL_Reg api[] = {
     { "init", engine::apiInit },
-    { "getScreenWidth", engine::apiGetScreenWidth },
-    { "getScreenHeight", engine::apiGetScreenHeight },
-    { "drawCircle", engine::apiDrawCircle },
+    { "createBuffer", LuaBuffer::apiCreateBuffer },
+    { "memStats", engine::apiMemStats },
+    ENGINE_NATIVE_API(LUA_API_FUNCTION)
     { nullptr, nullptr }
   };
+  #undef LUA_API_FUNCTION
 
   luaL_newlib(L, api);
+  scheduler->registerApi();
+  jobs->registerApi();
   lua_setglobal(L, "engine");
 }
 
 LuaScriptingEngine::~LuaScriptingEngine() {
+  // the watchdog thread arms hooks on the lua state
+  watchdog.stop();
+
+  // a profile still running is written out
+  setProfiling(false);
+  delete profiler;
+  profiler = nullptr;
+
+  if (reloader != nullptr) {
+    delete reloader;
+    reloader = nullptr;
+  }
+
+  delete scheduler;
+  scheduler = nullptr;
+
   if (L != nullptr) {
-    lua_close(L);
+    LuaAllocator::closeState(L);
     L = nullptr;
   }
+
+  // closing the state collects the futures
+  delete jobs;
+  jobs = nullptr;
 }
 
 void LuaScriptingEngine::load(std::string const& filename) {
+  mainFilename = filename;
+
+  // compiled scripts are cached beside the main script
+  size_t slash = filename.rfind('/');
+  bytecodeCache.setDirectory((slash == std::string::npos ? std::string(".") : filename.substr(0, slash)) + "/.luacache");
+  jobs->setCacheDirectory(bytecodeCache.getDirectory());
+
   // load the game script
-  if (luaL_loadfile(L, filename.c_str())) {
-    lua_close(L);
-    L = nullptr;
+  if (bytecodeCache.load(L, filename)) {
     std::stringstream msg;
-    msg << "Unable to load " << filename << std::endl;
+    msg << "Unable to load " << filename << ": " << std::string(lua_tostring(L, -1)) << std::endl;
+    setProfiling(false);
+    LuaAllocator::closeState(L);
+    L = nullptr;
     throw std::runtime_error(msg.str());
   }
 
   // run the game script
-  if (lua_pcall(L, 0, 0, 0)) {
+  int status = LUA_OK;
+  {
+    ScriptProfiler::Scope profiling(profiler);
+    status = lua_pcall(L, 0, 0, 0);
+  }
+
+  if (status != LUA_OK) {
     std::stringstream msg;
     msg << "Error in " << filename << ": " << std::endl << std::string(lua_tostring(L, -1)) << std::endl;
-    lua_close(L);
+    setProfiling(false);
+    LuaAllocator::closeState(L);
     L = nullptr;
     throw std::runtime_error(msg.str());
   }
+
+  // the script has called engine:init by now so the configuration is known
+  if (SharedContext::instance->config->hotReload) {
+    if (bytecodeCache.isStripping()) {
+      std::cerr << "HOT_RELOAD: the bytecode cache strips debug information (LUA_STRIP_BYTECODE), so reloaded scripts lose their local state" << std::endl;
+    }
+    reloader = new LuaHotReloader(L, bytecodeCache);
+    reloader->watch(mainFilename, "");
+    for (std::map<std::string, std::string>::iterator it = modules.begin(); it != modules.end(); ++it) {
+      reloader->watch(it->second, it->first);
+    }
+  }
+}
+
+void LuaScriptingEngine::addModule(std::string const& moduleName, std::string const& filename) {
+  modules[moduleName] = filename;
+
+  if (reloader != nullptr) {
+    reloader->watch(filename, moduleName);
+  }
+}
+
+void LuaScriptingEngine::processReloads() {
+  if (reloader == nullptr) {
+    return;
+  }
+
+  std::vector<LuaHotReloader::Script> changed;
+  reloader->poll(changed);
+
+  for (size_t i = 0; i < changed.size(); i++) {
+    // the reloaded main script calls engine:init again - the running configuration stays
+    isReloading = true;
+    bool reloaded = reloader->reload(changed[i]);
+    isReloading = false;
+
+    if (reloaded) {
+      std::cout << "Reloaded " << changed[i].filename << std::endl;
+    }
+  }
+}
+
+void LuaScriptingEngine::setIdleGc(bool enabled) {
+  idleGc = enabled;
+  if (enabled) {
+    lua_gc(L, LUA_GCSTOP, 0);
+    liveHeapKb = lua_gc(L, LUA_GCCOUNT, 0);
+  } else {
+    lua_gc(L, LUA_GCRESTART, 0);
+  }
+}
+
+void LuaScriptingEngine::collectGarbage(std::chrono::steady_clock::time_point deadline) {
+  if (!idleGc) {
+    return;
+  }
+
+  // a collector restarted by checkHeapLimit finishes its cycle here - the live heap size is out of
+  // date until a cycle of our own measures it again
+  bool collectorRunning = lua_gc(L, LUA_GCISRUNNING, 0) != 0;
+  if (!idleGcCycle && !collectorRunning && lua_gc(L, LUA_GCCOUNT, 0) < liveHeapKb + liveHeapKb / 2) {
+    return;
+  }
+
+  idleGcCycle = true;
+  while (std::chrono::steady_clock::now() < deadline) {
+    // returns 1 when the step finished the cycle
+    if (lua_gc(L, LUA_GCSTEP, IDLE_GC_STEP_KB)) {
+      idleGcCycle = false;
+      liveHeapKb = lua_gc(L, LUA_GCCOUNT, 0);
+      break;
+    }
+  }
+
+  // a cycle the idle time could not finish goes on in the frames at lua's own pace rather than
+  // piling up garbage for a later frame to collect in one go
+  if (idleGcCycle) {
+    if (!collectorRunning) {
+      lua_gc(L, LUA_GCRESTART, 0);
+    }
+  } else {
+    lua_gc(L, LUA_GCSTOP, 0);
+  }
+}
+
+void LuaScriptingEngine::checkHeapLimit() {
+  if (!idleGc || lua_gc(L, LUA_GCISRUNNING, 0)) {
+    return;
+  }
+
+  if (lua_gc(L, LUA_GCCOUNT, 0) > std::max(2 * liveHeapKb, IDLE_GC_MIN_LIMIT_KB)) {
+    lua_gc(L, LUA_GCRESTART, 0);
+  }
+}
+
+bool LuaScriptingEngine::getMemoryStats(MemoryStats& stats) {
+  LuaAllocator* allocator = L != nullptr ? LuaAllocator::getAllocator(L) : nullptr;
+  if (allocator == nullptr) {
+    return false;
+  }
+
+  stats = allocator->getStats();
+  return true;
+}
+
+void LuaScriptingEngine::startWatchdog() {
+  watchdog.start(interruptHook, this);
+}
+
+// the watchdog thread - like the profiler's signal handler it only arms a hook
+void LuaScriptingEngine::interruptHook(void* data) {
+  LuaScriptingEngine* engine = static_cast<LuaScriptingEngine*>(data);
+  lua_sethook(static_cast<LuaProfiler*>(engine->profiler)->getRunningThread(), budgetHook, LUA_MASKCOUNT, 1);
+}
+
+void LuaScriptingEngine::budgetHook(lua_State* L, lua_Debug* ar) {
+  LuaScriptingEngine* engine = *static_cast<LuaScriptingEngine**>(lua_getextraspace(L));
+
+  // armed for a call that returned before the hook ran
+  if (!engine->watchdog.isExpired()) {
+    static_cast<LuaProfiler*>(engine->profiler)->restoreHook(L);
+    return;
+  }
+
+  // level 0 is the function the hook interrupted - luaL_error would point at its caller
+  luaL_where(L, 0);
+  lua_pushfstring(L, "hook exceeded its %d ms budget", engine->watchdog.getBudget());
+  lua_concat(L, 2);
+  lua_error(L);
+}
+
+void LuaScriptingEngine::callHook(int nargs) {
+  checkHeapLimit();
+
+  HookCall call(this);
+  int status = lua_pcall(L, nargs, 0, 0);
+  if (call.finish()) {
+    // the budget hook took the profiler's place
+    static_cast<LuaProfiler*>(profiler)->restoreHook(L);
+  }
+
+  if (status != LUA_OK) {
+    const char* message = lua_tostring(L, -1);
+    std::cerr << "Lua Script Error: " << (message ? message : "(error object is not a string)") << std::endl;
+    lua_pop(L, 1);
+  }
 }
 
 void LuaScriptingEngine::init(Configuration& config) {
+  if (isReloading) {
+    return;
+  }
+
   SharedContext::instance->config->copy(config);
 }
 
@@ -153,13 +413,15 @@ void LuaScriptingEngine::drawCircle(int x, int y, int radius) {
 }
 
 void LuaScriptingEngine::runCreate() {
+  TRACE_ZONE("lua.create");
+
   SharedContext& context = *SharedContext::instance;
 
   lua_getglobal(L, context.config->userCreateFunctionName.c_str());
   // stack: [.., function?]
 
   if (lua_isfunction(L, -1)) {
-    lua_pcall(L, 0, 0, 0);
+    callHook(0);
     // stack: [..]
   } else {
     lua_pop(L, 1);
@@ -168,13 +430,15 @@ void LuaScriptingEngine::runCreate() {
 }
 
 void LuaScriptingEngine::runDestroy() {
+  TRACE_ZONE("lua.destroy");
+
   SharedContext& context = *SharedContext::instance;
 
   lua_getglobal(L, context.config->userDestroyFunctionName.c_str());
   // stack: [.., function?]
 
   if (lua_isfunction(L, -1)) {
-    lua_pcall(L, 0, 0, 0);
+    callHook(0);
     // stack: [..]
   } else {
     lua_pop(L, 1);
@@ -183,6 +447,8 @@ void LuaScriptingEngine::runDestroy() {
 }
 
 void LuaScriptingEngine::runUpdate(float deltaTime) {
+  TRACE_ZONE("lua.update");
+
   SharedContext& context = *SharedContext::instance;
 
   lua_getglobal(L, context.config->userUpdateFunctionName.c_str());
@@ -192,22 +458,32 @@ void LuaScriptingEngine::runUpdate(float deltaTime) {
     lua_pushnumber(L, deltaTime);
     // stack: [.., function, deltaTime]
 
-    lua_pcall(L, 1, 0, 0);
+    callHook(1);
     // stack: [..]
   } else {
     lua_pop(L, 1);
     // stack: [..]
   }
+
+  {
+    TRACE_ZONE("lua.jobs");
+    jobs->update();
+  }
+
+  TRACE_ZONE("lua.tasks");
+  scheduler->update(deltaTime);
 }
 
 void LuaScriptingEngine::runRender() {
+  TRACE_ZONE("lua.render");
+
   SharedContext& context = *SharedContext::instance;
 
   lua_getglobal(L, context.config->userRenderFunctionName.c_str());
   // stack: [.., function?]
 
   if (lua_isfunction(L, -1)) {
-    lua_pcall(L, 0, 0, 0);
+    callHook(0);
     // stack: [..]
   } else {
     lua_pop(L, 1);
@@ -243,7 +519,7 @@ void parseConfigurationTable(lua_State* L, Configuration& config) {
     Variant result;
     readField(L, name, result);
     if (result.valueType == Variant::Type::STRING) {
-      dst.assign(std::string(result.value.stringValue));
+      dst.assign(result.value.stringValue.data, result.value.stringValue.length);
     }
   };
 
@@ -251,6 +527,11 @@ void parseConfigurationTable(lua_State* L, Configuration& config) {
   getInt(&config.screenHeight, "SCREEN_HEIGHT");
   getBoolean(&config.useFullscreen, "USE_FULLSCREEN");
   getBoolean(&config.debugMode, "DEBUG");
+  getBoolean(&config.hotReload, "HOT_RELOAD");
+  getBoolean(&config.idleGc, "IDLE_GC");
+  getInt(&config.targetFps, "TARGET_FPS");
+  getInt(&config.hookBudgetMilliseconds, "HOOK_BUDGET_MS");
+  getInt(&config.jobWorkers, "JOB_WORKERS");
   getString(config.windowTitle, "WINDOW_TITLE");
   getString(config.userCreateFunctionName, "create");
   getString(config.userDestroyFunctionName, "destroy");
@@ -277,51 +558,35 @@ namespace engine {
     return 0;
   }
 
-  int apiGetScreenWidth(lua_State* L) {
-    // pushes the screen width on the stack
-    lua_pushnumber(L, SharedContext::instance->scripting->getScreenWidth());
-    return 1;
-  }
-
-  int apiGetScreenHeight(lua_State* L) {
-    // pushes the screen height on the stack
-    lua_pushnumber(L, SharedContext::instance->scripting->getScreenHeight());
-    return 1;
-  }
-
-  int apiDrawCircle(lua_State* L) {
-    // expected to have been called with x, y, radius parameters
-    int x = 0;
-    int y = 0;
-    int radius = 0;
-
-    if (lua_gettop(L) >= 3) {
-      if (lua_isnumber(L, -1)) {
-        radius = lua_tonumber(L, -1);
-        lua_pop(L, 1);
-      } else {
-        // error
-      }
-
-      if (lua_isnumber(L, -1)) {
-        y = lua_tonumber(L, -1);
-        lua_pop(L, 1);
-      } else {
-        // error
-      }
-
-      if (lua_isnumber(L, -1)) {
-        x = lua_tonumber(L, -1);
-        lua_pop(L, 1);
-      } else {
-        // error
-      }
-    } else {
-      // error
+  // returns { live, peak, allocations, frees, sizeClasses = { allocations of each size class } } -
+  // see MemoryStats.hpp
+  int apiMemStats(lua_State* L) {
+    LuaAllocator* allocator = LuaAllocator::getAllocator(L);
+    if (allocator == nullptr) {
+      return luaL_error(L, "this lua state does not count its memory");
     }
+    MemoryStats const& stats = allocator->getStats();
+
+    lua_createtable(L, 0, 5);
+    // stack: [.., stats]
+    lua_pushinteger(L, static_cast<lua_Integer>(stats.liveBytes));
+    lua_setfield(L, -2, "live");
+    lua_pushinteger(L, static_cast<lua_Integer>(stats.peakBytes));
+    lua_setfield(L, -2, "peak");
+    lua_pushinteger(L, static_cast<lua_Integer>(stats.allocations));
+    lua_setfield(L, -2, "allocations");
+    lua_pushinteger(L, static_cast<lua_Integer>(stats.frees));
+    lua_setfield(L, -2, "frees");
+
+    lua_createtable(L, MemoryStats::SIZE_CLASSES, 0);
+    // stack: [.., stats, sizeClasses]
+    for (int i = 0; i < MemoryStats::SIZE_CLASSES; i++) {
+      lua_pushinteger(L, static_cast<lua_Integer>(stats.sizeClassAllocations[i]));
+      lua_rawseti(L, -2, i + 1);
+    }
+    lua_setfield(L, -2, "sizeClasses");
+    // stack: [.., stats]
 
-    SharedContext::instance->scripting->drawCircle(x, y, radius);
-
-    return 0;
+    return 1;
   }
 }
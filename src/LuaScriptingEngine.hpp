@@ -1,9 +1,17 @@
 #ifndef LUASCRIPTINGENGINE_H
 #define LUASCRIPTINGENGINE_H
 
+#include <map>
+#include <string>
+
 #include "ScriptingEngine.hpp"
+#include "LuaBytecodeCache.hpp"
 #include "lua/lua.hpp"
 
+class LuaHotReloader;
+class LuaJobSystem;
+class LuaScheduler;
+
 class LuaScriptingEngine : public ScriptingEngine {
   public:
     LuaScriptingEngine();
@@ -18,8 +26,52 @@ class LuaScriptingEngine : public ScriptingEngine {
     virtual void runDestroy();
     virtual void runUpdate(float deltaTime);
     virtual void runRender();
+    virtual void processReloads();
+    virtual void setIdleGc(bool enabled);
+    virtual void collectGarbage(std::chrono::steady_clock::time_point deadline);
+    // counted by the state's allocator - the job workers' states are not included
+    virtual bool getMemoryStats(MemoryStats& stats);
+
+    // records a script loaded through require so hot reload can watch it
+    void addModule(std::string const& moduleName, std::string const& filename);
 
     lua_State* L;
+
+    // the main script and everything loaded through require is loaded through the cache
+    LuaBytecodeCache bytecodeCache;
+
+    // watches the loaded scripts when the HOT_RELOAD configuration field is set
+    LuaHotReloader* reloader;
+    bool isReloading;
+    std::string mainFilename;
+    // module name -> file of every script loaded through require
+    std::map<std::string, std::string> modules;
+
+    // the tasks started with engine:spawn - resumed after the update hook
+    LuaScheduler* scheduler;
+    // the jobs started with engine:job - their results arrive before the tasks are resumed
+    LuaJobSystem* jobs;
+
+  protected:
+    virtual void startWatchdog();
+
+  private:
+    // HOOK_BUDGET_MS: the watchdog thread arms budgetHook on the running thread when a hook overruns.
+    // it raises a lua error at the next instruction and stays armed until the call unwinds, so a
+    // pcall in the script can't hold on to the call
+    static void interruptHook(void* data);
+    static void budgetHook(lua_State* L, lua_Debug* ar);
+
+    // calls the function below its nargs arguments on the stack and reports its errors
+    void callHook(int nargs);
+    // restarts lua's collector when the heap outgrew the IDLE_GC safety limit
+    void checkHeapLimit();
+
+    bool idleGc;
+    // an idle collection cycle is in progress
+    bool idleGcCycle;
+    // heap size after the last finished cycle
+    int liveHeapKb;
 };
 
 #endif // !LUASCRIPTINGENGINE_H
@@ -0,0 +1,161 @@
+#include <cstring>
+
+#include "LuaSerializer.hpp"
+
+namespace {
+  enum Tag {
+    TAG_NIL,
+    TAG_FALSE,
+    TAG_TRUE,
+    TAG_INTEGER,
+    TAG_FLOAT,
+    TAG_STRING,
+    TAG_TABLE,
+    // ends the key value pairs of a table
+    TAG_END
+  };
+
+  template<typename T>
+  void append(std::vector<char>& buffer, T const& value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+  }
+
+  template<typename T>
+  T take(lua_State* L, const char*& position, const char* end) {
+    if (static_cast<size_t>(end - position) < sizeof(T)) {
+      luaL_error(L, "malformed job buffer");
+    }
+    T value;
+    std::memcpy(&value, position, sizeof(T));
+    position += sizeof(T);
+    return value;
+  }
+}
+
+void LuaSerializer::write(lua_State* L, int first, int count, std::vector<char>& buffer) {
+  first = lua_absindex(L, first);
+  for (int i = 0; i < count; i++) {
+    writeValue(L, first + i, 0, buffer);
+  }
+}
+
+void LuaSerializer::writeValue(lua_State* L, int index, int depth, std::vector<char>& buffer) {
+  index = lua_absindex(L, index);
+  switch (lua_type(L, index)) {
+    case LUA_TNIL:
+      buffer.push_back(TAG_NIL);
+      break;
+
+    case LUA_TBOOLEAN:
+      buffer.push_back(lua_toboolean(L, index) ? TAG_TRUE : TAG_FALSE);
+      break;
+
+    case LUA_TNUMBER:
+      if (lua_isinteger(L, index)) {
+        buffer.push_back(TAG_INTEGER);
+        append(buffer, lua_tointeger(L, index));
+      } else {
+        buffer.push_back(TAG_FLOAT);
+        append(buffer, lua_tonumber(L, index));
+      }
+      break;
+
+    case LUA_TSTRING: {
+      size_t length = 0;
+      const char* string = lua_tolstring(L, index, &length);
+      buffer.push_back(TAG_STRING);
+      append(buffer, length);
+      buffer.insert(buffer.end(), string, string + length);
+    } break;
+
+    case LUA_TTABLE: {
+      if (depth >= MAX_DEPTH) {
+        luaL_error(L, "table nested deeper than %d levels (or containing itself) can't be copied", MAX_DEPTH);
+      }
+      luaL_checkstack(L, 2, "copying a table");
+
+      buffer.push_back(TAG_TABLE);
+      lua_pushnil(L);
+      // stack: [.., key]
+      while (lua_next(L, index)) {
+        // stack: [.., key, value]
+        writeValue(L, -2, depth + 1, buffer);
+        writeValue(L, -1, depth + 1, buffer);
+        lua_pop(L, 1);
+      }
+      buffer.push_back(TAG_END);
+    } break;
+
+    default:
+      luaL_error(L, "a %s can't be copied to another lua state", luaL_typename(L, index));
+      break;
+  }
+}
+
+int LuaSerializer::read(lua_State* L, std::vector<char> const& buffer) {
+  const char* position = buffer.data();
+  const char* end = position + buffer.size();
+
+  int count = 0;
+  while (position < end) {
+    luaL_checkstack(L, 1, "too many values");
+    readValue(L, position, end, 0);
+    count++;
+  }
+  return count;
+}
+
+void LuaSerializer::readValue(lua_State* L, const char*& position, const char* end, int depth) {
+  switch (take<char>(L, position, end)) {
+    case TAG_NIL:
+      lua_pushnil(L);
+      break;
+
+    case TAG_FALSE:
+      lua_pushboolean(L, 0);
+      break;
+
+    case TAG_TRUE:
+      lua_pushboolean(L, 1);
+      break;
+
+    case TAG_INTEGER:
+      lua_pushinteger(L, take<lua_Integer>(L, position, end));
+      break;
+
+    case TAG_FLOAT:
+      lua_pushnumber(L, take<lua_Number>(L, position, end));
+      break;
+
+    case TAG_STRING: {
+      size_t length = take<size_t>(L, position, end);
+      if (static_cast<size_t>(end - position) < length) {
+        luaL_error(L, "malformed job buffer");
+      }
+      lua_pushlstring(L, position, length);
+      position += length;
+    } break;
+
+    case TAG_TABLE: {
+      if (depth >= MAX_DEPTH) {
+        luaL_error(L, "malformed job buffer");
+      }
+      luaL_checkstack(L, 3, "copying a table");
+
+      lua_newtable(L);
+      // stack: [.., table]
+      while (position < end && *position != TAG_END) {
+        readValue(L, position, end, depth + 1);
+        readValue(L, position, end, depth + 1);
+        // stack: [.., table, key, value]
+        lua_rawset(L, -3);
+      }
+      take<char>(L, position, end);
+    } break;
+
+    default:
+      luaL_error(L, "malformed job buffer");
+      break;
+  }
+}
@@ -0,0 +1,31 @@
+#ifndef LUASERIALIZER_H
+#define LUASERIALIZER_H
+
+#include <vector>
+
+#include "lua/lua.hpp"
+
+// copies lua values between lua states through flat binary buffers - the job system (see
+// LuaJobSystem.hpp) passes arguments and results this way instead of sharing lua objects between
+// threads. nil, booleans, numbers, strings and tables of them are copied. tables are copied by
+// value: a table that appears twice arrives as two tables and their metatables are left behind
+//
+// each value is a tag byte followed by its payload in the machine's own byte order - the buffers
+// never leave the process
+class LuaSerializer {
+  public:
+    // appends count values starting at the stack index. raises a lua error for functions, userdata,
+    // threads and tables nested deeper than MAX_DEPTH, which includes tables that contain themselves
+    static void write(lua_State* L, int first, int count, std::vector<char>& buffer);
+
+    // pushes the values in the buffer and returns how many - raises a lua error for a malformed one
+    static int read(lua_State* L, std::vector<char> const& buffer);
+
+    static const int MAX_DEPTH = 32;
+
+  private:
+    static void writeValue(lua_State* L, int index, int depth, std::vector<char>& buffer);
+    static void readValue(lua_State* L, const char*& position, const char* end, int depth);
+};
+
+#endif // !LUASERIALIZER_H
@@ -0,0 +1,15 @@
+#include "MemoryStats.hpp"
+
+MemoryStats::MemoryStats()
+  : liveBytes(0),
+    peakBytes(0),
+    allocations(0),
+    frees(0) {
+  for (int i = 0; i < SIZE_CLASSES; i++) {
+    sizeClassAllocations[i] = 0;
+  }
+}
+
+size_t MemoryStats::sizeClassLimit(int sizeClass) {
+  return sizeClass < SIZE_CLASSES - 1 ? size_t(16) << sizeClass : 0;
+}
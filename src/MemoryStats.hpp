@@ -0,0 +1,52 @@
+#ifndef MEMORYSTATS_H
+#define MEMORYSTATS_H
+
+#include <cstddef>
+
+// the memory a script vm uses, counted by its engine - see ScriptingEngine::getMemoryStats. a block
+// that is resized counts as freed and allocated again
+struct MemoryStats {
+  // allocations are counted by size in powers of two: blocks up to 16 bytes, up to 32, ... up to
+  // 4 KB, and everything larger in the last class
+  static const int SIZE_CLASSES = 10;
+
+  size_t liveBytes;
+  size_t peakBytes;
+  unsigned long long allocations;
+  unsigned long long frees;
+  unsigned long long sizeClassAllocations[SIZE_CLASSES];
+
+  MemoryStats();
+
+  void allocated(size_t size) {
+    liveBytes += size;
+    if (liveBytes > peakBytes) {
+      peakBytes = liveBytes;
+    }
+    allocations++;
+    sizeClassAllocations[sizeClassOf(size)]++;
+  }
+
+  void freed(size_t size) {
+    liveBytes -= size;
+    frees++;
+  }
+
+  void resized(size_t oldSize, size_t newSize) {
+    freed(oldSize);
+    allocated(newSize);
+  }
+
+  static int sizeClassOf(size_t size) {
+    int sizeClass = 0;
+    for (size_t rest = size > 16 ? (size - 1) >> 4 : 0; rest != 0 && sizeClass < SIZE_CLASSES - 1; rest >>= 1) {
+      sizeClass++;
+    }
+    return sizeClass;
+  }
+
+  // the largest block of a size class - 0 for the last one, which has no limit
+  static size_t sizeClassLimit(int sizeClass);
+};
+
+#endif // !MEMORYSTATS_H
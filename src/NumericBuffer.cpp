@@ -0,0 +1,93 @@
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <sstream>
+
+#include "NumericBuffer.hpp"
+
+NumericBuffer::NumericBuffer(Type type, size_t count)
+  : type(type),
+    count(count),
+    storage(nullptr) {
+  // round up so an empty buffer still gets a valid pointer and SIMD loops can read whole lanes
+  size_t bytes = ((byteSize() + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+  if (bytes == 0) {
+    bytes = ALIGNMENT;
+  }
+
+  if (posix_memalign(&storage, ALIGNMENT, bytes) != 0) {
+    std::stringstream msg;
+    msg << "Unable to allocate a numeric buffer of " << count << " elements" << std::endl;
+    throw std::runtime_error(msg.str());
+  }
+
+  std::memset(storage, 0, bytes);
+}
+
+NumericBuffer::~NumericBuffer() {
+  std::free(storage);
+  storage = nullptr;
+}
+
+size_t NumericBuffer::elementSize() const {
+  switch (type) {
+    case FLOAT32: return sizeof(float);
+    case FLOAT64: return sizeof(double);
+    case INT32: return sizeof(int32_t);
+  }
+  return 0;
+}
+
+double NumericBuffer::get(size_t index) const {
+  switch (type) {
+    case FLOAT32: return static_cast<float*>(storage)[index];
+    case FLOAT64: return static_cast<double*>(storage)[index];
+    case INT32: return static_cast<int32_t*>(storage)[index];
+  }
+  return 0;
+}
+
+void NumericBuffer::set(size_t index, double value) {
+  switch (type) {
+    case FLOAT32: static_cast<float*>(storage)[index] = static_cast<float>(value); break;
+    case FLOAT64: static_cast<double*>(storage)[index] = value; break;
+    case INT32: static_cast<int32_t*>(storage)[index] = static_cast<int32_t>(value); break;
+  }
+}
+
+void NumericBuffer::fill(double value) {
+  for (size_t i = 0; i < count; i++) {
+    set(i, value);
+  }
+}
+
+bool NumericBuffer::parseType(const char* name, Type* type) {
+  if (std::strcmp(name, "float32") == 0) {
+    *type = FLOAT32;
+  } else if (std::strcmp(name, "float64") == 0) {
+    *type = FLOAT64;
+  } else if (std::strcmp(name, "int32") == 0) {
+    *type = INT32;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* NumericBuffer::typeName(Type type) {
+  switch (type) {
+    case FLOAT32: return "float32";
+    case FLOAT64: return "float64";
+    case INT32: return "int32";
+  }
+  return "";
+}
+
+const char* NumericBuffer::formatCode(Type type) {
+  switch (type) {
+    case FLOAT32: return "f";
+    case FLOAT64: return "d";
+    case INT32: return "i";
+  }
+  return "";
+}
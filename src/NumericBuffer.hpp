@@ -0,0 +1,54 @@
+#ifndef NUMERICBUFFER_H
+#define NUMERICBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// a fixed size array of numbers allocated by the engine
+// scripts and native systems read and write the same memory - the script side objects
+// (lua userdata, python buffer protocol object, ruby Engine::Buffer) hold a reference, never a copy
+class NumericBuffer {
+  public:
+    enum Type { FLOAT32, FLOAT64, INT32 };
+
+    // element storage is aligned for SIMD loads
+    static const size_t ALIGNMENT = 32;
+
+    NumericBuffer(Type type, size_t count);
+    ~NumericBuffer();
+
+    Type getType() const { return type; }
+    size_t size() const { return count; }
+    size_t elementSize() const;
+    size_t byteSize() const { return count * elementSize(); }
+    void* data() { return storage; }
+
+    float* float32() { return type == FLOAT32 ? static_cast<float*>(storage) : nullptr; }
+    double* float64() { return type == FLOAT64 ? static_cast<double*>(storage) : nullptr; }
+    int32_t* int32() { return type == INT32 ? static_cast<int32_t*>(storage) : nullptr; }
+
+    // element access converting through double - index must be in range
+    double get(size_t index) const;
+    void set(size_t index, double value);
+    void fill(double value);
+
+    // type names used by scripts: "float32", "float64", "int32"
+    static bool parseType(const char* name, Type* type);
+    static const char* typeName(Type type);
+
+    // struct / buffer protocol format character for the element type
+    static const char* formatCode(Type type);
+
+  private:
+    NumericBuffer(NumericBuffer const&);
+    NumericBuffer& operator=(NumericBuffer const&);
+
+    Type type;
+    size_t count;
+    void* storage;
+};
+
+typedef std::shared_ptr<NumericBuffer> NumericBufferRef;
+
+#endif // !NUMERICBUFFER_H
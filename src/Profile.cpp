@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include "Profile.hpp"
+
+Profile::Profile()
+  : intervalMilliseconds(1),
+    sampleCount(0),
+    traced(false) {
+}
+
+void Profile::setInterval(double milliseconds) {
+  intervalMilliseconds = milliseconds;
+}
+
+void Profile::addSample(std::vector<std::string> const& stack, unsigned long long count) {
+  if (stack.empty() || count == 0) {
+    return;
+  }
+
+  std::string folded;
+  std::set<std::string> seen;
+  for (size_t i = 0; i < stack.size(); i++) {
+    // ';' separates the frames of a folded stack
+    std::string frame = stack[i];
+    std::replace(frame.begin(), frame.end(), ';', ':');
+
+    if (i > 0) {
+      folded += ';';
+    }
+    folded += frame;
+
+    // recursive functions count towards their total once per sample
+    if (seen.insert(frame).second) {
+      functions[frame].total += count;
+    }
+    if (i + 1 == stack.size()) {
+      functions[frame].self += count;
+    }
+  }
+
+  stacks[folded] += count;
+  sampleCount += count;
+}
+
+void Profile::clear() {
+  stacks.clear();
+  functions.clear();
+  sampleCount = 0;
+  traced = false;
+  callStack.clear();
+  openCalls.clear();
+}
+
+void Profile::beginCall(std::string const& frame) {
+  Clock::time_point entered = Clock::now();
+
+  if (!traced) {
+    traced = true;
+    intervalMilliseconds = 1e-6;
+  }
+
+  callStack.push_back(frame);
+  openCalls.push_back(OpenCall());
+
+  // the bookkeeping is not the caller's time
+  Clock::time_point now = Clock::now();
+  if (openCalls.size() > 1) {
+    openCalls[openCalls.size() - 2].children += std::chrono::duration_cast<std::chrono::nanoseconds>(now - entered).count();
+  }
+
+  openCalls.back().start = now;
+  openCalls.back().children = 0;
+}
+
+void Profile::endCall() {
+  Clock::time_point returned = Clock::now();
+
+  // returns from calls that were open before tracing started
+  if (openCalls.empty()) {
+    return;
+  }
+
+  unsigned long long total = std::chrono::duration_cast<std::chrono::nanoseconds>(returned - openCalls.back().start).count();
+  unsigned long long children = openCalls.back().children;
+
+  addSample(callStack, total > children ? total - children : 0);
+
+  callStack.pop_back();
+  openCalls.pop_back();
+  if (!openCalls.empty()) {
+    openCalls.back().children += total + std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - returned).count();
+  }
+}
+
+void Profile::endCalls() {
+  while (!openCalls.empty()) {
+    endCall();
+  }
+}
+
+void Profile::writeFolded(std::ostream& out) const {
+  for (std::map<std::string, unsigned long long>::const_iterator it = stacks.begin(); it != stacks.end(); ++it) {
+    out << it->first << " " << it->second << "\n";
+  }
+}
+
+void Profile::writeSummary(std::ostream& out) const {
+  std::vector<std::pair<std::string, Counts> > sorted(functions.begin(), functions.end());
+  std::sort(sorted.begin(), sorted.end(), [](std::pair<std::string, Counts> const& a, std::pair<std::string, Counts> const& b) {
+    return a.second.self != b.second.self ? a.second.self > b.second.self : a.second.total > b.second.total;
+  });
+
+  double samples = sampleCount > 0 ? static_cast<double>(sampleCount) : 1;
+
+  out << std::fixed << std::setprecision(1);
+  if (traced) {
+    out << "traced calls, " << sampleCount * intervalMilliseconds << " ms\n\n";
+  } else {
+    out << sampleCount << " samples, " << intervalMilliseconds << " ms each\n\n";
+  }
+
+  out
+    << std::setw(10) << "self ms" << std::setw(8) << "self%"
+    << std::setw(10) << "total ms" << std::setw(8) << "total%" << "  function\n";
+
+  for (size_t i = 0; i < sorted.size(); i++) {
+    Counts const& counts = sorted[i].second;
+    out << std::setw(10) << counts.self * intervalMilliseconds
+      << std::setw(8) << 100.0 * counts.self / samples
+      << std::setw(10) << counts.total * intervalMilliseconds
+      << std::setw(8) << 100.0 * counts.total / samples
+      << "  " << sorted[i].first << "\n";
+  }
+}
+
+void Profile::save(std::string const& filename) const {
+  std::ofstream folded(filename.c_str());
+  std::string summaryFilename = filename + ".txt";
+  std::ofstream summary(summaryFilename.c_str());
+
+  if (!folded || !summary) {
+    std::stringstream msg;
+    msg << "Unable to write profile " << filename << std::endl;
+    throw std::runtime_error(msg.str());
+  }
+
+  writeFolded(folded);
+  writeSummary(summary);
+}
@@ -0,0 +1,66 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <chrono>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// call stack samples of a script profiler, the same for every language
+// the profile is written in two parts:
+//   <file>      folded stacks - "outer;inner;leaf count" per line, the input of flamegraph.pl,
+//               speedscope and inferno
+//   <file>.txt  every function with its self and total time, slowest self time first
+// a sample stands for one profiler interval of cpu time. tracing profilers report calls instead and
+// their samples are nanoseconds
+class Profile {
+  public:
+    Profile();
+
+    void setInterval(double milliseconds);
+    double getInterval() const { return intervalMilliseconds; }
+
+    // frames are outermost first
+    void addSample(std::vector<std::string> const& stack, unsigned long long count = 1);
+    unsigned long long getSampleCount() const { return sampleCount; }
+    void clear();
+
+    // tracing profilers report every call: the time between beginCall and endCall, minus the calls made
+    // in between, is added to the stack of open calls as self time
+    void beginCall(std::string const& frame);
+    void endCall();
+    // ends the calls still open - when tracing stops in the middle of a script
+    void endCalls();
+
+    void writeFolded(std::ostream& out) const;
+    void writeSummary(std::ostream& out) const;
+    void save(std::string const& filename) const;
+
+  private:
+    struct Counts {
+      unsigned long long self;
+      unsigned long long total;
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct OpenCall {
+      Clock::time_point start;
+      // nanoseconds spent in the calls it made
+      unsigned long long children;
+    };
+
+    double intervalMilliseconds;
+    unsigned long long sampleCount;
+    // folded stack -> samples
+    std::map<std::string, unsigned long long> stacks;
+    // frame -> samples
+    std::map<std::string, Counts> functions;
+
+    bool traced;
+    std::vector<std::string> callStack;
+    std::vector<OpenCall> openCalls;
+};
+
+#endif // !PROFILE_H
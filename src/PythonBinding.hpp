@@ -0,0 +1,168 @@
+#ifndef PYTHONBINDING_H
+#define PYTHONBINDING_H
+
+#include <Python.h>
+
+#include <climits>
+#include <tuple>
+
+#include "Binding.hpp"
+#include "PythonBuffer.hpp"
+
+// generates fast-call glue for a native function - see Binding.hpp
+
+// the api functions use the fast-call convention (arguments as a C array, no tuple)
+// METH_FASTCALL is public from python 3.7 - older interpreters get a METH_VARARGS adapter
+typedef PyObject* (*FastFunction)(PyObject* self, PyObject* const* args, Py_ssize_t nargs);
+
+#if PY_VERSION_HEX >= 0x03070000
+#define ENGINE_FASTCALL_FLAGS METH_FASTCALL
+#define ENGINE_FASTCALL(fn) reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(fn))
+#else
+template <FastFunction Fn>
+PyObject* varargsAdapter(PyObject* self, PyObject* params) {
+  return Fn(self, &PyTuple_GET_ITEM(params, 0), PyTuple_GET_SIZE(params));
+}
+
+#define ENGINE_FASTCALL_FLAGS METH_VARARGS
+#define ENGINE_FASTCALL(fn) varargsAdapter<fn>
+#endif
+
+namespace binding {
+  namespace python {
+    inline bool checkArgumentCount(char const* name, Py_ssize_t nargs, Py_ssize_t expected) {
+      if (nargs != expected) {
+        PyErr_Format(PyExc_TypeError, "%s() takes exactly %zd arguments (%zd given)", name, expected, nargs);
+        return false;
+      }
+      return true;
+    }
+
+    template <typename T> struct Arg;
+
+    // ints only, no floats - the same as PyArg_ParseTuple "i"
+    template <> struct Arg<int> {
+      static bool get(PyObject* arg, int* dst) {
+        if (!PyLong_Check(arg)) {
+          PyErr_Format(PyExc_TypeError, "an integer is required (got type %.200s)", Py_TYPE(arg)->tp_name);
+          return false;
+        }
+
+        long value = PyLong_AsLong(arg);
+        if (value == -1 && PyErr_Occurred()) {
+          return false;
+        }
+
+        if (value < INT_MIN || value > INT_MAX) {
+          PyErr_SetString(PyExc_OverflowError, "integer argument out of range");
+          return false;
+        }
+
+        *dst = static_cast<int>(value);
+        return true;
+      }
+    };
+
+    template <> struct Arg<double> {
+      static bool get(PyObject* arg, double* dst) {
+        double value = PyFloat_AsDouble(arg);
+        if (value == -1.0 && PyErr_Occurred()) {
+          return false;
+        }
+        *dst = value;
+        return true;
+      }
+    };
+
+    template <> struct Arg<float> {
+      static bool get(PyObject* arg, float* dst) {
+        double value = 0;
+        if (!Arg<double>::get(arg, &value)) {
+          return false;
+        }
+        *dst = static_cast<float>(value);
+        return true;
+      }
+    };
+
+    template <> struct Arg<bool> {
+      static bool get(PyObject* arg, bool* dst) {
+        int value = PyObject_IsTrue(arg);
+        if (value < 0) {
+          return false;
+        }
+        *dst = value != 0;
+        return true;
+      }
+    };
+
+    // the utf8 buffer is owned by the argument object, which outlives the call
+    template <> struct Arg<const char*> {
+      static bool get(PyObject* arg, const char** dst) {
+        *dst = PyUnicode_AsUTF8(arg);
+        return *dst != nullptr;
+      }
+    };
+
+    template <> struct Arg<NumericBuffer*> {
+      static bool get(PyObject* arg, NumericBuffer** dst) {
+        *dst = PythonBuffer::check(arg);
+        return *dst != nullptr;
+      }
+    };
+
+    inline PyObject* box(int value) { return PyLong_FromLong(value); }
+    inline PyObject* box(float value) { return PyFloat_FromDouble(value); }
+    inline PyObject* box(double value) { return PyFloat_FromDouble(value); }
+    inline PyObject* box(bool value) { return PyBool_FromLong(value); }
+    inline PyObject* box(const char* value) { return PyUnicode_FromString(value); }
+
+    template <typename R> struct Invoke {
+      template <typename Fn, typename... Values>
+      static PyObject* call(Fn fn, Values... values) {
+        return box(fn(values...));
+      }
+    };
+
+    template <> struct Invoke<void> {
+      template <typename Fn, typename... Values>
+      static PyObject* call(Fn fn, Values... values) {
+        fn(values...);
+        Py_RETURN_NONE;
+      }
+    };
+
+    template <typename Fn, Fn fn> struct Function;
+
+    template <typename R, typename... Args, R (*fn)(Args...)>
+    struct Function<R (*)(Args...), fn> {
+      typedef Signature<R (*)(Args...)> Traits;
+
+      static PyObject* call(PyObject* self, PyObject* const* args, Py_ssize_t nargs) {
+        if (nargs != Traits::arity) {
+          PyErr_Format(PyExc_TypeError, "expected %d arguments (%zd given)", Traits::arity, nargs);
+          return nullptr;
+        }
+        return invoke(args, typename Traits::Indices());
+      }
+
+      template <std::size_t... I>
+      static PyObject* invoke(PyObject* const* args, std::index_sequence<I...>) {
+        std::tuple<Args...> values;
+        // braced initializers run left to right - stop converting at the first failure
+        bool ok = true;
+        int expand[] = { 0, (ok = ok && Arg<Args>::get(args[I], &std::get<I>(values)), 0)... };
+        (void)expand;
+        if (!ok) {
+          return nullptr;
+        }
+        return Invoke<R>::call(fn, std::get<I>(values)...);
+      }
+    };
+  }
+}
+
+// PyMethodDef function for a native function - use with ENGINE_FASTCALL_FLAGS
+#define PYTHON_BINDING(fn) ENGINE_FASTCALL((binding::python::Function<decltype(&fn), &fn>::call))
+
+#endif // !PYTHONBINDING_H
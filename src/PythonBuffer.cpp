@@ -0,0 +1,174 @@
+#include <exception>
+#include <new>
+
+#include "PythonBuffer.hpp"
+#include "PythonBinding.hpp"
+
+struct BufferObject {
+  PyObject_HEAD
+  NumericBufferRef buffer;
+  Py_ssize_t shape;
+  Py_ssize_t itemSize;
+};
+
+// the head gives the static type its first reference - the one PyModule_AddObject takes is extra
+static PyTypeObject bufferType = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  "engine.Buffer",
+  sizeof(BufferObject)
+};
+
+static void bufferDealloc(PyObject* self) {
+  BufferObject* object = reinterpret_cast<BufferObject*>(self);
+  object->buffer.~NumericBufferRef();
+  Py_TYPE(self)->tp_free(self);
+}
+
+static int bufferGetBuffer(PyObject* self, Py_buffer* view, int flags) {
+  BufferObject* object = reinterpret_cast<BufferObject*>(self);
+  NumericBuffer& buffer = *object->buffer;
+
+  view->obj = self;
+  Py_INCREF(self);
+  view->buf = buffer.data();
+  view->len = static_cast<Py_ssize_t>(buffer.byteSize());
+  view->readonly = 0;
+  view->itemsize = object->itemSize;
+  view->format = (flags & PyBUF_FORMAT) ? const_cast<char*>(NumericBuffer::formatCode(buffer.getType())) : nullptr;
+  view->ndim = 1;
+  view->shape = (flags & PyBUF_ND) ? &object->shape : nullptr;
+  view->strides = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ? &object->itemSize : nullptr;
+  view->suboffsets = nullptr;
+  view->internal = nullptr;
+  return 0;
+}
+
+static Py_ssize_t bufferLength(PyObject* self) {
+  return reinterpret_cast<BufferObject*>(self)->shape;
+}
+
+static bool checkElement(PyObject* self, Py_ssize_t index) {
+  if (index < 0 || index >= bufferLength(self)) {
+    PyErr_SetString(PyExc_IndexError, "buffer index out of range");
+    return false;
+  }
+  return true;
+}
+
+static PyObject* bufferItem(PyObject* self, Py_ssize_t index) {
+  if (!checkElement(self, index)) {
+    return nullptr;
+  }
+
+  NumericBuffer& buffer = *reinterpret_cast<BufferObject*>(self)->buffer;
+  if (buffer.getType() == NumericBuffer::INT32) {
+    return PyLong_FromLong(buffer.int32()[index]);
+  }
+  return PyFloat_FromDouble(buffer.get(static_cast<size_t>(index)));
+}
+
+static int bufferAssignItem(PyObject* self, Py_ssize_t index, PyObject* value) {
+  if (!value) {
+    PyErr_SetString(PyExc_TypeError, "cannot delete buffer elements");
+    return -1;
+  }
+
+  if (!checkElement(self, index)) {
+    return -1;
+  }
+
+  double number = 0;
+  if (!binding::python::Arg<double>::get(value, &number)) {
+    return -1;
+  }
+
+  reinterpret_cast<BufferObject*>(self)->buffer->set(static_cast<size_t>(index), number);
+  return 0;
+}
+
+static PyObject* bufferGetType(PyObject* self, void* closure) {
+  return PyUnicode_FromString(NumericBuffer::typeName(reinterpret_cast<BufferObject*>(self)->buffer->getType()));
+}
+
+static PySequenceMethods bufferSequence;
+static PyBufferProcs bufferProcs;
+
+static PyGetSetDef bufferProperties[] = {
+  { const_cast<char*>("type"), bufferGetType, nullptr, const_cast<char*>("element type name"), nullptr },
+  { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+bool PythonBuffer::registerType(PyObject* module) {
+  bufferSequence.sq_length = bufferLength;
+  bufferSequence.sq_item = bufferItem;
+  bufferSequence.sq_ass_item = bufferAssignItem;
+
+  bufferProcs.bf_getbuffer = bufferGetBuffer;
+
+  bufferType.tp_dealloc = bufferDealloc;
+  bufferType.tp_as_sequence = &bufferSequence;
+  bufferType.tp_as_buffer = &bufferProcs;
+  bufferType.tp_getset = bufferProperties;
+  bufferType.tp_flags = Py_TPFLAGS_DEFAULT;
+  bufferType.tp_doc = "engine owned typed numeric buffer";
+
+  if (PyType_Ready(&bufferType) < 0) {
+    return false;
+  }
+
+  Py_INCREF(&bufferType);
+  if (PyModule_AddObject(module, "Buffer", reinterpret_cast<PyObject*>(&bufferType)) < 0) {
+    Py_DECREF(&bufferType);
+    return false;
+  }
+
+  return true;
+}
+
+PyObject* PythonBuffer::wrap(NumericBufferRef const& buffer) {
+  BufferObject* object = PyObject_New(BufferObject, &bufferType);
+  if (!object) {
+    return nullptr;
+  }
+
+  new (&object->buffer) NumericBufferRef(buffer);
+  object->shape = static_cast<Py_ssize_t>(buffer->size());
+  object->itemSize = static_cast<Py_ssize_t>(buffer->elementSize());
+  return reinterpret_cast<PyObject*>(object);
+}
+
+NumericBuffer* PythonBuffer::check(PyObject* object) {
+  if (!PyObject_TypeCheck(object, &bufferType)) {
+    PyErr_Format(PyExc_TypeError, "an engine.Buffer is required (got type %.200s)", Py_TYPE(object)->tp_name);
+    return nullptr;
+  }
+  return reinterpret_cast<BufferObject*>(object)->buffer.get();
+}
+
+PyObject* PythonBuffer::apiCreateBuffer(PyObject* self, PyObject* const* args, Py_ssize_t nargs) {
+  const char* typeName = nullptr;
+  int count = 0;
+  if (!binding::python::checkArgumentCount("createBuffer", nargs, 2) ||
+      !binding::python::Arg<const char*>::get(args[0], &typeName) ||
+      !binding::python::Arg<int>::get(args[1], &count)) {
+    return nullptr;
+  }
+
+  NumericBuffer::Type type;
+  if (!NumericBuffer::parseType(typeName, &type)) {
+    PyErr_Format(PyExc_ValueError, "unknown buffer type %s (expected float32, float64 or int32)", typeName);
+    return nullptr;
+  }
+
+  if (count < 0) {
+    PyErr_SetString(PyExc_ValueError, "buffer size must not be negative");
+    return nullptr;
+  }
+
+  // no C++ exception may cross the interpreter's frames
+  try {
+    return wrap(std::make_shared<NumericBuffer>(type, static_cast<size_t>(count)));
+  } catch (std::exception const&) {
+    return PyErr_NoMemory();
+  }
+}
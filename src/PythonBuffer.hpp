@@ -0,0 +1,26 @@
+#ifndef PYTHONBUFFER_H
+#define PYTHONBUFFER_H
+
+#include <Python.h>
+
+#include "NumericBuffer.hpp"
+
+// exposes NumericBuffer to python as engine.Buffer
+// the object implements the buffer protocol so memoryview(buf) (and numpy, array, struct.pack_into)
+// work on the engine memory directly - len(buf), buf[i] and buf[i] = v are also supported
+class PythonBuffer {
+  public:
+    // readies the type and adds it to the engine module
+    static bool registerType(PyObject* module);
+
+    // returns a new reference to an engine.Buffer referencing the buffer
+    static PyObject* wrap(NumericBufferRef const& buffer);
+
+    // returns the buffer for an engine.Buffer object or sets a TypeError and returns nullptr
+    static NumericBuffer* check(PyObject* object);
+
+    // engine.createBuffer(type, count)
+    static PyObject* apiCreateBuffer(PyObject* self, PyObject* const* args, Py_ssize_t nargs);
+};
+
+#endif // !PYTHONBUFFER_H
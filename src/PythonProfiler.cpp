@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <csignal>
+#include <sstream>
+#include <vector>
+
+#include "PythonProfiler.hpp"
+#include "SamplingTimer.hpp"
+
+namespace {
+  PythonProfiler* activeProfiler = nullptr;
+
+  // the frame accessors are functions from python 3.9 on, and the frame struct is private from 3.11
+  PyCodeObject* getCode(PyFrameObject* frame) {
+    #if PY_VERSION_HEX >= 0x03090000
+    return PyFrame_GetCode(frame);
+    #else
+    Py_INCREF(frame->f_code);
+    return frame->f_code;
+    #endif
+  }
+
+  PyFrameObject* getBack(PyFrameObject* frame) {
+    #if PY_VERSION_HEX >= 0x03090000
+    return PyFrame_GetBack(frame);
+    #else
+    Py_XINCREF(frame->f_back);
+    return frame->f_back;
+    #endif
+  }
+
+  std::string describeFrame(PyFrameObject* frame) {
+    PyCodeObject* code = getCode(frame);
+
+    const char* name = PyUnicode_AsUTF8(code->co_name);
+    const char* filename = PyUnicode_AsUTF8(code->co_filename);
+
+    std::stringstream description;
+    description << (name ? name : "?") << " (" << (filename ? filename : "?") << ":" << code->co_firstlineno << ")";
+
+    Py_DECREF(code);
+    return description.str();
+  }
+}
+
+PythonProfiler::PythonProfiler()
+  : previousHandler(nullptr) {
+}
+
+PythonProfiler::~PythonProfiler() {
+  stop();
+}
+
+bool PythonProfiler::startSampling(int intervalMicroseconds) {
+  if (activeProfiler != nullptr) {
+    return false;
+  }
+
+  static PyMethodDef handlerDefinition = {"profilerSignal", signalHandler, METH_VARARGS, nullptr};
+  PyObject* handler = PyCFunction_New(&handlerDefinition, nullptr);
+  if (handler == nullptr) {
+    PyErr_Print();
+    return false;
+  }
+
+  // python's own handler has to be installed first so the timer has it to forward to
+  previousHandler = setSignalHandler(handler);
+  Py_DECREF(handler);
+  if (previousHandler == nullptr) {
+    return false;
+  }
+
+  activeProfiler = this;
+  if (!samplingTimer::start(intervalMicroseconds, tick, this)) {
+    stopSampling();
+    return false;
+  }
+  return true;
+}
+
+void PythonProfiler::stopSampling() {
+  samplingTimer::stop();
+  activeProfiler = nullptr;
+
+  if (previousHandler != nullptr) {
+    Py_XDECREF(setSignalHandler(previousHandler));
+    Py_DECREF(previousHandler);
+    previousHandler = nullptr;
+  }
+}
+
+bool PythonProfiler::startTracing() {
+  if (activeProfiler != nullptr) {
+    return false;
+  }
+
+  activeProfiler = this;
+  PyEval_SetProfile(traceCall, nullptr);
+  return true;
+}
+
+void PythonProfiler::stopTracing() {
+  PyEval_SetProfile(nullptr, nullptr);
+  activeProfiler = nullptr;
+}
+
+// signal context
+void PythonProfiler::requestSample() {
+  samplingTimer::forward();
+}
+
+// signal context
+void PythonProfiler::tick(void* data) {
+  static_cast<PythonProfiler*>(data)->ScriptProfiler::tick();
+}
+
+PyObject* PythonProfiler::setSignalHandler(PyObject* handler) {
+  PyObject* signalModule = PyImport_ImportModule("signal");
+  if (signalModule == nullptr) {
+    PyErr_Print();
+    return nullptr;
+  }
+
+  PyObject* previous = PyObject_CallMethod(signalModule, "signal", "iO", SIGPROF, handler);
+  Py_DECREF(signalModule);
+  if (previous == nullptr) {
+    PyErr_Print();
+  }
+  return previous;
+}
+
+PyObject* PythonProfiler::signalHandler(PyObject* self, PyObject* args) {
+  // a tick that was forwarded just before the profiler stopped can still arrive here
+  if (activeProfiler != nullptr) {
+    activeProfiler->sample();
+  }
+  Py_RETURN_NONE;
+}
+
+void PythonProfiler::sample() {
+  unsigned ticks = takeTicks();
+  if (ticks == 0) {
+    return;
+  }
+
+  std::vector<std::string> stack;
+  PyFrameObject* frame = PyEval_GetFrame();
+  Py_XINCREF(frame);
+  while (frame != nullptr) {
+    stack.push_back(describeFrame(frame));
+    PyFrameObject* back = getBack(frame);
+    Py_DECREF(frame);
+    frame = back;
+  }
+  std::reverse(stack.begin(), stack.end());
+
+  profile.addSample(stack, ticks);
+}
+
+int PythonProfiler::traceCall(PyObject* object, PyFrameObject* frame, int what, PyObject* arg) {
+  PythonProfiler* profiler = activeProfiler;
+  if (profiler == nullptr) {
+    return 0;
+  }
+
+  if (what == PyTrace_CALL) {
+    profiler->profile.beginCall(describeFrame(frame));
+  } else if (what == PyTrace_RETURN) {
+    profiler->profile.endCall();
+  }
+  return 0;
+}
@@ -0,0 +1,49 @@
+#ifndef PYTHONPROFILER_H
+#define PYTHONPROFILER_H
+
+#include <Python.h>
+#include <frameobject.h>
+
+#include <string>
+
+#include "ScriptProfiler.hpp"
+
+// profiler for the python interpreter - see ScriptProfiler.hpp
+//
+// sampling: python has its own SIGPROF handler (from the signal module) that only marks the signal
+// and lets the main thread run a python level handler at its next check between bytecodes - the
+// profiler registers a native function there that walks the frames. SamplingTimer sits in front of
+// python's handler and forwards only the ticks that land inside a script call, so time in native
+// engine code still goes to [engine]. a tick inside a native function is recorded when it returns to
+// python, in the script function that called it.
+//
+// Py_AddPendingCall from another thread is not an option: from 3.9 to 3.11 the interpreter only
+// notices calls queued by the main thread until something else interrupts it.
+//
+// tracing: PyEval_SetProfile call and return events - native functions are left out
+class PythonProfiler : public ScriptProfiler {
+  public:
+    PythonProfiler();
+    virtual ~PythonProfiler();
+
+  protected:
+    virtual bool startSampling(int intervalMicroseconds);
+    virtual void stopSampling();
+    virtual bool startTracing();
+    virtual void stopTracing();
+    virtual void requestSample();
+
+  private:
+    static void tick(void* data);
+    static PyObject* signalHandler(PyObject* self, PyObject* args);
+    static int traceCall(PyObject* object, PyFrameObject* frame, int what, PyObject* arg);
+
+    // installs handler as the python level SIGPROF handler and returns the one it replaced
+    static PyObject* setSignalHandler(PyObject* handler);
+
+    void sample();
+
+    PyObject* previousHandler;
+};
+
+#endif // !PYTHONPROFILER_H
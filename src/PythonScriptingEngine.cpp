@@ -5,41 +5,179 @@
 #include <vector>
 #include <map>
 #include <algorithm>
+#include <csignal>
 
 #include "PythonScriptingEngine.hpp"
+#include "PythonBinding.hpp"
+#include "PythonBuffer.hpp"
+#include "PythonProfiler.hpp"
+#include "EngineApi.hpp"
 #include "Backend.hpp"
 #include "ScriptingEngine.hpp"
 #include "SharedContext.hpp"
+#include "Trace.hpp"
 
 void parseConfigurationTable(PyObject* params, Configuration& config);
 
+// IDLE_GC: the youngest generation is collected once it holds half its threshold and the older ones
+// at python's own thresholds. a generation past this many times its threshold is collected even
+// when the idle time is too short, and the frames collect again once the youngest one gets there
+static const int IDLE_GC_LIMIT_FACTOR = 4;
+
 namespace engine {
-  PyObject* apiInit(PyObject* self, PyObject* params);
-  PyObject* apiGetScreenWidth(PyObject* self, PyObject* params);
-  PyObject* apiGetScreenHeight(PyObject* self, PyObject* params);
-  PyObject* apiDrawCircle(PyObject* self, PyObject* params);
+  PyObject* apiInit(PyObject* self, PyObject* const* args, Py_ssize_t nargs);
+  PyObject* apiMemStats(PyObject* self, PyObject* const* args, Py_ssize_t nargs);
 }
 
+#define PYTHON_API_FUNCTION(name, description) { #name, PYTHON_BINDING(engine::native::name), ENGINE_FASTCALL_FLAGS, description },
 static PyMethodDef apiFunctions[] = {
-  { "init", engine::apiInit, METH_VARARGS, "initialize the engine" },
-  { "getScreenWidth", engine::apiGetScreenWidth, METH_VARARGS, "get the width of the screen" },
-  { "getScreenHeight", engine::apiGetScreenHeight, METH_VARARGS, "get the height of the screen" },
-  { "drawCircle", engine::apiDrawCircle, METH_VARARGS, "draw a filled circle given center x and y and radius" },
+  { "init", ENGINE_FASTCALL(engine::apiInit), ENGINE_FASTCALL_FLAGS, "initialize the engine" },
+  { "createBuffer", ENGINE_FASTCALL(PythonBuffer::apiCreateBuffer), ENGINE_FASTCALL_FLAGS, "create an engine owned numeric buffer given a type name and element count" },
+  { "memStats", ENGINE_FASTCALL(engine::apiMemStats), ENGINE_FASTCALL_FLAGS, "get the memory the interpreter uses as a dict" },
+  ENGINE_NATIVE_API(PYTHON_API_FUNCTION)
   { 0, 0, 0, 0 }
 };
+#undef PYTHON_API_FUNCTION
 
 static PyModuleDef engineModule = {
   PyModuleDef_HEAD_INIT, "engine", 0, -1, apiFunctions, 0, 0, 0, 0
 };
 
 static PyObject* initializeEngineModule(void) {
-  return PyModule_Create(&engineModule);
+  PyObject* module = PyModule_Create(&engineModule);
+  if (module && !PythonBuffer::registerType(module)) {
+    Py_DECREF(module);
+    return 0;
+  }
+  return module;
+}
+
+// memory accounting: hooks over python's MEM and OBJ allocator domains count every block python's
+// objects and buffers allocate. python does not pass the size of a block it frees, so each block
+// carries its size in a header in front of it. the hooks are opt in (setMemoryCounting) since the
+// header costs 16 bytes a block. they are installed before the interpreter starts, so they never
+// see a block without one, and stay for the life of the process. the raw domain (memory python
+// allocates before it starts and without the GIL) is not counted
+namespace {
+  // keeps the blocks after it aligned the way python's allocator aligns them
+  const size_t BLOCK_HEADER_SIZE = 16;
+
+  // only touched with the GIL held, which the MEM and OBJ domains require
+  MemoryStats pythonMemory;
+  PyMemAllocatorEx originalMemAllocator;
+  PyMemAllocatorEx originalObjectAllocator;
+  // setMemoryCounting - read when an interpreter starts
+  bool countingRequested = false;
+  bool countingMemory = false;
+
+  void* withHeader(void* block, size_t size) {
+    if (block == nullptr) {
+      return nullptr;
+    }
+    *static_cast<size_t*>(block) = size;
+    return static_cast<char*>(block) + BLOCK_HEADER_SIZE;
+  }
+
+  void* headerOf(void* block) {
+    return static_cast<char*>(block) - BLOCK_HEADER_SIZE;
+  }
+
+  // the context of the hooks is the domain's original allocator
+  void* countedMalloc(void* context, size_t size) {
+    PyMemAllocatorEx* original = static_cast<PyMemAllocatorEx*>(context);
+    void* block = withHeader(original->malloc(original->ctx, size + BLOCK_HEADER_SIZE), size);
+    if (block != nullptr) {
+      pythonMemory.allocated(size);
+    }
+    return block;
+  }
+
+  void* countedCalloc(void* context, size_t count, size_t elementSize) {
+    PyMemAllocatorEx* original = static_cast<PyMemAllocatorEx*>(context);
+    if (elementSize != 0 && count > (static_cast<size_t>(-1) - BLOCK_HEADER_SIZE) / elementSize) {
+      return nullptr;
+    }
+    size_t size = count * elementSize;
+    void* block = withHeader(original->calloc(original->ctx, 1, size + BLOCK_HEADER_SIZE), size);
+    if (block != nullptr) {
+      pythonMemory.allocated(size);
+    }
+    return block;
+  }
+
+  void* countedRealloc(void* context, void* block, size_t size) {
+    if (block == nullptr) {
+      return countedMalloc(context, size);
+    }
+
+    PyMemAllocatorEx* original = static_cast<PyMemAllocatorEx*>(context);
+    size_t oldSize = *static_cast<size_t*>(headerOf(block));
+    void* resized = withHeader(original->realloc(original->ctx, headerOf(block), size + BLOCK_HEADER_SIZE), size);
+    if (resized != nullptr) {
+      pythonMemory.resized(oldSize, size);
+    }
+    return resized;
+  }
+
+  void countedFree(void* context, void* block) {
+    if (block == nullptr) {
+      return;
+    }
+
+    PyMemAllocatorEx* original = static_cast<PyMemAllocatorEx*>(context);
+    pythonMemory.freed(*static_cast<size_t*>(headerOf(block)));
+    original->free(original->ctx, headerOf(block));
+  }
+
+  void startCountingMemory() {
+    if (countingMemory) {
+      return;
+    }
+    countingMemory = true;
+
+    PyMem_GetAllocator(PYMEM_DOMAIN_MEM, &originalMemAllocator);
+    PyMemAllocatorEx memAllocator = { &originalMemAllocator, countedMalloc, countedCalloc, countedRealloc, countedFree };
+    PyMem_SetAllocator(PYMEM_DOMAIN_MEM, &memAllocator);
+
+    PyMem_GetAllocator(PYMEM_DOMAIN_OBJ, &originalObjectAllocator);
+    PyMemAllocatorEx objectAllocator = { &originalObjectAllocator, countedMalloc, countedCalloc, countedRealloc, countedFree };
+    PyMem_SetAllocator(PYMEM_DOMAIN_OBJ, &objectAllocator);
+  }
+}
+
+// calls a script function without building an argument tuple
+static PyObject* callFunction(PyObject* func, PyObject* const* args, Py_ssize_t nargs) {
+  #if PY_VERSION_HEX >= 0x03090000
+  return PyObject_Vectorcall(func, args, static_cast<size_t>(nargs), nullptr);
+  #else
+  return _PyObject_FastCall(func, const_cast<PyObject**>(args), nargs);
+  #endif
+}
+
+// HOOK_BUDGET_MS: the watchdog thread interrupts an overrunning hook the way ctrl-c would - python
+// raises KeyboardInterrupt in it at the next bytecode. the signal goes to the main thread itself:
+// python only looks at a signal at once when its c handler runs there
+void PythonScriptingEngine::interruptHook(void* data) {
+  pthread_kill(static_cast<PythonScriptingEngine*>(data)->mainThread, SIGINT);
 }
 
 PythonScriptingEngine::PythonScriptingEngine(std::string const& programName)
   : program(nullptr),
     scriptNameObject(nullptr),
-    scriptModuleObject(nullptr) {
+    scriptModuleObject(nullptr),
+    createFunction(nullptr),
+    destroyFunction(nullptr),
+    updateFunction(nullptr),
+    renderFunction(nullptr),
+    gcModule(nullptr),
+    idleGc(false),
+    gcAutomatic(false),
+    mainThread(pthread_self()) {
+  for (int generation = 0; generation < 3; generation++) {
+    gcThresholds[generation] = 0;
+    gcMilliseconds[generation] = 0;
+  }
+
   program = Py_DecodeLocale(programName.c_str(), 0);
 
   if (!program) {
@@ -50,15 +188,29 @@ PythonScriptingEngine::PythonScriptingEngine(std::string const& programName)
 
   Py_SetProgramName(program);
   PyImport_AppendInittab("engine", &initializeEngineModule);
+  if (countingRequested) {
+    startCountingMemory();
+  }
   Py_Initialize();
 
   PyObject* sysPath = PySys_GetObject("path");
   PyObject* curPath = PyUnicode_FromString(".");
   PyList_Append(sysPath, curPath);
   Py_XDECREF(curPath);
+
+  profiler = new PythonProfiler();
 }
 
 PythonScriptingEngine::~PythonScriptingEngine() {
+  watchdog.stop();
+
+  // a profile still running is written out
+  setProfiling(false);
+  delete profiler;
+  profiler = nullptr;
+
+  releaseHooks();
+  Py_XDECREF(gcModule);
   Py_XDECREF(scriptModuleObject);
   Py_XDECREF(scriptNameObject);
 
@@ -72,12 +224,51 @@ PythonScriptingEngine::~PythonScriptingEngine() {
   }
 }
 
+void PythonScriptingEngine::setMemoryCounting(bool enabled) {
+  countingRequested = enabled;
+}
+
+bool PythonScriptingEngine::getMemoryStats(MemoryStats& stats) {
+  stats = pythonMemory;
+  return countingMemory;
+}
+
+void PythonScriptingEngine::startWatchdog() {
+  watchdog.start(interruptHook, this);
+}
+
+void PythonScriptingEngine::callHook(PyObject* func, PyObject* const* args, Py_ssize_t nargs) {
+  if (!func) {
+    return;
+  }
+
+  HookCall call(this);
+  PyObject* result = callFunction(func, args, nargs);
+  bool overran = call.finish();
+
+  if (!result && PyErr_Occurred()) {
+    if (overran && PyErr_ExceptionMatches(PyExc_KeyboardInterrupt)) {
+      std::cerr << "Python hook exceeded its " << watchdog.getBudget() << " ms budget" << std::endl;
+    }
+    PyErr_Print();
+  }
+  Py_XDECREF(result);
+
+  // an interrupt that came after the hook was done with would hit the next one
+  if (overran && PyErr_CheckSignals() < 0) {
+    PyErr_Clear();
+  }
+}
+
 void PythonScriptingEngine::load(std::string const& filename) {
   // script name must not have .py extension
   std::string scriptName = filename.substr(0, filename.rfind('.'));
 
   scriptNameObject = PyUnicode_DecodeFSDefault(scriptName.c_str());
-  scriptModuleObject = PyImport_Import(scriptNameObject);
+  {
+    ScriptProfiler::Scope profiling(profiler);
+    scriptModuleObject = PyImport_Import(scriptNameObject);
+  }
 
   if (!scriptModuleObject) {
     PyErr_Print();
@@ -85,10 +276,146 @@ void PythonScriptingEngine::load(std::string const& filename) {
     msg << "Unable to load " << filename << std::endl;
     throw std::runtime_error(msg.str());
   }
+
+  resolveHooks();
 }
 
 void PythonScriptingEngine::init(Configuration& config) {
   SharedContext::instance->config->copy(config);
+
+  // engine.init normally runs while the module is being imported, before load() resolves the hooks,
+  // but if the script calls it again later the hook names may have changed
+  if (scriptModuleObject) {
+    resolveHooks();
+  }
+}
+
+void PythonScriptingEngine::resolveHooks() {
+  SharedContext& context = *SharedContext::instance;
+
+  releaseHooks();
+
+  auto resolve = [&](std::string const& name) -> PyObject* {
+    PyObject* func = PyObject_GetAttrString(scriptModuleObject, name.c_str());
+    if (!func) {
+      if (PyErr_Occurred()) {
+        PyErr_Print();
+      }
+      return nullptr;
+    }
+    if (!PyCallable_Check(func)) {
+      Py_DECREF(func);
+      return nullptr;
+    }
+    return func;
+  };
+
+  createFunction = resolve(context.config->userCreateFunctionName);
+  destroyFunction = resolve(context.config->userDestroyFunctionName);
+  updateFunction = resolve(context.config->userUpdateFunctionName);
+  renderFunction = resolve(context.config->userRenderFunctionName);
+}
+
+void PythonScriptingEngine::releaseHooks() {
+  Py_CLEAR(createFunction);
+  Py_CLEAR(destroyFunction);
+  Py_CLEAR(updateFunction);
+  Py_CLEAR(renderFunction);
+}
+
+void PythonScriptingEngine::setIdleGc(bool enabled) {
+  if (gcModule == nullptr) {
+    gcModule = PyImport_ImportModule("gc");
+    if (gcModule == nullptr) {
+      PyErr_Print();
+      return;
+    }
+  }
+
+  PyObject* thresholds = PyObject_CallMethod(gcModule, "get_threshold", nullptr);
+  if (thresholds == nullptr || !PyArg_ParseTuple(thresholds, "iii", &gcThresholds[0], &gcThresholds[1], &gcThresholds[2])) {
+    Py_XDECREF(thresholds);
+    PyErr_Print();
+    return;
+  }
+  Py_DECREF(thresholds);
+
+  if (callGc(enabled ? "disable" : "enable")) {
+    idleGc = enabled;
+    gcAutomatic = false;
+  }
+}
+
+void PythonScriptingEngine::collectGarbage(std::chrono::steady_clock::time_point deadline) {
+  int counts[3];
+  if (!idleGc || !getGcCounts(counts)) {
+    return;
+  }
+
+  // the oldest generation that is due - collecting it collects the younger ones too
+  int generation = -1;
+  if (counts[0] >= gcThresholds[0] / 2) {
+    generation = 0;
+  }
+  for (int older = 1; older < 3; older++) {
+    if (counts[older] >= gcThresholds[older]) {
+      generation = older;
+    }
+  }
+
+  // python collects a generation in one go - it waits for an idle time long enough for it
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  while (generation >= 0 && counts[generation] < IDLE_GC_LIMIT_FACTOR * gcThresholds[generation]
+      && start + std::chrono::duration<double, std::milli>(gcMilliseconds[generation]) > deadline) {
+    generation--;
+  }
+
+  if (generation >= 0) {
+    PyObject* result = PyObject_CallMethod(gcModule, "collect", "i", generation);
+    if (result == nullptr) {
+      PyErr_Print();
+    }
+    Py_XDECREF(result);
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    gcMilliseconds[generation] = elapsed.count();
+  }
+
+  if (gcAutomatic && callGc("disable")) {
+    gcAutomatic = false;
+  }
+}
+
+void PythonScriptingEngine::checkHeapLimit() {
+  int counts[3];
+  if (!idleGc || gcAutomatic || !getGcCounts(counts)) {
+    return;
+  }
+
+  if (counts[0] > IDLE_GC_LIMIT_FACTOR * gcThresholds[0] && callGc("enable")) {
+    gcAutomatic = true;
+  }
+}
+
+bool PythonScriptingEngine::callGc(char const* function) {
+  PyObject* result = PyObject_CallMethod(gcModule, function, nullptr);
+  if (result == nullptr) {
+    PyErr_Print();
+    return false;
+  }
+  Py_DECREF(result);
+  return true;
+}
+
+bool PythonScriptingEngine::getGcCounts(int counts[3]) {
+  PyObject* result = PyObject_CallMethod(gcModule, "get_count", nullptr);
+  if (result == nullptr || !PyArg_ParseTuple(result, "iii", &counts[0], &counts[1], &counts[2])) {
+    Py_XDECREF(result);
+    PyErr_Print();
+    return false;
+  }
+  Py_DECREF(result);
+  return true;
 }
 
 int PythonScriptingEngine::getScreenWidth() {
@@ -108,77 +435,33 @@ void PythonScriptingEngine::drawCircle(int x, int y, int radius) {
 }
 
 void PythonScriptingEngine::runCreate() {
-  SharedContext& context = *SharedContext::instance;
-
-  PyObject* func = PyObject_GetAttrString(scriptModuleObject, context.config->userCreateFunctionName.c_str());
-  if (func && PyCallable_Check(func)) {
-    if (!PyObject_CallObject(func, 0)) {
-      if (PyErr_Occurred()) {
-        PyErr_Print();
-      }
-    }
-  } else {
-    if (PyErr_Occurred()) {
-      PyErr_Print();
-    }
-  }
-  Py_XDECREF(func);
+  TRACE_ZONE("python.create");
+  callHook(createFunction, nullptr, 0);
 }
 
 void PythonScriptingEngine::runDestroy() {
-  SharedContext& context = *SharedContext::instance;
-
-  PyObject* func = PyObject_GetAttrString(scriptModuleObject, context.config->userDestroyFunctionName.c_str());
-  if (func && PyCallable_Check(func)) {
-    if (!PyObject_CallObject(func, 0)) {
-      if (PyErr_Occurred()) {
-        PyErr_Print();
-      }
-    }
-  } else {
-    if (PyErr_Occurred()) {
-      PyErr_Print();
-    }
-  }
-  Py_XDECREF(func);
+  TRACE_ZONE("python.destroy");
+  callHook(destroyFunction, nullptr, 0);
 }
 
 void PythonScriptingEngine::runUpdate(float deltaTime) {
-  SharedContext& context = *SharedContext::instance;
+  TRACE_ZONE("python.update");
 
-  PyObject* func = PyObject_GetAttrString(scriptModuleObject, context.config->userUpdateFunctionName.c_str());
-  if (func && PyCallable_Check(func)) {
-    PyObject* args = Py_BuildValue("(f)", deltaTime);
-    if (!PyObject_CallObject(func, args)) {
-      if (PyErr_Occurred()) {
-        PyErr_Print();
-      }
-    }
-    Py_XDECREF(args);
-  } else {
-    if (PyErr_Occurred()) {
-      PyErr_Print();
-    }
+  if (!updateFunction) {
+    return;
   }
-  Py_XDECREF(func);
+
+  checkHeapLimit();
+
+  PyObject* args[1] = { PyFloat_FromDouble(deltaTime) };
+  callHook(updateFunction, args, 1);
+  Py_DECREF(args[0]);
 }
 
 void PythonScriptingEngine::runRender() {
-  SharedContext& context = *SharedContext::instance;
-
-  PyObject* func = PyObject_GetAttrString(scriptModuleObject, context.config->userRenderFunctionName.c_str());
-  if (func && PyCallable_Check(func)) {
-    if (!PyObject_CallObject(func, 0)) {
-      if (PyErr_Occurred()) {
-        PyErr_Print();
-      }
-    }
-  } else {
-    if (PyErr_Occurred()) {
-      PyErr_Print();
-    }
-  }
-  Py_XDECREF(func);
+  TRACE_ZONE("python.render");
+  checkHeapLimit();
+  callHook(renderFunction, nullptr, 0);
 }
 
 void parseConfigurationTable(PyObject* params, Configuration& config) {
@@ -195,6 +478,7 @@ void parseConfigurationTable(PyObject* params, Configuration& config) {
     return false;
   };
 
+  // PyDict_GetItemString returns a borrowed reference
   auto readField = [&](std::string const& keyName) {
     return PyDict_GetItemString(params, keyName.c_str());
   };
@@ -202,8 +486,12 @@ void parseConfigurationTable(PyObject* params, Configuration& config) {
   auto getInt = [&](int* dst, std::string const& name) {
     if (hasKey(name)) {
       PyObject* result = readField(name);
-      *dst = static_cast<int>(PyLong_AsLong(result));
-      Py_XDECREF(result);
+      // sizes like 1920 / 2 are floats, which PyLong_AsLong no longer truncates since python 3.10
+      if (PyFloat_Check(result)) {
+        *dst = static_cast<int>(PyFloat_AsDouble(result));
+      } else {
+        *dst = static_cast<int>(PyLong_AsLong(result));
+      }
     }
   };
 
@@ -215,7 +503,6 @@ void parseConfigurationTable(PyObject* params, Configuration& config) {
       } else {
         *dst = false;
       }
-      Py_XDECREF(result);
     }
   };
 
@@ -225,7 +512,6 @@ void parseConfigurationTable(PyObject* params, Configuration& config) {
       PyObject* ascii = PyUnicode_AsASCIIString(result);
       dst.assign(std::string(PyBytes_AsString(ascii)));
       Py_XDECREF(ascii);
-      Py_XDECREF(result);
     }
   };
 
@@ -233,6 +519,9 @@ void parseConfigurationTable(PyObject* params, Configuration& config) {
   getInt(&config.screenHeight, "SCREEN_HEIGHT");
   getBoolean(&config.useFullscreen, "USE_FULLSCREEN");
   getBoolean(&config.debugMode, "DEBUG");
+  getBoolean(&config.idleGc, "IDLE_GC");
+  getInt(&config.targetFps, "TARGET_FPS");
+  getInt(&config.hookBudgetMilliseconds, "HOOK_BUDGET_MS");
   getString(config.windowTitle, "WINDOW_TITLE");
   getString(config.userCreateFunctionName, "create");
   getString(config.userDestroyFunctionName, "destroy");
@@ -241,31 +530,47 @@ void parseConfigurationTable(PyObject* params, Configuration& config) {
 }
 
 namespace engine {
-  PyObject* apiInit(PyObject* self, PyObject* params) {
-    PyObject* cfgDict;
-    if (!PyArg_ParseTuple(params, "O", &cfgDict)) {
+  PyObject* apiInit(PyObject* self, PyObject* const* args, Py_ssize_t nargs) {
+    if (!binding::python::checkArgumentCount("init", nargs, 1)) {
       return 0;
     }
     Configuration config;
-    parseConfigurationTable(cfgDict, config);
+    parseConfigurationTable(args[0], config);
     SharedContext::instance->scripting->init(config);
-    return self;
-  }
-
-  PyObject* apiGetScreenWidth(PyObject* self, PyObject* params) {
-    return PyLong_FromLong(SharedContext::instance->scripting->getScreenWidth());
+    Py_RETURN_NONE;
   }
 
-  PyObject* apiGetScreenHeight(PyObject* self, PyObject* params) {
-    return PyLong_FromLong(SharedContext::instance->scripting->getScreenHeight());
-  }
+  // returns {"live", "peak", "allocations", "frees", "sizeClasses": [allocations of each size class]} -
+  // see MemoryStats.hpp. None when memory is not counted (setMemoryCounting)
+  PyObject* apiMemStats(PyObject* self, PyObject* const* args, Py_ssize_t nargs) {
+    if (!binding::python::checkArgumentCount("memStats", nargs, 0)) {
+      return 0;
+    }
+    if (!countingMemory) {
+      Py_RETURN_NONE;
+    }
+    // a copy - building the result allocates
+    MemoryStats stats = pythonMemory;
 
-  PyObject* apiDrawCircle(PyObject* self, PyObject* params) {
-    int x, y, radius;
-    if (!PyArg_ParseTuple(params, "iii", &x, &y, &radius)) {
+    PyObject* sizeClasses = PyList_New(MemoryStats::SIZE_CLASSES);
+    if (!sizeClasses) {
       return 0;
     }
-    SharedContext::instance->scripting->drawCircle(x, y, radius);
-    return self;
+    for (int i = 0; i < MemoryStats::SIZE_CLASSES; i++) {
+      PyObject* count = PyLong_FromUnsignedLongLong(stats.sizeClassAllocations[i]);
+      if (!count) {
+        Py_DECREF(sizeClasses);
+        return 0;
+      }
+      PyList_SET_ITEM(sizeClasses, i, count);
+    }
+
+    // N hands the list over to the dict
+    return Py_BuildValue("{s:K,s:K,s:K,s:K,s:N}",
+      "live", static_cast<unsigned long long>(stats.liveBytes),
+      "peak", static_cast<unsigned long long>(stats.peakBytes),
+      "allocations", stats.allocations,
+      "frees", stats.frees,
+      "sizeClasses", sizeClasses);
   }
 }
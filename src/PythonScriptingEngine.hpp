@@ -2,6 +2,7 @@
 #define PYTHONSCRIPTINGENGINE_H
 
 #include <Python.h>
+#include <pthread.h>
 
 #include "ScriptingEngine.hpp"
 
@@ -19,12 +20,52 @@ class PythonScriptingEngine : public ScriptingEngine {
     virtual void runDestroy();
     virtual void runUpdate(float deltaTime);
     virtual void runRender();
+    virtual void setIdleGc(bool enabled);
+    virtual void collectGarbage(std::chrono::steady_clock::time_point deadline);
+    // counted in python's MEM and OBJ allocator domains - see PythonScriptingEngine.cpp. off by default,
+    // takes effect for the interpreters started after it
+    static void setMemoryCounting(bool enabled);
+    // returns false unless memory counting was on when the interpreter started
+    virtual bool getMemoryStats(MemoryStats& stats);
 
   protected:
+    virtual void startWatchdog();
+    // HOOK_BUDGET_MS - see PythonScriptingEngine.cpp
+    static void interruptHook(void* data);
+
+    // calls a lifecycle hook and prints its errors
+    void callHook(PyObject* func, PyObject* const* args, Py_ssize_t nargs);
+
+    // looks up the lifecycle hooks on the script module and keeps strong references to them
+    void resolveHooks();
+    void releaseHooks();
+
+    // IDLE_GC helpers over the gc module - they print python errors and return false on them
+    bool callGc(char const* function);
+    bool getGcCounts(int counts[3]);
+    // turns python's collector back on when the youngest generation outgrew the safety limit
+    void checkHeapLimit();
+
     wchar_t* program;
     PyObject* scriptNameObject;
     PyObject* scriptModuleObject;
+
+    // cached lifecycle hook callables - refreshed only when the module (re)loads or the hook names change
+    PyObject* createFunction;
+    PyObject* destroyFunction;
+    PyObject* updateFunction;
+    PyObject* renderFunction;
+
+    PyObject* gcModule;
+    bool idleGc;
+    // python's collector was turned back on by checkHeapLimit
+    bool gcAutomatic;
+    int gcThresholds[3];
+    // how long the last collection of each generation took
+    double gcMilliseconds[3];
+
+    // the thread the hooks run on - the watchdog interrupts it
+    pthread_t mainThread;
 };
 
 #endif // !PYTHONSCRIPTINGENGINE_H
-
@@ -0,0 +1,99 @@
+#ifndef RUBYBINDING_H
+#define RUBYBINDING_H
+
+#include <ruby.h>
+
+#include "Binding.hpp"
+#include "RubyBuffer.hpp"
+
+// generates ruby module function glue for a native function - see Binding.hpp
+// the ruby arity is taken from the C++ signature so it can never disagree with the function
+
+namespace binding {
+  namespace ruby {
+    template <typename T> struct Arg;
+
+    template <> struct Arg<int> {
+      static int get(VALUE value) {
+        return NUM2INT(value);
+      }
+    };
+
+    template <> struct Arg<float> {
+      static float get(VALUE value) {
+        return static_cast<float>(NUM2DBL(value));
+      }
+    };
+
+    template <> struct Arg<double> {
+      static double get(VALUE value) {
+        return NUM2DBL(value);
+      }
+    };
+
+    template <> struct Arg<bool> {
+      static bool get(VALUE value) {
+        return RTEST(value);
+      }
+    };
+
+    // the string object is held by the caller's argument list for the duration of the call
+    template <> struct Arg<const char*> {
+      static const char* get(VALUE value) {
+        Check_Type(value, T_STRING);
+        return StringValueCStr(value);
+      }
+    };
+
+    template <> struct Arg<NumericBuffer*> {
+      static NumericBuffer* get(VALUE value) {
+        return RubyBuffer::check(value);
+      }
+    };
+
+    inline VALUE box(int value) { return INT2NUM(value); }
+    inline VALUE box(float value) { return DBL2NUM(value); }
+    inline VALUE box(double value) { return DBL2NUM(value); }
+    inline VALUE box(bool value) { return value ? Qtrue : Qfalse; }
+    inline VALUE box(const char* value) { return rb_str_new_cstr(value); }
+
+    template <typename R> struct Invoke {
+      template <typename Fn, typename... Values>
+      static VALUE call(Fn fn, Values... values) {
+        return box(fn(values...));
+      }
+    };
+
+    template <> struct Invoke<void> {
+      template <typename Fn, typename... Values>
+      static VALUE call(Fn fn, Values... values) {
+        fn(values...);
+        return Qnil;
+      }
+    };
+
+    template <typename Fn, Fn fn> struct Function;
+
+    template <typename R, typename... Args, R (*fn)(Args...)>
+    struct Function<R (*)(Args...), fn> {
+      typedef Signature<R (*)(Args...)> Traits;
+
+      static constexpr int arity = Traits::arity;
+
+      static VALUE call(VALUE self, typename Repeat<Args, VALUE>::type... values) {
+        return Invoke<R>::call(fn, Arg<Args>::get(values)...);
+      }
+    };
+  }
+}
+
+// defines a native function on a ruby module
+#define RUBY_BINDING(module, name, fn) \
+  rb_define_module_function( \
+    module, \
+    name, \
+    RUBY_METHOD_FUNC((binding::ruby::Function<decltype(&fn), &fn>::call)), \
+    binding::ruby::Function<decltype(&fn), &fn>::arity \
+  )
+
+#endif // !RUBYBINDING_H
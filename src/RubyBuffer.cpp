@@ -0,0 +1,148 @@
+#include <cstring>
+#include <exception>
+
+#include "RubyBuffer.hpp"
+
+static VALUE bufferClass = Qnil;
+
+static void bufferFree(void* data) {
+  delete static_cast<NumericBufferRef*>(data);
+}
+
+static size_t bufferSize(const void* data) {
+  NumericBufferRef const* ref = static_cast<NumericBufferRef const*>(data);
+  return sizeof(NumericBufferRef) + (*ref)->byteSize();
+}
+
+static const rb_data_type_t bufferDataType = {
+  "Engine::Buffer",
+  { nullptr, bufferFree, bufferSize, { nullptr, nullptr } },
+  nullptr,
+  nullptr,
+  RUBY_TYPED_FREE_IMMEDIATELY
+};
+
+static size_t checkElement(NumericBuffer* buffer, VALUE index) {
+  long element = NUM2LONG(index);
+  if (element < 0 || static_cast<size_t>(element) >= buffer->size()) {
+    rb_raise(rb_eIndexError, "buffer index %ld out of range (size %ld)", element, static_cast<long>(buffer->size()));
+  }
+  return static_cast<size_t>(element);
+}
+
+static VALUE bufferGet(VALUE self, VALUE index) {
+  NumericBuffer* buffer = RubyBuffer::check(self);
+  size_t element = checkElement(buffer, index);
+  if (buffer->getType() == NumericBuffer::INT32) {
+    return INT2NUM(buffer->int32()[element]);
+  }
+  return DBL2NUM(buffer->get(element));
+}
+
+static VALUE bufferSet(VALUE self, VALUE index, VALUE value) {
+  NumericBuffer* buffer = RubyBuffer::check(self);
+  buffer->set(checkElement(buffer, index), NUM2DBL(value));
+  return value;
+}
+
+static VALUE bufferLength(VALUE self) {
+  return LONG2NUM(static_cast<long>(RubyBuffer::check(self)->size()));
+}
+
+static VALUE bufferType(VALUE self) {
+  return rb_str_new_cstr(NumericBuffer::typeName(RubyBuffer::check(self)->getType()));
+}
+
+// the Array#pack / String#unpack directive matching the element layout
+static VALUE bufferFormat(VALUE self) {
+  switch (RubyBuffer::check(self)->getType()) {
+    case NumericBuffer::FLOAT32: return rb_str_new_cstr("f*");
+    case NumericBuffer::FLOAT64: return rb_str_new_cstr("d*");
+    case NumericBuffer::INT32: return rb_str_new_cstr("l*");
+  }
+  return Qnil;
+}
+
+static VALUE bufferFill(VALUE self, VALUE value) {
+  RubyBuffer::check(self)->fill(NUM2DBL(value));
+  return self;
+}
+
+static VALUE bufferToArray(VALUE self) {
+  NumericBuffer* buffer = RubyBuffer::check(self);
+  VALUE result = rb_ary_new_capa(static_cast<long>(buffer->size()));
+  for (size_t i = 0; i < buffer->size(); i++) {
+    rb_ary_push(result, bufferGet(self, LONG2NUM(static_cast<long>(i))));
+  }
+  return result;
+}
+
+static VALUE bufferPack(VALUE self) {
+  NumericBuffer* buffer = RubyBuffer::check(self);
+  return rb_str_new(static_cast<const char*>(buffer->data()), static_cast<long>(buffer->byteSize()));
+}
+
+static VALUE bufferUnpack(VALUE self, VALUE packed) {
+  NumericBuffer* buffer = RubyBuffer::check(self);
+  StringValue(packed);
+
+  size_t bytes = static_cast<size_t>(RSTRING_LEN(packed));
+  if (bytes > buffer->byteSize()) {
+    rb_raise(rb_eArgError, "packed data is %ld bytes but the buffer holds %ld", static_cast<long>(bytes), static_cast<long>(buffer->byteSize()));
+  }
+
+  std::memcpy(buffer->data(), RSTRING_PTR(packed), bytes);
+  return self;
+}
+
+void RubyBuffer::registerType(VALUE engineModule) {
+  bufferClass = rb_define_class_under(engineModule, "Buffer", rb_cObject);
+  rb_global_variable(&bufferClass);
+  rb_undef_alloc_func(bufferClass);
+
+  rb_define_method(bufferClass, "[]", RUBY_METHOD_FUNC(bufferGet), 1);
+  rb_define_method(bufferClass, "[]=", RUBY_METHOD_FUNC(bufferSet), 2);
+  rb_define_method(bufferClass, "size", RUBY_METHOD_FUNC(bufferLength), 0);
+  rb_define_method(bufferClass, "length", RUBY_METHOD_FUNC(bufferLength), 0);
+  rb_define_method(bufferClass, "type", RUBY_METHOD_FUNC(bufferType), 0);
+  rb_define_method(bufferClass, "format", RUBY_METHOD_FUNC(bufferFormat), 0);
+  rb_define_method(bufferClass, "fill", RUBY_METHOD_FUNC(bufferFill), 1);
+  rb_define_method(bufferClass, "to_a", RUBY_METHOD_FUNC(bufferToArray), 0);
+  rb_define_method(bufferClass, "pack", RUBY_METHOD_FUNC(bufferPack), 0);
+  rb_define_method(bufferClass, "unpack", RUBY_METHOD_FUNC(bufferUnpack), 1);
+}
+
+VALUE RubyBuffer::wrap(NumericBufferRef const& buffer) {
+  return TypedData_Wrap_Struct(bufferClass, &bufferDataType, new NumericBufferRef(buffer));
+}
+
+NumericBuffer* RubyBuffer::check(VALUE value) {
+  return static_cast<NumericBufferRef*>(rb_check_typeddata(value, &bufferDataType))->get();
+}
+
+VALUE RubyBuffer::apiCreateBuffer(VALUE self, VALUE typeName, VALUE count) {
+  const char* name = StringValueCStr(typeName);
+  long size = NUM2LONG(count);
+
+  NumericBuffer::Type type;
+  if (!NumericBuffer::parseType(name, &type)) {
+    rb_raise(rb_eArgError, "unknown buffer type %s (expected float32, float64 or int32)", name);
+  }
+
+  if (size < 0) {
+    rb_raise(rb_eArgError, "buffer size must not be negative");
+  }
+
+  // rb_raise jumps past destructors, so it is only called once the handler is done and the
+  // reference is empty
+  NumericBufferRef buffer;
+  try {
+    buffer = std::make_shared<NumericBuffer>(type, static_cast<size_t>(size));
+  } catch (std::exception const&) {
+  }
+  if (!buffer) {
+    rb_raise(rb_eNoMemError, "unable to allocate a buffer of %ld elements", size);
+  }
+
+  return wrap(buffer);
+}
@@ -0,0 +1,27 @@
+#ifndef RUBYBUFFER_H
+#define RUBYBUFFER_H
+
+#include <ruby.h>
+
+#include "NumericBuffer.hpp"
+
+// exposes NumericBuffer to ruby as Engine::Buffer
+// buf[i], buf[i] = v, buf.size, buf.type, buf.to_a, buf.fill(v)
+// buf.pack returns the raw elements as a binary String that matches buf.to_a.pack(buf.format)
+// and buf.unpack(string) bulk-writes such a string back into the buffer
+class RubyBuffer {
+  public:
+    // defines Engine::Buffer under the engine module
+    static void registerType(VALUE engineModule);
+
+    // wraps a reference to the buffer in a new Engine::Buffer
+    static VALUE wrap(NumericBufferRef const& buffer);
+
+    // returns the buffer of an Engine::Buffer or raises a TypeError
+    static NumericBuffer* check(VALUE value);
+
+    // Engine::createBuffer(type, count)
+    static VALUE apiCreateBuffer(VALUE self, VALUE typeName, VALUE count);
+};
+
+#endif // !RUBYBUFFER_H
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include "RubyProfiler.hpp"
+#include "SamplingTimer.hpp"
+
+namespace {
+  // deepest stack a sample records
+  const int MAX_FRAMES = 256;
+
+  // postponed jobs may run after the profiler stopped - they find no active profiler then
+  RubyProfiler* activeProfiler = nullptr;
+
+  std::string describeFrame(VALUE frame) {
+    VALUE label = rb_profile_frame_full_label(frame);
+    VALUE path = rb_profile_frame_path(frame);
+    VALUE line = rb_profile_frame_first_lineno(frame);
+
+    std::stringstream description;
+    description << (RB_TYPE_P(label, T_STRING) ? StringValueCStr(label) : "?")
+      << " (" << (RB_TYPE_P(path, T_STRING) ? StringValueCStr(path) : "?")
+      << ":" << (FIXNUM_P(line) ? FIX2INT(line) : 0) << ")";
+
+    return description.str();
+  }
+}
+
+RubyProfiler::RubyProfiler() {
+}
+
+RubyProfiler::~RubyProfiler() {
+  stop();
+}
+
+bool RubyProfiler::startSampling(int intervalMicroseconds) {
+  if (activeProfiler != nullptr) {
+    return false;
+  }
+
+  activeProfiler = this;
+  if (!samplingTimer::start(intervalMicroseconds, tick, this)) {
+    activeProfiler = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void RubyProfiler::stopSampling() {
+  samplingTimer::stop();
+  activeProfiler = nullptr;
+}
+
+bool RubyProfiler::startTracing() {
+  if (activeProfiler != nullptr) {
+    return false;
+  }
+
+  activeProfiler = this;
+  rb_add_event_hook(traceEvent, RUBY_EVENT_CALL | RUBY_EVENT_RETURN | RUBY_EVENT_B_CALL | RUBY_EVENT_B_RETURN, Qnil);
+  return true;
+}
+
+void RubyProfiler::stopTracing() {
+  rb_remove_event_hook(traceEvent);
+  activeProfiler = nullptr;
+}
+
+// signal context
+void RubyProfiler::requestSample() {
+  rb_postponed_job_register_one(0, sampleJob, nullptr);
+}
+
+// signal context
+void RubyProfiler::tick(void* data) {
+  static_cast<RubyProfiler*>(data)->ScriptProfiler::tick();
+}
+
+void RubyProfiler::sampleJob(void* data) {
+  if (activeProfiler != nullptr) {
+    activeProfiler->sample();
+  }
+}
+
+void RubyProfiler::sample() {
+  unsigned ticks = takeTicks();
+  if (ticks == 0) {
+    return;
+  }
+
+  VALUE frames[MAX_FRAMES];
+  int lines[MAX_FRAMES];
+  int count = rb_profile_frames(0, MAX_FRAMES, frames, lines);
+
+  // rb_profile_frames lists the innermost frame first
+  std::vector<std::string> stack;
+  for (int i = count - 1; i >= 0; i--) {
+    stack.push_back(describeFrame(frames[i]));
+  }
+
+  profile.addSample(stack, ticks);
+}
+
+void RubyProfiler::traceEvent(rb_event_flag_t event, VALUE data, VALUE self, ID method, VALUE klass) {
+  if (activeProfiler == nullptr) {
+    return;
+  }
+
+  if (event == RUBY_EVENT_RETURN || event == RUBY_EVENT_B_RETURN) {
+    activeProfiler->profile.endCall();
+    return;
+  }
+
+  // the frame of the method or block being called is already on the stack
+  VALUE frame;
+  int line;
+  if (rb_profile_frames(0, 1, &frame, &line) == 1) {
+    activeProfiler->profile.beginCall(describeFrame(frame));
+  } else {
+    activeProfiler->profile.beginCall("?");
+  }
+}
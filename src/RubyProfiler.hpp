@@ -0,0 +1,39 @@
+#ifndef RUBYPROFILER_H
+#define RUBYPROFILER_H
+
+#include <ruby.h>
+#include <ruby/debug.h>
+
+#include <string>
+
+#include "ScriptProfiler.hpp"
+
+// profiler for the ruby vm - see ScriptProfiler.hpp
+//
+// sampling: every SIGPROF tick (see SamplingTimer.hpp) the signal handler registers a postponed job,
+// which is safe to do from a signal. the vm runs the job at its next interrupt check and the job
+// reads the frames there with rb_profile_frames. a tick inside a native function is recorded when it
+// returns to ruby, in the script method that called it.
+//
+// tracing: call and return event hooks for methods and blocks - native methods are left out
+class RubyProfiler : public ScriptProfiler {
+  public:
+    RubyProfiler();
+    virtual ~RubyProfiler();
+
+  protected:
+    virtual bool startSampling(int intervalMicroseconds);
+    virtual void stopSampling();
+    virtual bool startTracing();
+    virtual void stopTracing();
+    virtual void requestSample();
+
+  private:
+    static void tick(void* data);
+    static void sampleJob(void* data);
+    static void traceEvent(rb_event_flag_t event, VALUE data, VALUE self, ID method, VALUE klass);
+
+    void sample();
+};
+
+#endif // !RUBYPROFILER_H
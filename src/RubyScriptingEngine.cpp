@@ -7,44 +7,48 @@
 #include <algorithm>
 
 #include "RubyScriptingEngine.hpp"
+#include "RubyBinding.hpp"
+#include "RubyBuffer.hpp"
+#include "RubyProfiler.hpp"
+#include "EngineApi.hpp"
 #include "Backend.hpp"
 #include "ScriptingEngine.hpp"
 #include "SharedContext.hpp"
+#include "Trace.hpp"
 
+// Engine::HookBudgetExceeded - an Exception rather than a StandardError so a plain rescue in the
+// script does not catch it
+static VALUE hookBudgetError = Qnil;
+
+// calls a top level ruby function under rb_protect
+// the call is described on the caller's stack and handed to rb_protect through its data pointer,
+// so nothing is shared between calls and a script may re-enter the engine safely
 class GlobalFunction {
   public:
-    static VALUE call(std::string const& name) {
-      GlobalFunction::argc = 0;
-      GlobalFunction::lastId = rb_intern(name.c_str());
-      GlobalFunction::lastName = name;
-
-      int error = 0;
-
-      VALUE result = rb_protect((VALUE (*)(VALUE))GlobalFunction::wrapper, (VALUE)0, &error);
+    static VALUE call(ID id) {
+      return invoke(id, 0, nullptr);
+    }
 
-      if (error) {
-        VALUE exception = rb_errinfo();
-        rb_set_errinfo(Qnil);
-        if (RTEST(exception)) {
-          rb_warn("Ruby Script Error: %" PRIsVALUE "", rb_funcall(exception, rb_intern("full_message"), 0));
-        }
-        throw std::runtime_error("Script Error");
-      }
+    static VALUE callx1(ID id, VALUE x1) {
+      VALUE params[1];
+      params[0] = x1;
 
-      return result;
+      return invoke(id, 1, params);
     }
 
-    static VALUE callx1(std::string const& name, VALUE x1) {
-      GlobalFunction::argc = 1;
-      GlobalFunction::lastId = rb_intern(name.c_str());
-      GlobalFunction::lastName = name;
+  private:
+    struct Call {
+      ID id;
+      int argc;
+      const VALUE* argv;
+    };
 
-      int error = 0;
+    static VALUE invoke(ID id, int argc, const VALUE* argv) {
+      Call call = { id, argc, argv };
 
-      VALUE params[1];
-      params[0] = x1;
+      int error = 0;
 
-      VALUE result = rb_protect((VALUE (*)(VALUE))GlobalFunction::wrapper, (VALUE)params, &error);
+      VALUE result = rb_protect(GlobalFunction::wrapper, reinterpret_cast<VALUE>(&call), &error);
 
       if (error) {
         VALUE exception = rb_errinfo();
@@ -52,43 +56,58 @@ class GlobalFunction {
         if (RTEST(exception)) {
           rb_warn("Ruby Script Error: %" PRIsVALUE "", rb_funcall(exception, rb_intern("full_message"), 0));
         }
+        // an overrun costs the hook its frame, not the game
+        if (RTEST(exception) && rb_obj_is_kind_of(exception, hookBudgetError)) {
+          return Qnil;
+        }
         throw std::runtime_error("Script Error");
       }
 
       return result;
     }
 
-  private:
-    static VALUE wrapper(VALUE params) {
-      if (GlobalFunction::argc) {
-        VALUE* values = (VALUE*)(params);
-        VALUE x1 = values[0];
-
-        return rb_funcall(0, GlobalFunction::lastId, 1, x1);
-      }
+    static VALUE wrapper(VALUE data) {
+      Call* call = reinterpret_cast<Call*>(data);
 
-      return rb_funcall(0, GlobalFunction::lastId, 0, 0);
+      return rb_funcallv(Qfalse, call->id, call->argc, call->argv);
     }
-
-    static std::string lastName;
-    static int lastId;
-    static int argc;
 };
 
-int GlobalFunction::lastId = 0;
-int GlobalFunction::argc = 0;
-std::string GlobalFunction::lastName = "";
-
 void parseConfigurationTable(VALUE cfgHash, Configuration& config);
 
+// IDLE_GC: a minor collection runs once the objects allocated since the last one reach half the live
+// objects, a major one when ruby would run one itself. the frames collect again once the allocations
+// reach twice the live objects
+static const size_t IDLE_GC_MIN_OBJECTS = 10000;
+
+static size_t gcStat(char const* name) {
+  return rb_gc_stat(ID2SYM(rb_intern(name)));
+}
+
+// GC.start(options) for rb_protect - finalizers and interrupts may raise in it
+static VALUE startGc(VALUE options) {
+  return rb_funcall(rb_mGC, rb_intern("start"), 1, options);
+}
+
 namespace engine {
   VALUE apiInit(VALUE self, VALUE cfgHash);
-  VALUE apiGetScreenWidth(VALUE self);
-  VALUE apiGetScreenHeight(VALUE self);
-  VALUE apiDrawCircle(VALUE self, VALUE xPos, VALUE yPos, VALUE radius);
+  VALUE apiMemStats(VALUE self);
 }
 
-RubyScriptingEngine::RubyScriptingEngine() {
+RubyScriptingEngine::RubyScriptingEngine()
+  : createId(0),
+    destroyId(0),
+    updateId(0),
+    renderId(0),
+    idleGc(false),
+    gcAutomatic(false),
+    liveObjects(0),
+    allocatedObjects(0),
+    minorGcMilliseconds(0),
+    majorGcMilliseconds(0),
+    watchdogStarted(false),
+    objectSlotSize(0),
+    peakObjectBytes(0) {
   RUBY_INIT_STACK;
 
   if (ruby_setup()) {
@@ -99,21 +118,89 @@ RubyScriptingEngine::RubyScriptingEngine() {
 
   engineModule = rb_define_module("Engine");
   rb_define_module_function(engineModule, "init", RUBY_METHOD_FUNC(engine::apiInit), 1);
-  rb_define_module_function(engineModule, "getScreenWidth", RUBY_METHOD_FUNC(engine::apiGetScreenWidth), 0);
-  rb_define_module_function(engineModule, "getScreenHeight", RUBY_METHOD_FUNC(engine::apiGetScreenHeight), 0);
-  rb_define_module_function(engineModule, "drawCircle", RUBY_METHOD_FUNC(engine::apiDrawCircle), 3);
+  rb_define_module_function(engineModule, "createBuffer", RUBY_METHOD_FUNC(RubyBuffer::apiCreateBuffer), 2);
+  rb_define_module_function(engineModule, "memStats", RUBY_METHOD_FUNC(engine::apiMemStats), 0);
+  RubyBuffer::registerType(engineModule);
+  hookBudgetError = rb_define_class_under(engineModule, "HookBudgetExceeded", rb_eException);
+
+  #define RUBY_API_FUNCTION(name, description) RUBY_BINDING(engineModule, #name, engine::native::name);
+  ENGINE_NATIVE_API(RUBY_API_FUNCTION)
+  #undef RUBY_API_FUNCTION
+
+  VALUE gcConstants = rb_const_get(rb_mGC, rb_intern("INTERNAL_CONSTANTS"));
+  objectSlotSize = NUM2SIZET(rb_hash_aref(gcConstants, ID2SYM(rb_intern("RVALUE_SIZE"))));
+
+  profiler = new RubyProfiler();
 }
 
 RubyScriptingEngine::~RubyScriptingEngine() {
+  // a profile still running is written out
+  setProfiling(false);
+  delete profiler;
+  profiler = nullptr;
+
+  // lets the watchdog thread finish before ruby_cleanup reaps it
+  watchdog.stop();
   ruby_cleanup(0);
 }
 
+bool RubyScriptingEngine::getMemoryStats(MemoryStats& stats) {
+  stats = MemoryStats();
+  stats.liveBytes = gcStat("heap_live_slots") * objectSlotSize;
+  peakObjectBytes = std::max(peakObjectBytes, stats.liveBytes);
+  stats.peakBytes = peakObjectBytes;
+  stats.allocations = gcStat("total_allocated_objects");
+  stats.frees = gcStat("total_freed_objects");
+  stats.sizeClassAllocations[MemoryStats::sizeClassOf(objectSlotSize)] = stats.allocations;
+  return true;
+}
+
+// ruby code can only be interrupted from one of ruby's own threads, so the watchdog waits for
+// overruns in a ruby thread with the GVL released. an overrun wakes it, it takes the GVL from the
+// main thread at the next thread switch - ruby switches every 100 ms - and raises there. a budget
+// below that is only kept to the next switch
+static void* waitForOverrun(void* data) {
+  return static_cast<HookWatchdog*>(data)->waitForOverrun() ? data : nullptr;
+}
+
+static void stopWatchdog(void* data) {
+  static_cast<HookWatchdog*>(data)->stop();
+}
+
+void RubyScriptingEngine::startWatchdog() {
+  if (!watchdogStarted) {
+    watchdogStarted = true;
+    rb_thread_create(reinterpret_cast<VALUE (*)(ANYARGS)>(watchdogThread), this);
+  }
+}
+
+VALUE RubyScriptingEngine::watchdogThread(void* data) {
+  RubyScriptingEngine* engine = static_cast<RubyScriptingEngine*>(data);
+  HookWatchdog& watchdog = engine->watchdog;
+
+  while (rb_thread_call_without_gvl(waitForOverrun, &watchdog, stopWatchdog, &watchdog)) {
+    // the hook may have returned while the thread waited for the GVL
+    if (!watchdog.isExpired()) {
+      continue;
+    }
+
+    std::stringstream msg;
+    msg << "hook exceeded its " << watchdog.getBudget() << " ms budget";
+    rb_funcall(rb_thread_main(), rb_intern("raise"), 2, hookBudgetError, rb_str_new_cstr(msg.str().c_str()));
+  }
+
+  return Qnil;
+}
+
 void RubyScriptingEngine::load(std::string const& filename) {
   ruby_script(filename.c_str());
 
   VALUE script = rb_str_new_cstr(filename.c_str());
   int state = 0;
-  rb_load_protect(script, 0, &state);
+  {
+    ScriptProfiler::Scope profiling(profiler);
+    rb_load_protect(script, 0, &state);
+  }
   if (state) {
     std::stringstream msg;
     msg << "Unable to load " << filename << std::endl;
@@ -124,10 +211,102 @@ void RubyScriptingEngine::load(std::string const& filename) {
     }
     throw std::runtime_error(msg.str());
   }
+
+  resolveHooks();
 }
 
 void RubyScriptingEngine::init(Configuration& config) {
   SharedContext::instance->config->copy(config);
+
+  // Engine::init normally runs while the script is loading, before load() resolves the hooks,
+  // but if the script calls it again later the hook names may have changed
+  if (createId) {
+    resolveHooks();
+  }
+}
+
+void RubyScriptingEngine::resolveHooks() {
+  SharedContext& context = *SharedContext::instance;
+
+  createId = rb_intern(context.config->userCreateFunctionName.c_str());
+  destroyId = rb_intern(context.config->userDestroyFunctionName.c_str());
+  updateId = rb_intern(context.config->userUpdateFunctionName.c_str());
+  renderId = rb_intern(context.config->userRenderFunctionName.c_str());
+}
+
+void RubyScriptingEngine::setIdleGc(bool enabled) {
+  idleGc = enabled;
+  gcAutomatic = false;
+
+  if (enabled) {
+    rb_gc_disable();
+    liveObjects = gcStat("heap_live_slots");
+    allocatedObjects = gcStat("total_allocated_objects");
+  } else {
+    rb_gc_enable();
+  }
+}
+
+void RubyScriptingEngine::collectGarbage(std::chrono::steady_clock::time_point deadline) {
+  if (!idleGc) {
+    return;
+  }
+
+  size_t allocated = gcStat("total_allocated_objects") - allocatedObjects;
+  bool major = gcStat("old_objects") > gcStat("old_objects_limit")
+    || gcStat("oldmalloc_increase_bytes") > gcStat("oldmalloc_increase_bytes_limit");
+  bool minor = allocated >= std::max(liveObjects / 2, IDLE_GC_MIN_OBJECTS)
+    || gcStat("malloc_increase_bytes") > gcStat("malloc_increase_bytes_limit") / 2;
+
+  // a collection can not be split - it waits for an idle time long enough for it, unless the frames
+  // are already collecting
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  if (major && !gcAutomatic && start + std::chrono::duration<double, std::milli>(majorGcMilliseconds) > deadline) {
+    major = false;
+  }
+  if (!major && !gcAutomatic && start + std::chrono::duration<double, std::milli>(minorGcMilliseconds) > deadline) {
+    minor = false;
+  }
+
+  if (major || minor) {
+    VALUE options = rb_hash_new();
+    rb_hash_aset(options, ID2SYM(rb_intern("full_mark")), major ? Qtrue : Qfalse);
+    rb_hash_aset(options, ID2SYM(rb_intern("immediate_sweep")), Qtrue);
+
+    // GC.start does nothing while the collector is disabled
+    rb_gc_enable();
+    int error = 0;
+    rb_protect(startGc, options, &error);
+    if (error) {
+      // the collection is the game's, not a hook's - a failed one is reported and the frame goes on
+      VALUE exception = rb_errinfo();
+      rb_set_errinfo(Qnil);
+      if (RTEST(exception)) {
+        rb_warn("Ruby Script Error: %" PRIsVALUE "", rb_funcall(exception, rb_intern("full_message"), 0));
+      }
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    (major ? majorGcMilliseconds : minorGcMilliseconds) = elapsed.count();
+    liveObjects = gcStat("heap_live_slots");
+    allocatedObjects = gcStat("total_allocated_objects");
+  }
+
+  rb_gc_disable();
+  gcAutomatic = false;
+}
+
+void RubyScriptingEngine::checkHeapLimit() {
+  if (!idleGc || gcAutomatic) {
+    return;
+  }
+
+  size_t allocated = gcStat("total_allocated_objects") - allocatedObjects;
+  if (allocated > std::max(2 * liveObjects, 2 * IDLE_GC_MIN_OBJECTS)
+      || gcStat("malloc_increase_bytes") > gcStat("malloc_increase_bytes_limit")) {
+    rb_gc_enable();
+    gcAutomatic = true;
+  }
 }
 
 int RubyScriptingEngine::getScreenWidth() {
@@ -147,65 +326,59 @@ void RubyScriptingEngine::drawCircle(int x, int y, int radius) {
 }
 
 void RubyScriptingEngine::runCreate() {
-  SharedContext& context = *SharedContext::instance;
-
-  GlobalFunction::call(context.config->userCreateFunctionName);
+  TRACE_ZONE("ruby.create");
+  HookCall call(this);
+  GlobalFunction::call(createId);
 }
 
 void RubyScriptingEngine::runDestroy() {
-  SharedContext& context = *SharedContext::instance;
-
-  GlobalFunction::call(context.config->userDestroyFunctionName);
+  TRACE_ZONE("ruby.destroy");
+  HookCall call(this);
+  GlobalFunction::call(destroyId);
 }
 
 void RubyScriptingEngine::runUpdate(float deltaTime) {
-  SharedContext& context = *SharedContext::instance;
-
-  GlobalFunction::callx1(context.config->userUpdateFunctionName, DBL2NUM(deltaTime));
+  TRACE_ZONE("ruby.update");
+  checkHeapLimit();
+  HookCall call(this);
+  GlobalFunction::callx1(updateId, DBL2NUM(deltaTime));
 }
 
 void RubyScriptingEngine::runRender() {
-  SharedContext& context = *SharedContext::instance;
-
-  GlobalFunction::call(context.config->userRenderFunctionName);
+  TRACE_ZONE("ruby.render");
+  checkHeapLimit();
+  HookCall call(this);
+  GlobalFunction::call(renderId);
 }
 
 void parseConfigurationTable(VALUE cfgHash, Configuration& config) {
-  auto hasKey = [&](std::string const& symbolName) {
-    if (rb_funcall(cfgHash, rb_intern("has_key?"), 1, ID2SYM(rb_intern(symbolName.c_str()))) == Qtrue) {
-      return true;
-    }
-    return false;
-  };
+  Check_Type(cfgHash, T_HASH);
 
-  auto readField = [&](std::string const& symbolName) {
-    return rb_funcall(cfgHash, rb_intern("[]"), 1, ID2SYM(rb_intern(symbolName.c_str())));
+  // reads the hash directly - returns Qundef when the key is missing
+  auto readField = [&](char const* symbolName) {
+    return rb_hash_lookup2(cfgHash, ID2SYM(rb_intern(symbolName)), Qundef);
   };
 
-  auto getInt = [&](int* dst, std::string const& name) {
-    if (hasKey(name)) {
-      VALUE result = readField(name);
+  auto getInt = [&](int* dst, char const* name) {
+    VALUE result = readField(name);
+    if (result != Qundef) {
       *dst = static_cast<int>(NUM2INT(result));
     }
   };
 
-  auto getBoolean = [&](bool* dst, std::string const& name) {
-    if (hasKey(name)) {
-      VALUE result = readField(name);
-      if (RB_TYPE_P(result, T_TRUE)) {
-        *dst = true;
-      } else if (RB_TYPE_P(result, T_FALSE)) {
-        *dst = false;
-      }
+  auto getBoolean = [&](bool* dst, char const* name) {
+    VALUE result = readField(name);
+    if (RB_TYPE_P(result, T_TRUE)) {
+      *dst = true;
+    } else if (RB_TYPE_P(result, T_FALSE)) {
+      *dst = false;
     }
   };
 
-  auto getString = [&](std::string& dst, std::string const& name) {
-    if (hasKey(name)) {
-      VALUE result = readField(name);
-      if (RB_TYPE_P(result, T_STRING)) {
-        dst.assign(std::string(StringValueCStr(result)));
-      }
+  auto getString = [&](std::string& dst, char const* name) {
+    VALUE result = readField(name);
+    if (result != Qundef && RB_TYPE_P(result, T_STRING)) {
+      dst.assign(StringValueCStr(result));
     }
   };
 
@@ -213,6 +386,9 @@ void parseConfigurationTable(VALUE cfgHash, Configuration& config) {
   getInt(&config.screenHeight, "SCREEN_HEIGHT");
   getBoolean(&config.useFullscreen, "USE_FULLSCREEN");
   getBoolean(&config.debugMode, "DEBUG");
+  getBoolean(&config.idleGc, "IDLE_GC");
+  getInt(&config.targetFps, "TARGET_FPS");
+  getInt(&config.hookBudgetMilliseconds, "HOOK_BUDGET_MS");
   getString(config.windowTitle, "WINDOW_TITLE");
   getString(config.userCreateFunctionName, "create");
   getString(config.userDestroyFunctionName, "destroy");
@@ -228,21 +404,23 @@ namespace engine {
     return Qnil;
   }
 
-  VALUE apiGetScreenWidth(VALUE self) {
-    VALUE width = INT2NUM(SharedContext::instance->scripting->getScreenWidth());
-    return width;
-  }
+  // returns { live:, peak:, allocations:, frees:, sizeClasses: [allocations of each size class] } -
+  // see MemoryStats.hpp
+  VALUE apiMemStats(VALUE self) {
+    MemoryStats stats;
+    SharedContext::instance->scripting->getMemoryStats(stats);
 
-  VALUE apiGetScreenHeight(VALUE self) {
-    VALUE height = INT2NUM(SharedContext::instance->scripting->getScreenHeight());
-    return height;
-  }
+    VALUE sizeClasses = rb_ary_new_capa(MemoryStats::SIZE_CLASSES);
+    for (int i = 0; i < MemoryStats::SIZE_CLASSES; i++) {
+      rb_ary_push(sizeClasses, ULL2NUM(stats.sizeClassAllocations[i]));
+    }
 
-  VALUE apiDrawCircle(VALUE self, VALUE xPos, VALUE yPos, VALUE radius) {
-    int x = NUM2INT(xPos);
-    int y = NUM2INT(yPos);
-    int r = NUM2INT(radius);
-    SharedContext::instance->scripting->drawCircle(x, y, r);
-    return Qnil;
+    VALUE result = rb_hash_new();
+    rb_hash_aset(result, ID2SYM(rb_intern("live")), SIZET2NUM(stats.liveBytes));
+    rb_hash_aset(result, ID2SYM(rb_intern("peak")), SIZET2NUM(stats.peakBytes));
+    rb_hash_aset(result, ID2SYM(rb_intern("allocations")), ULL2NUM(stats.allocations));
+    rb_hash_aset(result, ID2SYM(rb_intern("frees")), ULL2NUM(stats.frees));
+    rb_hash_aset(result, ID2SYM(rb_intern("sizeClasses")), sizeClasses);
+    return result;
   }
 }
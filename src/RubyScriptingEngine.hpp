@@ -2,6 +2,7 @@
 #define RUBYSCRIPTINGENGINE_H
 
 #include <ruby.h>
+#include <ruby/thread.h>
 
 #include "ScriptingEngine.hpp"
 
@@ -19,9 +20,46 @@ class RubyScriptingEngine : public ScriptingEngine {
     virtual void runDestroy();
     virtual void runUpdate(float deltaTime);
     virtual void runRender();
+    virtual void setIdleGc(bool enabled);
+    virtual void collectGarbage(std::chrono::steady_clock::time_point deadline);
+    // ruby's GC statistics: the object slots in use - the buffers strings and arrays malloc are not
+    // included. every object is one slot, so the allocations are all in the slot size's class
+    virtual bool getMemoryStats(MemoryStats& stats);
 
   protected:
+    virtual void startWatchdog();
+
+    // HOOK_BUDGET_MS: a ruby thread that raises Engine::HookBudgetExceeded in the main thread when a
+    // hook overruns - see RubyScriptingEngine.cpp
+    static VALUE watchdogThread(void* data);
+
+    // interns the lifecycle hook names once so calling a hook does no symbol lookup
+    void resolveHooks();
+    // turns ruby's collector back on when the allocations outgrew the IDLE_GC safety limit
+    void checkHeapLimit();
+
     VALUE engineModule;
+    ID createId;
+    ID destroyId;
+    ID updateId;
+    ID renderId;
+
+    bool idleGc;
+    // ruby's collector was turned back on by checkHeapLimit
+    bool gcAutomatic;
+    // live objects and the allocation count after the last idle collection
+    size_t liveObjects;
+    size_t allocatedObjects;
+    // how long the last minor and major idle collections took
+    double minorGcMilliseconds;
+    double majorGcMilliseconds;
+
+    bool watchdogStarted;
+
+    // GC::INTERNAL_CONSTANTS[:RVALUE_SIZE]
+    size_t objectSlotSize;
+    // the most slots in use any getMemoryStats saw
+    size_t peakObjectBytes;
 };
 
 #endif // !RUBYSCRIPTINGENGINE_H
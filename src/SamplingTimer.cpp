@@ -0,0 +1,88 @@
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <signal.h>
+#include <sys/time.h>
+
+#include "SamplingTimer.hpp"
+
+namespace samplingTimer {
+  namespace {
+    std::atomic<Callback> activeCallback(nullptr);
+    std::atomic<void*> activeData(nullptr);
+    struct sigaction previousAction;
+
+    void handleSignal(int) {
+      // profiled code may look at errno right after the interrupted call
+      int savedErrno = errno;
+
+      // start() stores the data before the callback and stop() clears the callback first
+      void* data = activeData.load();
+      Callback callback = activeCallback.load();
+      if (callback != nullptr && data != nullptr) {
+        callback(data);
+      }
+
+      errno = savedErrno;
+    }
+
+    void setInterval(int microseconds) {
+      struct itimerval timer;
+      timer.it_interval.tv_sec = microseconds / 1000000;
+      timer.it_interval.tv_usec = microseconds % 1000000;
+      timer.it_value = timer.it_interval;
+      setitimer(ITIMER_PROF, &timer, nullptr);
+    }
+  }
+
+  bool start(int intervalMicroseconds, Callback callback, void* data) {
+    if (activeCallback.load() != nullptr || intervalMicroseconds <= 0) {
+      return false;
+    }
+
+    activeData.store(data);
+    activeCallback.store(callback);
+
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = handleSignal;
+    // the signal interrupts whatever the game is doing - including blocking calls in the backends
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    if (sigaction(SIGPROF, &action, &previousAction) != 0) {
+      activeCallback.store(nullptr);
+      activeData.store(nullptr);
+      return false;
+    }
+
+    setInterval(intervalMicroseconds);
+    return true;
+  }
+
+  void stop() {
+    if (activeCallback.load() == nullptr) {
+      return;
+    }
+
+    setInterval(0);
+    activeCallback.store(nullptr);
+    activeData.store(nullptr);
+    sigaction(SIGPROF, &previousAction, nullptr);
+  }
+
+  bool isRunning() {
+    return activeCallback.load() != nullptr;
+  }
+
+  void forward() {
+    if ((previousAction.sa_flags & SA_SIGINFO) != 0) {
+      return;
+    }
+
+    void (*handler)(int) = previousAction.sa_handler;
+    if (handler != SIG_DFL && handler != SIG_IGN && handler != nullptr) {
+      handler(SIGPROF);
+    }
+  }
+}
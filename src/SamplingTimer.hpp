@@ -0,0 +1,22 @@
+#ifndef SAMPLINGTIMER_H
+#define SAMPLINGTIMER_H
+
+// drives the sampling profilers from SIGPROF: the callback runs every interval of cpu time the
+// process uses (ITIMER_PROF). only one timer runs at a time.
+//
+// the callback runs in signal context on whichever thread the signal interrupted - it may only
+// touch lock-free atomics and call async-signal-safe functions
+namespace samplingTimer {
+  typedef void (*Callback)(void* data);
+
+  // returns false when a timer is already running or the signal could not be installed
+  bool start(int intervalMicroseconds, Callback callback, void* data);
+  void stop();
+  bool isRunning();
+
+  // passes the current tick on to the SIGPROF handler that was installed before the timer started -
+  // for interpreters that sample from a signal handler of their own. call it from the callback only
+  void forward();
+}
+
+#endif // !SAMPLINGTIMER_H
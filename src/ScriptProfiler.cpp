@@ -0,0 +1,99 @@
+#include <vector>
+
+#include "ScriptProfiler.hpp"
+
+bool ScriptProfiler::parseMode(std::string const& name, Mode* mode) {
+  if (name == "sampling") {
+    *mode = SAMPLING;
+  } else if (name == "tracing") {
+    *mode = TRACING;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+ScriptProfiler::ScriptProfiler()
+  : running(false),
+    mode(SAMPLING),
+    startClock(0),
+    depth(0),
+    pendingTicks(0),
+    engineTicks(0) {
+}
+
+bool ScriptProfiler::start(Mode newMode, int intervalMicroseconds) {
+  if (running) {
+    return newMode == mode;
+  }
+
+  profile.clear();
+  pendingTicks.store(0);
+  engineTicks.store(0);
+
+  if (newMode == SAMPLING) {
+    profile.setInterval(intervalMicroseconds / 1000.0);
+    startClock = std::clock();
+    if (!startSampling(intervalMicroseconds)) {
+      return false;
+    }
+  } else if (!startTracing()) {
+    return false;
+  }
+
+  mode = newMode;
+  running = true;
+  return true;
+}
+
+void ScriptProfiler::stop() {
+  if (!running) {
+    return;
+  }
+
+  running = false;
+
+  if (mode == TRACING) {
+    stopTracing();
+    profile.endCalls();
+    return;
+  }
+
+  stopSampling();
+
+  unsigned long long ticks = engineTicks.exchange(0) + pendingTicks.exchange(0);
+  profile.addSample(std::vector<std::string>(1, "[engine]"), ticks);
+
+  // timers tick at the system's resolution, which may be coarser than asked for
+  if (profile.getSampleCount() > 0) {
+    double milliseconds = 1000.0 * (std::clock() - startClock) / CLOCKS_PER_SEC;
+    profile.setInterval(milliseconds / profile.getSampleCount());
+  }
+}
+
+void ScriptProfiler::leave() {
+  if (--depth > 0 || !running) {
+    return;
+  }
+
+  if (mode == TRACING) {
+    // calls left open by errors (lua reports no returns for the frames an error unwinds)
+    profile.endCalls();
+    return;
+  }
+
+  // a tick after the script's last safe point - the time went to the native side
+  cancelSample();
+  engineTicks += pendingTicks.exchange(0);
+}
+
+void ScriptProfiler::tick() {
+  if (depth.load() == 0) {
+    engineTicks++;
+    return;
+  }
+
+  if (pendingTicks++ == 0) {
+    requestSample();
+  }
+}
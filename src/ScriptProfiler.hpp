@@ -0,0 +1,89 @@
+#ifndef SCRIPTPROFILER_H
+#define SCRIPTPROFILER_H
+
+#include <atomic>
+#include <ctime>
+#include <string>
+
+#include "Profile.hpp"
+
+// the part of the script profilers every language shares - LuaProfiler, PythonProfiler, RubyProfiler
+//
+// SAMPLING: a timer ticks at a fixed interval. a tick while a script hook runs asks the language for
+//   the script's call stack at its next safe point (requestSample) - the script pays nothing between
+//   samples. ticks outside the script hooks are counted as "[engine]", the native side of the frame.
+// TRACING: every script function call and return is recorded. exact call counts and times, but the
+//   script runs several times slower.
+//
+// frames are named "function (file:first line)" in every language so profiles can be compared.
+// functions implemented in C are not recorded on their own - their time goes to the script function
+// that called them
+class ScriptProfiler {
+  public:
+    enum Mode {
+      SAMPLING,
+      TRACING
+    };
+
+    // "sampling" or "tracing"
+    static bool parseMode(std::string const& name, Mode* mode);
+
+    ScriptProfiler();
+    virtual ~ScriptProfiler() {}
+
+    // returns false when the profiler could not start - another profiler may be sampling
+    bool start(Mode mode, int intervalMicroseconds);
+    void stop();
+    bool isRunning() const { return running; }
+    Mode getMode() const { return mode; }
+
+    // the engine brackets every call into the script with these - see Scope
+    void enter() { depth++; }
+    void leave();
+
+    class Scope {
+      public:
+        explicit Scope(ScriptProfiler* profiler) : profiler(profiler) { profiler->enter(); }
+        ~Scope() { profiler->leave(); }
+
+      private:
+        Scope(Scope const&);
+        Scope& operator=(Scope const&);
+
+        ScriptProfiler* profiler;
+    };
+
+    Profile profile;
+
+  protected:
+    // the language parts
+    virtual bool startSampling(int intervalMicroseconds) = 0;
+    virtual void stopSampling() = 0;
+    virtual bool startTracing() = 0;
+    virtual void stopTracing() = 0;
+
+    // asks for the call stack at the script's next safe point - runs in signal context, once per
+    // batch of ticks until the batch is taken with takeTicks
+    virtual void requestSample() = 0;
+    // the last script call returned before a requested sample was taken
+    virtual void cancelSample() {}
+
+    // a SamplingTimer tick - signal context
+    void tick();
+    // the ticks a captured stack stands for - 0 when the request is stale
+    unsigned takeTicks() { return pendingTicks.exchange(0); }
+
+  private:
+    bool running;
+    Mode mode;
+    std::clock_t startClock;
+
+    // script calls in progress
+    std::atomic<int> depth;
+    // ticks waiting for a stack
+    std::atomic<unsigned> pendingTicks;
+    // ticks outside the script calls
+    std::atomic<unsigned long long> engineTicks;
+};
+
+#endif // !SCRIPTPROFILER_H
@@ -0,0 +1,79 @@
+#include <iostream>
+#include <stdexcept>
+
+#include "ScriptingEngine.hpp"
+
+// one sample per millisecond of cpu time
+static const int PROFILE_INTERVAL_US = 1000;
+
+ScriptingEngine::ScriptingEngine()
+  : profiler(nullptr),
+    profileMode(ScriptProfiler::SAMPLING),
+    profileFile("profile.folded"),
+    hookOverruns(0) {
+}
+
+void ScriptingEngine::setHookBudget(int milliseconds) {
+  watchdog.setBudget(milliseconds);
+  if (milliseconds > 0) {
+    startWatchdog();
+  }
+}
+
+int ScriptingEngine::takeHookOverruns() {
+  int overruns = hookOverruns;
+  hookOverruns = 0;
+  return overruns;
+}
+
+ScriptingEngine::HookCall::HookCall(ScriptingEngine* engine)
+  : engine(engine),
+    finished(false),
+    overran(false) {
+  if (engine->profiler) {
+    engine->profiler->enter();
+  }
+  engine->watchdog.arm();
+}
+
+bool ScriptingEngine::HookCall::finish() {
+  if (finished) {
+    return overran;
+  }
+  finished = true;
+
+  overran = engine->watchdog.disarm();
+  if (overran) {
+    engine->hookOverruns++;
+  }
+  if (engine->profiler) {
+    engine->profiler->leave();
+  }
+  return overran;
+}
+
+bool ScriptingEngine::setProfiling(bool enabled) {
+  if (profiler == nullptr) {
+    return false;
+  }
+
+  if (enabled) {
+    return profiler->start(profileMode, PROFILE_INTERVAL_US);
+  }
+
+  if (!profiler->isRunning()) {
+    return true;
+  }
+
+  profiler->stop();
+
+  try {
+    profiler->profile.save(profileFile);
+  } catch (const std::exception& ex) {
+    std::cerr << "Runtime Error: " << ex.what() << std::endl;
+    return false;
+  }
+
+  std::cout << "Wrote profile " << profileFile << std::endl;
+  return true;
+}
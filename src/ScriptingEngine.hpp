@@ -1,12 +1,18 @@
 #ifndef SCRIPTINGENGINE_H
 #define SCRIPTINGENGINE_H
 
+#include <chrono>
+#include <string>
+
 #include "Configuration.hpp"
+#include "HookWatchdog.hpp"
+#include "MemoryStats.hpp"
+#include "ScriptProfiler.hpp"
 
 // each supported scripting language needs to implement the scripting engine interface
 class ScriptingEngine {
   public:
-    ScriptingEngine() {}
+    ScriptingEngine();
     virtual ~ScriptingEngine() {}
 
     virtual void load(std::string const& filename) = 0;
@@ -19,6 +25,66 @@ class ScriptingEngine {
     virtual void runDestroy() = 0;
     virtual void runUpdate(float deltaTime) = 0;
     virtual void runRender() = 0;
+
+    // called between frames - engines that support hot reload apply changed scripts here
+    virtual void processReloads() {}
+
+    // idle time garbage collection (the IDLE_GC configuration field). the vm's own allocation driven
+    // collector is held back while frames run and the game hands the engine the time left before
+    // the next frame is due instead. when the heap outgrows the safety limit anyway the vm's
+    // collector runs again until the idle collection has caught up
+    virtual void setIdleGc(bool enabled) {}
+    // collects until the deadline at the latest
+    virtual void collectGarbage(std::chrono::steady_clock::time_point deadline) {}
+
+    // starts or stops the script profiler - see ScriptProfiler.hpp. stopping writes the profile to the
+    // profile file. returns false when the engine has no profiler or it could not start
+    virtual bool setProfiling(bool enabled);
+    void setProfileFile(std::string const& filename) { profileFile = filename; }
+    // takes effect the next time profiling starts
+    void setProfileMode(ScriptProfiler::Mode mode) { profileMode = mode; }
+
+    // time budget of each call into a script hook (the HOOK_BUDGET_MS configuration field) - 0 turns
+    // it off. a hook that runs over is interrupted with a script error, so a runaway loop costs one
+    // frame instead of the game
+    virtual void setHookBudget(int milliseconds);
+    // true once the running hook has used half its budget
+    virtual bool shouldYield() { return watchdog.shouldYield(); }
+    // the hooks that overran since the last call
+    virtual int takeHookOverruns();
+
+    // the memory the script vm uses (engine:memStats) - returns false when the engine does not count it
+    virtual bool getMemoryStats(MemoryStats& stats) { return false; }
+
+    // brackets a call into a script hook: profiles it and holds it to the budget
+    class HookCall {
+      public:
+        explicit HookCall(ScriptingEngine* engine);
+        ~HookCall() { finish(); }
+
+        // ends the call early - returns true when it overran its budget
+        bool finish();
+
+      private:
+        HookCall(HookCall const&);
+        HookCall& operator=(HookCall const&);
+
+        ScriptingEngine* engine;
+        bool finished;
+        bool overran;
+    };
+
+  protected:
+    // engines start interrupting overrunning hooks here the first time a budget is set
+    virtual void startWatchdog() {}
+
+    // created and deleted by the engines that have one
+    ScriptProfiler* profiler;
+    ScriptProfiler::Mode profileMode;
+    std::string profileFile;
+
+    HookWatchdog watchdog;
+    int hookOverruns;
 };
 
 #endif // !SCRIPTINGENGINE_H
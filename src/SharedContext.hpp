@@ -4,12 +4,14 @@
 struct Configuration;
 class Backend;
 class ScriptingEngine;
+class EntityStore;
 
 struct SharedContext {
   static SharedContext* instance;
   Configuration* config;
   Backend* backend;
   ScriptingEngine* scripting;
+  EntityStore* world;
 };
 
 #endif // !SHAREDCONTEXT_H
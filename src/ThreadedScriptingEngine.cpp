@@ -0,0 +1,318 @@
+#include <iostream>
+
+#include "ThreadedScriptingEngine.hpp"
+#include "AllocationTracker.hpp"
+#include "EntityStore.hpp"
+#include "FrameArena.hpp"
+#include "SharedContext.hpp"
+#include "Trace.hpp"
+
+// commands the script thread can record ahead of the main thread
+static const size_t DRAW_QUEUE_CAPACITY = 1 << 16;
+
+ThreadedScriptingEngine::ThreadedScriptingEngine(Factory const& factory)
+  : engine(nullptr),
+    busy(false),
+    stopping(false),
+    queue(DRAW_QUEUE_CAPACITY),
+    recorder(this),
+    pendingDeltaTime(0),
+    screenWidth(0),
+    screenHeight(0),
+    overruns(0),
+    countingMemory(false) {
+  thread = std::thread(&ThreadedScriptingEngine::run, this);
+  threadId = thread.get_id();
+
+  try {
+    call([&]() { engine = factory(); });
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+      changed.notify_all();
+    }
+    thread.join();
+    throw;
+  }
+}
+
+ThreadedScriptingEngine::~ThreadedScriptingEngine() {
+  try {
+    call([&]() {
+      delete engine;
+      engine = nullptr;
+    });
+  } catch (const std::exception& ex) {
+    std::cerr << "Runtime Error: " << ex.what() << std::endl;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    changed.notify_all();
+  }
+  thread.join();
+}
+
+void ThreadedScriptingEngine::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    while (!job && !stopping) {
+      changed.wait(lock);
+    }
+    if (!job) {
+      return;
+    }
+
+    std::function<void()> current;
+    current.swap(job);
+    lock.unlock();
+    current();
+    lock.lock();
+
+    busy = false;
+    changed.notify_all();
+  }
+}
+
+void ThreadedScriptingEngine::call(std::function<void()> const& function) {
+  // the script calling back into the engine
+  if (std::this_thread::get_id() == threadId) {
+    function();
+    return;
+  }
+
+  std::exception_ptr error;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (busy) {
+      changed.wait(lock);
+    }
+
+    busy = true;
+    job = [&]() {
+      try {
+        function();
+      } catch (...) {
+        error = std::current_exception();
+      }
+    };
+    changed.notify_all();
+
+    while (busy) {
+      changed.wait(lock);
+    }
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+bool ThreadedScriptingEngine::post(std::function<void()> const& function) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (busy) {
+    return false;
+  }
+
+  busy = true;
+  job = [this, function]() {
+    try {
+      function();
+    } catch (...) {
+      postedError = std::current_exception();
+    }
+  };
+  changed.notify_all();
+  return true;
+}
+
+void ThreadedScriptingEngine::checkError() {
+  std::exception_ptr error;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    // written by a posted job that has finished
+    if (!busy) {
+      error = postedError;
+      postedError = nullptr;
+    }
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void ThreadedScriptingEngine::refreshScreenSize() {
+  int width = 0;
+  int height = 0;
+  SharedContext::instance->backend->getWindowSize(&width, &height);
+  screenWidth = width;
+  screenHeight = height;
+}
+
+void ThreadedScriptingEngine::load(std::string const& filename) {
+  call([&]() { engine->load(filename); });
+}
+
+void ThreadedScriptingEngine::init(Configuration& config) {
+  call([&]() { engine->init(config); });
+}
+
+int ThreadedScriptingEngine::getScreenWidth() {
+  return screenWidth;
+}
+
+int ThreadedScriptingEngine::getScreenHeight() {
+  return screenHeight;
+}
+
+void ThreadedScriptingEngine::drawCircle(int x, int y, int radius) {
+  recorder.drawCircle(x, y, radius);
+}
+
+void ThreadedScriptingEngine::runCreate() {
+  refreshScreenSize();
+  call([&]() { engine->runCreate(); });
+}
+
+void ThreadedScriptingEngine::runDestroy() {
+  call([&]() { engine->runDestroy(); });
+}
+
+void ThreadedScriptingEngine::runUpdate(float deltaTime) {
+  checkError();
+
+  pendingDeltaTime += deltaTime;
+  refreshScreenSize();
+
+  float stepDeltaTime = pendingDeltaTime;
+  if (post([this, stepDeltaTime]() { step(stepDeltaTime); })) {
+    pendingDeltaTime = 0;
+  }
+}
+
+void ThreadedScriptingEngine::step(float deltaTime) {
+  TRACE_ZONE("script.step");
+  EntityStore& world = *SharedContext::instance->world;
+
+  {
+    ALLOCATION_PHASE(RELOAD);
+    engine->processReloads();
+  }
+  {
+    ALLOCATION_PHASE(UPDATE);
+    engine->runUpdate(deltaTime);
+    {
+      TRACE_ZONE("world.update");
+      world.update(deltaTime);
+    }
+  }
+  {
+    ALLOCATION_PHASE(RENDER);
+    engine->runRender();
+    {
+      TRACE_ZONE("world.render");
+      world.render(recorder);
+    }
+    recorder.endFrame();
+  }
+
+  overruns += engine->takeHookOverruns();
+
+  FrameArena::current().reset();
+
+  MemoryStats stats;
+  bool counted = engine->getMemoryStats(stats);
+  std::lock_guard<std::mutex> lock(memoryMutex);
+  memory = stats;
+  countingMemory = counted;
+}
+
+void ThreadedScriptingEngine::runRender() {
+  checkError();
+
+  // only the newest complete frame is shown
+  DrawQueue::Command command;
+  while (queue.pop(command)) {
+    if (command.type == DrawQueue::Command::END_FRAME) {
+      shownFrame.swap(readingFrame);
+      readingFrame.clear();
+    } else {
+      readingFrame.push_back(command);
+    }
+  }
+
+  Backend& backend = *SharedContext::instance->backend;
+  for (size_t i = 0; i < shownFrame.size(); i++) {
+    DrawQueue::Command const& circle = shownFrame[i];
+    backend.drawCircle(circle.x, circle.y, circle.radius);
+  }
+}
+
+// the step applies them - a job of their own would keep the script thread from taking the next one
+void ThreadedScriptingEngine::processReloads() {
+}
+
+void ThreadedScriptingEngine::setIdleGc(bool enabled) {
+  call([&]() { engine->setIdleGc(enabled); });
+}
+
+void ThreadedScriptingEngine::collectGarbage(std::chrono::steady_clock::time_point deadline) {
+  post([this, deadline]() { engine->collectGarbage(deadline); });
+}
+
+bool ThreadedScriptingEngine::setProfiling(bool enabled) {
+  bool result = false;
+  call([&]() {
+    engine->setProfileFile(profileFile);
+    engine->setProfileMode(profileMode);
+    result = engine->setProfiling(enabled);
+  });
+  return result;
+}
+
+void ThreadedScriptingEngine::setHookBudget(int milliseconds) {
+  call([&]() { engine->setHookBudget(milliseconds); });
+}
+
+bool ThreadedScriptingEngine::shouldYield() {
+  return engine->shouldYield();
+}
+
+int ThreadedScriptingEngine::takeHookOverruns() {
+  return overruns.exchange(0);
+}
+
+bool ThreadedScriptingEngine::getMemoryStats(MemoryStats& stats) {
+  std::lock_guard<std::mutex> lock(memoryMutex);
+  stats = memory;
+  return countingMemory;
+}
+
+void ThreadedScriptingEngine::DrawRecorder::getWindowSize(int* width, int* height) {
+  if (width) {
+    *width = engine->screenWidth;
+  }
+  if (height) {
+    *height = engine->screenHeight;
+  }
+}
+
+void ThreadedScriptingEngine::DrawRecorder::drawCircle(int x, int y, int radius) {
+  DrawQueue::Command command = { DrawQueue::Command::CIRCLE, x, y, radius };
+  push(command);
+}
+
+void ThreadedScriptingEngine::DrawRecorder::endFrame() {
+  DrawQueue::Command command = { DrawQueue::Command::END_FRAME, 0, 0, 0 };
+  push(command);
+}
+
+void ThreadedScriptingEngine::DrawRecorder::push(DrawQueue::Command const& command) {
+  if (!engine->queue.push(command) && !dropped) {
+    dropped = true;
+    std::cerr << "Draw queue full: the main thread is not keeping up, dropping draw commands" << std::endl;
+  }
+}
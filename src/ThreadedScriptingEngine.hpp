@@ -0,0 +1,133 @@
+#ifndef THREADEDSCRIPTINGENGINE_H
+#define THREADEDSCRIPTINGENGINE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Backend.hpp"
+#include "DrawQueue.hpp"
+#include "ScriptingEngine.hpp"
+
+// runs a scripting engine on a thread of its own (the --python-thread option). the engine is created,
+// used and deleted on that thread only, so an interpreter with a global lock like python's holds it
+// there and the main thread never waits for it while it pumps events and presents frames
+//
+// runUpdate hands a whole simulation step to the script thread - reloads, the script's update, the
+// native systems' update, the script's render and the native systems' render - and returns at once.
+// the drawing is recorded into a DrawQueue and runRender replays the last complete frame, so a long
+// update only means the same frame is shown again while the window keeps responding. the delta times
+// of the frames a step took are added up and handed to the next one. the entity store is only touched
+// by the script thread while the engine runs this way
+//
+// the other calls wait for the step in progress and run on the script thread before they return
+class ThreadedScriptingEngine : public ScriptingEngine {
+  public:
+    typedef std::function<ScriptingEngine*()> Factory;
+
+    // creates the engine on the script thread
+    explicit ThreadedScriptingEngine(Factory const& factory);
+    virtual ~ThreadedScriptingEngine();
+
+    virtual void load(std::string const& filename);
+    virtual void init(Configuration& config);
+    // the size the main thread saw at the start of the step
+    virtual int getScreenWidth();
+    virtual int getScreenHeight();
+    // records the circle for the frame being built
+    virtual void drawCircle(int x, int y, int radius);
+    virtual void runCreate();
+    virtual void runDestroy();
+    virtual void runUpdate(float deltaTime);
+    virtual void runRender();
+    // every step starts with them
+    virtual void processReloads();
+    virtual void setIdleGc(bool enabled);
+    // skipped while a step runs
+    virtual void collectGarbage(std::chrono::steady_clock::time_point deadline);
+
+    virtual bool setProfiling(bool enabled);
+    virtual void setHookBudget(int milliseconds);
+    virtual bool shouldYield();
+    virtual int takeHookOverruns();
+    // as of the end of the last step
+    virtual bool getMemoryStats(MemoryStats& stats);
+
+  private:
+    // the backend the native systems render to on the script thread
+    class DrawRecorder : public Backend {
+      public:
+        explicit DrawRecorder(ThreadedScriptingEngine* engine) : engine(engine), dropped(false) {}
+
+        virtual void init() {}
+        virtual void createWindow(int width, int height, bool fullscreen, std::string const& title) {}
+        virtual void getWindowSize(int* width, int* height);
+        virtual float getTimestamp() { return 0; }
+        virtual void shutdown() {}
+        virtual bool processEvents() { return true; }
+        virtual void preFrameUpdate(float deltaTime) {}
+        virtual void postFrameUpdate(float deltaTime) {}
+        virtual void preFrameRender() {}
+        virtual void postFrameRender() {}
+        virtual void drawCircle(int x, int y, int radius);
+
+        void endFrame();
+
+      private:
+        void push(DrawQueue::Command const& command);
+
+        ThreadedScriptingEngine* engine;
+        // a full queue drops commands - reported once
+        bool dropped;
+    };
+
+    ThreadedScriptingEngine(ThreadedScriptingEngine const&);
+    ThreadedScriptingEngine& operator=(ThreadedScriptingEngine const&);
+
+    void run();
+    // runs job on the script thread and waits for it - the job's exception is thrown here
+    void call(std::function<void()> const& job);
+    // starts job on the script thread unless it is busy - its exception is thrown by the next call
+    bool post(std::function<void()> const& job);
+    // throws the exception of a posted job
+    void checkError();
+
+    // one simulation step on the script thread
+    void step(float deltaTime);
+    // main thread: the window size for the script thread
+    void refreshScreenSize();
+
+    ScriptingEngine* engine;
+
+    std::thread thread;
+    std::thread::id threadId;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::function<void()> job;
+    bool busy;
+    bool stopping;
+    std::exception_ptr postedError;
+
+    DrawQueue queue;
+    DrawRecorder recorder;
+    // main thread: the frame being read from the queue and the last complete one
+    std::vector<DrawQueue::Command> readingFrame;
+    std::vector<DrawQueue::Command> shownFrame;
+    // delta time of the frames that went by while a step ran
+    float pendingDeltaTime;
+
+    std::atomic<int> screenWidth;
+    std::atomic<int> screenHeight;
+    std::atomic<int> overruns;
+
+    // the engine's memory after the last step
+    std::mutex memoryMutex;
+    MemoryStats memory;
+    bool countingMemory;
+};
+
+#endif // !THREADEDSCRIPTINGENGINE_H
@@ -0,0 +1,109 @@
+#include "TimerWheel.hpp"
+
+TimerWheel::TimerWheel()
+  : current(0),
+    count(0) {
+  for (int level = 0; level < LEVELS; level++) {
+    levelCounts[level] = 0;
+  }
+}
+
+void TimerWheel::schedule(unsigned id, Tick tick) {
+  Timer timer = { id, tick > current ? tick : current + 1 };
+  insert(timer);
+  count++;
+}
+
+void TimerWheel::insert(Timer const& timer) {
+  Tick distance = timer.tick - current;
+
+  for (int level = 0; level < LEVELS; level++) {
+    if (distance < (Tick(1) << ((level + 1) * SLOT_BITS))) {
+      int slot = static_cast<int>((timer.tick >> (level * SLOT_BITS)) & (SLOTS - 1));
+      slots[level][slot].push_back(timer);
+      levelCounts[level]++;
+      return;
+    }
+  }
+
+  overflow.push_back(timer);
+}
+
+void TimerWheel::advance(Tick tick, std::vector<unsigned>& expired) {
+  while (current < tick) {
+    // nothing left to expire - jump straight to the end
+    if (count == 0) {
+      current = tick;
+      return;
+    }
+
+    // a level is only looked at when the levels below it wrap around - with nothing in the levels
+    // below the lowest one that holds timers the wheel can jump to its next wrap
+    int lowest = 0;
+    while (lowest < LEVELS && levelCounts[lowest] == 0) {
+      lowest++;
+    }
+
+    Tick next = current + 1;
+    if (lowest > 0) {
+      Tick span = Tick(1) << (lowest * SLOT_BITS);
+      next = (current / span + 1) * span;
+    }
+
+    if (next > tick) {
+      current = tick;
+      return;
+    }
+    current = next;
+
+    // a higher level slot is due whenever every level below it wraps around. a slot is always
+    // emptied at or before the earliest tick in it, so its timers find a place further down
+    int slot = static_cast<int>(current & (SLOTS - 1));
+    for (int level = 1; level < LEVELS && slot == 0; level++) {
+      slot = static_cast<int>((current >> (level * SLOT_BITS)) & (SLOTS - 1));
+      cascade(level, slot, expired);
+    }
+
+    std::vector<Timer>& due = slots[0][current & (SLOTS - 1)];
+    for (size_t i = 0; i < due.size(); i++) {
+      expired.push_back(due[i].id);
+    }
+    count -= due.size();
+    levelCounts[0] -= due.size();
+    due.clear();
+  }
+}
+
+void TimerWheel::cascade(int level, int slot, std::vector<unsigned>& expired) {
+  std::vector<Timer> timers;
+  timers.swap(slots[level][slot]);
+  levelCounts[level] -= timers.size();
+
+  // the top level wrapped - the overflow may be in reach now
+  if (level == LEVELS - 1 && slot == 0) {
+    timers.insert(timers.end(), overflow.begin(), overflow.end());
+    overflow.clear();
+  }
+
+  for (size_t i = 0; i < timers.size(); i++) {
+    if (timers[i].tick <= current) {
+      expired.push_back(timers[i].id);
+      count--;
+    } else {
+      insert(timers[i]);
+    }
+  }
+}
+
+void TimerWheel::clear() {
+  for (int level = 0; level < LEVELS; level++) {
+    for (int slot = 0; slot < SLOTS; slot++) {
+      slots[level][slot].clear();
+    }
+  }
+  overflow.clear();
+  for (int level = 0; level < LEVELS; level++) {
+    levelCounts[level] = 0;
+  }
+  count = 0;
+}
@@ -0,0 +1,52 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <cstddef>
+#include <vector>
+
+// hierarchical timer wheel: timers are ids that expire at an absolute tick. four levels of 256 slots
+// each cover 2^32 ticks ahead, timers further out wait in an overflow list. a timer sits in the level
+// that matches how far away it is and moves down a level each time the level below wraps around, so
+// scheduling is O(1) and advancing only touches the slots that pass - the cost of a frame does not
+// depend on how many timers are waiting. stretches where the lower levels are empty are skipped
+//
+// the unit of a tick is up to the user - LuaScheduler runs one wheel in milliseconds and one in frames
+class TimerWheel {
+  public:
+    typedef unsigned long long Tick;
+
+    TimerWheel();
+
+    // a timer at or before the current tick expires on the next advance
+    void schedule(unsigned id, Tick tick);
+
+    // moves the wheel forward to tick and appends the ids of the timers that expired, earliest first
+    void advance(Tick tick, std::vector<unsigned>& expired);
+
+    Tick getTick() const { return current; }
+    size_t size() const { return count; }
+    void clear();
+
+  private:
+    static const int LEVELS = 4;
+    static const int SLOT_BITS = 8;
+    static const int SLOTS = 1 << SLOT_BITS;
+
+    struct Timer {
+      unsigned id;
+      Tick tick;
+    };
+
+    void insert(Timer const& timer);
+    // empties a slot of a higher level into the levels below it
+    void cascade(int level, int slot, std::vector<unsigned>& expired);
+
+    std::vector<Timer> slots[LEVELS][SLOTS];
+    std::vector<Timer> overflow;
+    // timers in each level, the overflow not included
+    size_t levelCounts[LEVELS];
+    Tick current;
+    size_t count;
+};
+
+#endif // !TIMERWHEEL_H
@@ -0,0 +1,178 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+#include "Trace.hpp"
+
+namespace trace {
+  namespace {
+    struct Event {
+      const char* name;
+      double timestamp;
+      char phase;
+    };
+
+    // hashes the characters rather than the pointer, so a script's name finds its copy without
+    // building a std::string first
+    struct NameHash {
+      size_t operator()(const char* name) const {
+        // FNV-1a
+        size_t hash = 2166136261u;
+        for (const char* c = name; *c != '\0'; c++) {
+          hash = (hash ^ static_cast<unsigned char>(*c)) * 16777619u;
+        }
+        return hash;
+      }
+    };
+
+    struct NameEqual {
+      bool operator()(const char* a, const char* b) const {
+        return std::strcmp(a, b) == 0;
+      }
+    };
+
+    struct ThreadBuffer {
+      int threadId;
+      std::vector<Event> events;
+      // copies of the names that were not literals, looked up by their characters
+      std::unordered_set<const char*, NameHash, NameEqual> names;
+    };
+
+    // room for a few seconds of zones before the first reallocation
+    const size_t INITIAL_EVENTS = 1 << 16;
+
+    // buffers are never freed, so a thread's events survive the thread
+    struct Registry {
+      std::mutex mutex;
+      std::vector<ThreadBuffer*> buffers;
+    };
+
+    Registry& registry() {
+      static Registry instance;
+      return instance;
+    }
+
+    thread_local ThreadBuffer* threadBuffer = nullptr;
+
+    ThreadBuffer& currentBuffer() {
+      if (threadBuffer == nullptr) {
+        Registry& shared = registry();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+
+        threadBuffer = new ThreadBuffer();
+        threadBuffer->threadId = static_cast<int>(shared.buffers.size()) + 1;
+        threadBuffer->events.reserve(INITIAL_EVENTS);
+        shared.buffers.push_back(threadBuffer);
+      }
+      return *threadBuffer;
+    }
+
+    void record(const char* name, char phase) {
+      Event event;
+      event.name = name;
+      event.timestamp = now();
+      event.phase = phase;
+      currentBuffer().events.push_back(event);
+    }
+
+    void writeString(std::ostream& out, const char* value) {
+      out << '"';
+      for (const char* c = value; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+          out << '\\' << *c;
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+          char escaped[8];
+          std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(*c));
+          out << escaped;
+        } else {
+          out << *c;
+        }
+      }
+      out << '"';
+    }
+  }
+
+  double now() {
+    static const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - origin;
+    return elapsed.count();
+  }
+
+  void begin(const char* name) {
+    record(name, 'B');
+  }
+
+  void beginCopy(const char* name) {
+    ThreadBuffer& buffer = currentBuffer();
+    std::unordered_set<const char*, NameHash, NameEqual>::iterator it = buffer.names.find(name);
+    if (it == buffer.names.end()) {
+      // the copies live as long as the buffer, which is never freed
+      size_t length = std::strlen(name);
+      char* copy = new char[length + 1];
+      std::memcpy(copy, name, length + 1);
+      it = buffer.names.insert(copy).first;
+    }
+    record(*it, 'B');
+  }
+
+  void end() {
+    record("", 'E');
+  }
+
+  size_t eventCount() {
+    Registry& shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+
+    size_t count = 0;
+    for (size_t i = 0; i < shared.buffers.size(); i++) {
+      count += shared.buffers[i]->events.size();
+    }
+    return count;
+  }
+
+  void write(std::string const& filename) {
+    std::ofstream file(filename.c_str());
+    if (!file) {
+      std::stringstream msg;
+      msg << "Unable to write trace " << filename << std::endl;
+      throw std::runtime_error(msg.str());
+    }
+
+    Registry& shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+
+    file.setf(std::ios::fixed);
+    file.precision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first = true;
+    for (size_t i = 0; i < shared.buffers.size(); i++) {
+      ThreadBuffer& buffer = *shared.buffers[i];
+
+      file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.threadId
+        << ",\"args\":{\"name\":\"thread " << buffer.threadId << "\"}}";
+      first = false;
+
+      for (size_t e = 0; e < buffer.events.size(); e++) {
+        Event const& event = buffer.events[e];
+        file << ",\n{\"ph\":\"" << event.phase << "\",\"ts\":" << event.timestamp
+          << ",\"pid\":1,\"tid\":" << buffer.threadId;
+        if (event.phase == 'B') {
+          file << ",\"name\":";
+          writeString(file, event.name);
+        }
+        file << "}";
+      }
+
+      buffer.events.clear();
+    }
+
+    file << "\n]}\n";
+  }
+}
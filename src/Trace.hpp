@@ -0,0 +1,58 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <string>
+
+// timeline of scoped zones written as a Chrome trace_event JSON file (chrome://tracing, ui.perfetto.dev)
+// the macros compile to nothing unless ENABLE_TRACING is defined, so zones can stay in hot code
+//
+//   TRACE_ZONE("frame");          // zone from here to the end of the enclosing scope
+//   TRACE_BEGIN("spawn"); ...; TRACE_END();
+//
+// zone names are not copied - they must outlive the trace (string literals). names that don't,
+// like the ones coming from scripts, go through trace::beginCopy, which copies a name the first
+// time the thread records it
+//
+// every thread records into a buffer of its own, so recording takes no locks. write() must be
+// called while no other thread is recording
+
+namespace trace {
+  // microseconds since the process started tracing
+  double now();
+
+  void begin(const char* name);
+  // copies the name into the recording thread's buffer - a name it already holds is not copied again
+  void beginCopy(const char* name);
+  void end();
+
+  // number of events recorded so far on every thread
+  size_t eventCount();
+
+  // writes every thread's events and clears them
+  void write(std::string const& filename);
+
+  class Zone {
+    public:
+      explicit Zone(const char* name) { begin(name); }
+      ~Zone() { end(); }
+
+    private:
+      Zone(Zone const&);
+      Zone& operator=(Zone const&);
+  };
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef ENABLE_TRACING
+#define TRACE_ZONE(name) trace::Zone TRACE_CONCAT(traceZone, __LINE__)(name)
+#define TRACE_BEGIN(name) trace::begin(name)
+#define TRACE_END() trace::end()
+#else
+#define TRACE_ZONE(name) ((void)0)
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END() ((void)0)
+#endif
+
+#endif // !TRACE_H
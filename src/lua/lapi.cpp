@@ -1104,6 +1104,21 @@ LUA_API int lua_gc (lua_State *L, int what, int data) {
 }
 
 
+LUA_API int lua_fieldcachestats (lua_State *L, lua_Unsigned *hits,
+                                 lua_Unsigned *misses) {
+#if defined(LUAI_FIELDCACHE_STATS)
+  global_State *g = G(L);
+  *hits = cast(lua_Unsigned, g->fieldcachehits);
+  *misses = cast(lua_Unsigned, g->fieldcachemisses);
+  return 1;
+#else
+  UNUSED(L);
+  *hits = *misses = 0;
+  return 0;
+#endif
+}
+
+
 
 /*
 ** miscellaneous functions
@@ -104,6 +104,7 @@ Proto *luaF_newproto (lua_State *L) {
   f->p = NULL;
   f->sizep = 0;
   f->code = NULL;
+  f->fieldcache = NULL;
   f->cache = NULL;
   f->sizecode = 0;
   f->lineinfo = NULL;
@@ -124,6 +125,8 @@ Proto *luaF_newproto (lua_State *L) {
 
 void luaF_freeproto (lua_State *L, Proto *f) {
   luaM_freearray(L, f->code, f->sizecode);
+  if (f->fieldcache != NULL)
+    luaM_freearray(L, f->fieldcache, f->sizecode);
   luaM_freearray(L, f->p, f->sizep);
   luaM_freearray(L, f->k, f->sizek);
   luaM_freearray(L, f->lineinfo, f->sizelineinfo);
@@ -133,6 +136,18 @@ void luaF_freeproto (lua_State *L, Proto *f) {
 }
 
 
+/*
+** Create the field caches of a function once its code is complete: one
+** slot per instruction, all of them starting at node 0.
+*/
+void luaF_initfieldcache (lua_State *L, Proto *f) {
+  int i;
+  f->fieldcache = luaM_newvector(L, f->sizecode, unsigned int);
+  for (i = 0; i < f->sizecode; i++)
+    f->fieldcache[i] = 0;
+}
+
+
 /*
 ** Look for n-th local variable at line 'line' in function 'func'.
 ** Returns NULL if not found.
@@ -151,6 +151,10 @@ typedef struct global_State {
   TString *tmname[TM_N];  /* array with tag-method names */
   struct Table *mt[LUA_NUMTAGS];  /* metatables for basic types */
   TString *strcache[STRCACHE_N][STRCACHE_M];  /* cache for strings in API */
+#if defined(LUAI_FIELDCACHE_STATS)
+  lu_mem fieldcachehits;  /* field accesses served by their field cache */
+  lu_mem fieldcachemisses;  /* field accesses that looked the key up */
+#endif
 } global_State;
 
 
@@ -311,6 +311,10 @@ LUA_API int (lua_isyieldable) (lua_State *L);
 
 LUA_API int (lua_gc) (lua_State *L, int what, int data);
 
+/* hits and misses of the VM's field caches; returns 0 when not counted */
+LUA_API int (lua_fieldcachestats) (lua_State *L, lua_Unsigned *hits,
+                                   lua_Unsigned *misses);
+
 
 /*
 ** miscellaneous functions
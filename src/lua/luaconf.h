@@ -775,6 +775,15 @@
 ** without modifying the main part of the file.
 */
 
+/*
+@@ LUAI_FIELDCACHE_STATS counts the hits and misses of the field caches
+** of the VM (see 'cachedgetshortstr' in lvm.cpp), for
+** 'lua_fieldcachestats'. The engine's debug builds count them.
+*/
+#if defined(DEBUG) && !defined(LUAI_FIELDCACHE_STATS)
+#define LUAI_FIELDCACHE_STATS
+#endif
+
 
 
 
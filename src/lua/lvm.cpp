@@ -762,6 +762,21 @@ void luaV_finishOp (lua_State *L) {
   lua_assert(base <= L->top && L->top < L->stack + L->stacksize); \
 }
 
+/*
+** 'LUA_USE_JUMPTABLE' dispatches with a jump table (labels as values,
+** GCC and Clang only): every opcode jumps straight to the next one, so
+** each gets a branch of its own for the predictor. the switch below is
+** the fallback for other compilers, or with -DLUA_USE_JUMPTABLE=0
+*/
+#if !defined(LUA_USE_JUMPTABLE)
+#if defined(__GNUC__)
+#define LUA_USE_JUMPTABLE	1
+#else
+#define LUA_USE_JUMPTABLE	0
+#endif
+#endif
+
+
 #define vmdispatch(o)	switch(o)
 #define vmcase(l)	case l:
 #define vmbreak		break
@@ -776,6 +791,59 @@ void luaV_finishOp (lua_State *L) {
   else Protect(luaV_finishget(L,t,k,v,slot)); }
 
 
+/*
+** Field caches: GETTABUP, GETTABLE and SELF with a constant short string
+** key remember, in their slot of the prototype's 'fieldcache', the node
+** of the hash part where the key was found last. When the table has the
+** key in that node (the same table, or another one built the same way,
+** like the objects of a class) the access skips the hashing and the
+** chain walk. Checking the key in the node is all the validation the
+** slot needs: a resize moves the keys, so the check fails and the slot
+** is filled again by the next lookup that finds the key.
+*/
+#if defined(LUAI_FIELDCACHE_STATS)
+#define fieldcachehit(L)	(G(L)->fieldcachehits++)
+#define fieldcachemiss(L)	(G(L)->fieldcachemisses++)
+#else
+#define fieldcachehit(L)	((void)0)
+#define fieldcachemiss(L)	((void)0)
+#endif
+
+/* the field cache slot of the running instruction */
+#define fieldslot(ci,cl) \
+	(cl->p->fieldcache + (ci->u.l.savedpc - cl->p->code - 1))
+
+static const TValue *cachedgetshortstr (lua_State *L, Table *t,
+                                        TString *key, unsigned int *slot) {
+  unsigned int n = *slot;
+  const TValue *res;
+  UNUSED(L);  /* only counted with LUAI_FIELDCACHE_STATS */
+  if (n < cast(unsigned int, sizenode(t))) {
+    Node *node = gnode(t, n);
+    const TValue *k = gkey(node);
+    if (ttisshrstring(k) && eqshrstr(tsvalue(k), key)) {
+      fieldcachehit(L);
+      return gval(node);
+    }
+  }
+  fieldcachemiss(L);
+  res = luaH_getshortstr(t, key);
+  if (res != luaO_nilobject)  /* found in the hash part? */
+    *slot = cast(unsigned int, cast(const Node *, res) - t->node);
+  return res;
+}
+
+
+/* 'gettableProtected' through the field cache for constant keys */
+#define gettableCached(L,t,k,v) { \
+  if (ISK(GETARG_C(i)) && ttistable(t) && ttisshrstring(k)) { \
+    const TValue *slot = cachedgetshortstr(L, hvalue(t), tsvalue(k), \
+                                           fieldslot(ci, cl)); \
+    if (!ttisnil(slot)) { setobj2s(L, v, slot); } \
+    else Protect(luaV_finishget(L,t,k,v,slot)); } \
+  else gettableProtected(L,t,k,v); }
+
+
 /* same for 'luaV_settable' */
 #define settableProtected(L,t,k,v) { const TValue *slot; \
   if (!luaV_fastset(L,t,k,slot,luaH_get,v)) \
@@ -788,6 +856,9 @@ void luaV_execute (lua_State *L) {
   LClosure *cl;
   TValue *k;
   StkId base;
+#if LUA_USE_JUMPTABLE
+#include "ljumptab.h"
+#endif
   ci->callstatus |= CIST_FRESH;  /* fresh invocation of 'luaV_execute" */
  newframe:  /* reentry point when frame changes (call/return) */
   lua_assert(ci == L->ci);
@@ -836,13 +907,13 @@ void luaV_execute (lua_State *L) {
       vmcase(OP_GETTABUP) {
         TValue *upval = cl->upvals[GETARG_B(i)]->v;
         TValue *rc = RKC(i);
-        gettableProtected(L, upval, rc, ra);
+        gettableCached(L, upval, rc, ra);
         vmbreak;
       }
       vmcase(OP_GETTABLE) {
         StkId rb = RB(i);
         TValue *rc = RKC(i);
-        gettableProtected(L, rb, rc, ra);
+        gettableCached(L, rb, rc, ra);
         vmbreak;
       }
       vmcase(OP_SETTABUP) {
@@ -880,7 +951,13 @@ void luaV_execute (lua_State *L) {
         TValue *rc = RKC(i);
         TString *key = tsvalue(rc);  /* key must be a string */
         setobjs2s(L, ra + 1, rb);
-        if (luaV_fastget(L, rb, key, aux, luaH_getstr)) {
+        if (ttistable(rb) && ttisshrstring(rc))
+          aux = cachedgetshortstr(L, hvalue(rb), key, fieldslot(ci, cl));
+        else if (!ttistable(rb))
+          aux = NULL;
+        else
+          aux = luaH_getstr(hvalue(rb), key);
+        if (aux != NULL && !ttisnil(aux)) {
           setobj2s(L, ra, aux);
         }
         else Protect(luaV_finishget(L, rb, rc, ra, aux));
@@ -5,157 +5,134 @@
 #include <vector>
 #include <map>
 #include <algorithm>
+#include <cstdlib>
 
 #ifdef USE_SDL_BACKEND
 #include "SDLBackend.hpp"
+#else
+#include "HeadlessBackend.hpp"
 #endif
 
-#include "SharedContext.hpp"
-#include "Configuration.hpp"
-
-#include "LuaScriptingEngine.hpp"
-#include "RubyScriptingEngine.hpp"
+#include "AllocationTracker.hpp"
+#include "Game.hpp"
+#include "LuaAllocator.hpp"
 #include "PythonScriptingEngine.hpp"
-
-class Game {
-  public:
-    Game(std::string const& programName, std::string const& mainScriptFile);
-    ~Game();
-    void create();
-    void destroy();
-    void update(float deltaTime);
-    void render();
-
-    Configuration config;
-    SharedContext context;
-    bool isRunning;
-};
-
-Game::Game(std::string const& programName, std::string const& mainScriptFile) {
-  // initialize the shared context
-  SharedContext::instance = &context;
-  context.config = &config;
-  #ifdef USE_SDL_BACKEND
-  context.backend = new SDLBackend();
-  #endif
-
-  std::string scriptExtention = mainScriptFile.substr(mainScriptFile.rfind('.') + 1);
-
-  if (scriptExtention == "lua") {
-    context.scripting = new LuaScriptingEngine();
-  } else if (scriptExtention == "rb") {
-    context.scripting = new RubyScriptingEngine();
-  } else if (scriptExtention == "py") {
-    context.scripting = new PythonScriptingEngine(programName);
-  } else {
-    std::stringstream msg;
-    msg << "Unsupported script [" << scriptExtention << "] : " << mainScriptFile << std::endl;
-    throw std::runtime_error(msg.str());
-  }
-
-  context.scripting->load(mainScriptFile);
-
-  Backend& backend = *context.backend;
-
-  if (config.debugMode) {
-    std::cout << "Game::Game()" << std::endl;
-    config.print();
-  }
-
-  backend.init();
-  backend.createWindow(
-    config.screenWidth,
-    config.screenHeight,
-    config.useFullscreen,
-    config.windowTitle
-  );
-
-  create();
-  isRunning = true;
-  float lastTime = backend.getTimestamp();
-  float newTime = 0;
-  float deltaTime = 0.0f;
-  while (isRunning) {
-    newTime = backend.getTimestamp();
-    if (newTime - lastTime < 1) {
-      deltaTime = (newTime - lastTime);
-      backend.preFrameUpdate(deltaTime);
-      update(deltaTime);
-      backend.postFrameUpdate(deltaTime);
-    }
-    lastTime = newTime;
-    backend.preFrameRender();
-    render();
-    backend.postFrameRender();
-    if (!backend.processEvents()) {
-      isRunning = false;
+#include "ScriptingEngine.hpp"
+#include "Trace.hpp"
+
+// usage: game [script] [--trace FILE] [--profile FILE] [--profile-mode sampling|tracing] [--python-thread] [--lua-alloc pool|system]
+//             [--mem-stats] [--alloc-free PHASES] [--alloc-warmup N] [--alloc-abort]
+// --trace writes a Chrome trace_event timeline of the run to FILE (builds with -DENABLE_TRACING only)
+// --profile profiles the script from the first frame on and writes the profile to FILE - see ScriptProfiler.hpp
+// --python-thread runs a python script on a thread of its own - see ThreadedScriptingEngine.hpp
+// --lua-alloc picks the allocator of the lua states (pool) - see LuaAllocator.hpp
+// --mem-stats counts the memory of a python script for engine.memStats() - see PythonScriptingEngine.cpp
+// --alloc-free reports allocations in the given frame phases (update,render,...) after the first N frames
+// (--alloc-warmup, 60) and prints the allocations of each phase at exit. --alloc-abort aborts on the
+// first one instead. builds with -DTRACK_ALLOCATIONS only - see AllocationTracker.hpp
+int main(int argc, char* argv[]) {
+  std::string mainScriptFile = "game.lua";
+  std::string traceFile;
+  std::string profileFile;
+  ScriptProfiler::Mode profileMode = ScriptProfiler::SAMPLING;
+  bool pythonThread = false;
+  bool allocationFree[allocationTracker::PHASE_COUNT] = {};
+  bool checkAllocations = false;
+  int allocationWarmup = 60;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--trace" && i + 1 < argc) {
+      traceFile.assign(argv[++i]);
+    } else if (arg == "--profile" && i + 1 < argc) {
+      profileFile.assign(argv[++i]);
+    } else if (arg == "--profile-mode" && i + 1 < argc) {
+      if (!ScriptProfiler::parseMode(argv[++i], &profileMode)) {
+        std::cerr << "Unknown profile mode " << argv[i] << std::endl;
+        return EXIT_FAILURE;
+      }
+    } else if (arg == "--python-thread") {
+      pythonThread = true;
+    } else if (arg == "--lua-alloc" && i + 1 < argc) {
+      LuaAllocator::Mode allocatorMode = LuaAllocator::POOLED;
+      if (!LuaAllocator::parseMode(argv[++i], &allocatorMode)) {
+        std::cerr << "Unknown lua allocator " << argv[i] << std::endl;
+        return EXIT_FAILURE;
+      }
+      LuaAllocator::setMode(allocatorMode);
+    } else if (arg == "--mem-stats") {
+      PythonScriptingEngine::setMemoryCounting(true);
+    } else if (arg == "--alloc-free" && i + 1 < argc) {
+      if (!allocationTracker::parsePhaseList(argv[++i], allocationFree)) {
+        std::cerr << "Unknown frame phase in " << argv[i] << std::endl;
+        return EXIT_FAILURE;
+      }
+      checkAllocations = true;
+    } else if (arg == "--alloc-warmup" && i + 1 < argc) {
+      allocationWarmup = std::atoi(argv[++i]);
+    } else if (arg == "--alloc-abort") {
+      allocationTracker::setPolicy(allocationTracker::ABORT);
+    } else {
+      mainScriptFile.assign(arg);
     }
   }
-}
 
-Game::~Game() {
-  destroy();
-
-  if (context.backend != nullptr) {
-    context.backend->shutdown();
-    delete context.backend;
-    context.backend = nullptr;
-  }
-
-  if (context.scripting != nullptr) {
-    delete context.scripting;
-    context.scripting = nullptr;
+  #ifndef ENABLE_TRACING
+  if (!traceFile.empty()) {
+    std::cerr << "--trace ignored: built without ENABLE_TRACING" << std::endl;
+    traceFile.clear();
   }
+  #endif
 
-  if (context.config->debugMode) {
-    std::cout << "Game::~Game()" << std::endl;
+  if (checkAllocations && !allocationTracker::isTracking()) {
+    std::cerr << "--alloc-free ignored: built without TRACK_ALLOCATIONS" << std::endl;
+    checkAllocations = false;
   }
-}
-
-void Game::create() {
-  if (context.config->debugMode) {
-    std::cout << "Game::create()" << std::endl;
+  if (checkAllocations) {
+    for (int phase = 0; phase < allocationTracker::PHASE_COUNT; phase++) {
+      allocationTracker::setAllocationFree(static_cast<allocationTracker::Phase>(phase), allocationFree[phase]);
+    }
+    allocationTracker::startChecking(allocationWarmup > 0 ? allocationWarmup : 0);
   }
 
-  context.scripting->runCreate();
-}
-
-void Game::destroy() {
-  if (context.config->debugMode) {
-    std::cout << "Game::destroy()" << std::endl;
-  }
+  int status = EXIT_SUCCESS;
 
-  context.scripting->runDestroy();
-}
+  try {
+    #ifdef USE_SDL_BACKEND
+    Backend* backend = new SDLBackend();
+    #else
+    Backend* backend = new HeadlessBackend();
+    #endif
+
+    Game game(std::string(argv[0]), mainScriptFile, backend, pythonThread);
+    game.context.scripting->setProfileMode(profileMode);
+
+    if (!profileFile.empty()) {
+      game.context.scripting->setProfileFile(profileFile);
+      if (!game.context.scripting->setProfiling(true)) {
+        std::cerr << "--profile ignored: the script engine could not start its profiler" << std::endl;
+      }
+    }
 
-void Game::update(float deltaTime) {
-  if (context.config->debugMode) {
-    std::cout << "Game::update(" << deltaTime << ")" << std::endl;
+    game.run();
+  } catch(const std::exception& ex) {
+    std::cerr << "Runtime Error: " << ex.what() << std::endl;
+    status = EXIT_FAILURE;
   }
 
-  context.scripting->runUpdate(deltaTime);
-}
-
-void Game::render() {
-  if (context.config->debugMode) {
-    std::cout << "Game::render(" << std::endl;
+  // the timeline is written even after an error - it shows what led up to it
+  if (!traceFile.empty()) {
+    try {
+      trace::write(traceFile);
+    } catch(const std::exception& ex) {
+      std::cerr << "Runtime Error: " << ex.what() << std::endl;
+      status = EXIT_FAILURE;
+    }
   }
 
-  context.scripting->runRender();
-}
-
-int main(int argc, char* argv[]) {
-  std::string mainScriptFile = "game.lua";
-
-  if (argc > 1) {
-    mainScriptFile.assign(argv[1]);
+  if (checkAllocations) {
+    allocationTracker::printReport(std::cerr);
   }
 
-  try {
-    Game game(std::string(argv[0]), mainScriptFile);
-  } catch(const std::exception& ex) {
-    std::cerr << "Runtime Error: " << ex.what() << std::endl;
-    return EXIT_FAILURE;
-  }
-  return EXIT_SUCCESS;
+  return status;
 }